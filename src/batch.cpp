@@ -0,0 +1,419 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "batch.hpp"
+
+#include "log.hpp"
+#include "opera_fs.hpp"
+
+#include "fmt.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  // Files within a directory (or the root) of a 3DO disc image.
+  static
+  void
+  get_image_filepaths(const fs::path   &filepath_,
+                      Options::PathVec &filepaths_)
+  {
+    fs::path image;
+    std::string inner;
+    std::string prefix;
+    std::shared_ptr<const OperaFS> opera;
+    const OperaFS::Entry *entry;
+
+    if(!OperaFS::split(filepath_,image,inner))
+      return;
+
+    opera = OperaFS::get(image);
+    if(!inner.empty())
+      {
+        entry = opera->find(inner);
+        if(!entry)
+          throw fmt::exception("'{}' not found in '{}'",inner,image);
+        if(!entry->directory)
+          {
+            filepaths_.emplace_back(filepath_);
+            return;
+          }
+        prefix = entry->path;
+      }
+
+    prefix += '/';
+    for(const auto &e : opera->entries())
+      {
+        if(e.directory)
+          continue;
+        if(e.path.compare(0,prefix.size(),prefix) != 0)
+          continue;
+
+        filepaths_.emplace_back(OperaFS::join(image,e.path));
+      }
+  }
+
+  static
+  unsigned
+  resolve_jobs(const unsigned jobs_)
+  {
+    unsigned n;
+
+    if(jobs_ > 0)
+      return jobs_;
+
+    n = std::thread::hardware_concurrency();
+
+    return std::max(n,1U);
+  }
+
+  static
+  uint64_t
+  input_size(const fs::path &filepath_)
+  {
+    uint64_t size;
+    std::error_code ec;
+
+    size = fs::file_size(filepath_,ec);
+    if(ec)
+      return 0;
+
+    return size;
+  }
+
+  struct Job
+  {
+    Job(const size_t    idx_,
+        const fs::path &filepath_)
+      : idx(idx_),
+        size(0),
+        input(idx_,filepath_)
+    {
+    }
+
+    size_t       idx;
+    uint64_t     size;
+    Batch::Input input;
+  };
+
+  struct Result
+  {
+    bool               done = false;
+    std::string        log;
+    std::exception_ptr error;
+  };
+
+  class Pipeline
+  {
+  public:
+    Pipeline(const Options::PathVec &filepaths_,
+             const Options::Batch   &opts_,
+             const unsigned          jobs_,
+             const Batch::SkipFunc  &skip_,
+             const Batch::Handler   &handler_)
+      : _filepaths(filepaths_),
+        _skip(skip_),
+        _handler(handler_),
+        _jobs(jobs_),
+        _max_queued(jobs_ * 2),
+        _max_memory(opts_.max_memory),
+        _queued(0),
+        _inflight_bytes(0),
+        _reading_done(false),
+        _abort(false),
+        _results(filepaths_.size())
+    {
+    }
+
+  public:
+    void
+    run()
+    {
+      std::exception_ptr error;
+      std::vector<std::thread> threads;
+
+      threads.emplace_back(&Pipeline::reader,this);
+      for(unsigned i = 0; i < _jobs; i++)
+        threads.emplace_back(&Pipeline::worker,this);
+
+      for(size_t i = 0; i < _results.size(); i++)
+        {
+          std::unique_lock<std::mutex> lk(_mutex);
+
+          _cv_done.wait(lk,[&]{ return _results[i].done; });
+
+          std::string log;
+
+          log.swap(_results[i].log);
+          error = _results[i].error;
+          lk.unlock();
+
+          Log::write(log);
+          if(error)
+            break;
+        }
+
+      if(error)
+        {
+          std::lock_guard<std::mutex> lk(_mutex);
+          _abort = true;
+        }
+      _cv_read.notify_all();
+      _cv_work.notify_all();
+
+      for(auto &thread : threads)
+        thread.join();
+
+      if(error)
+        std::rethrow_exception(error);
+    }
+
+  private:
+    bool
+    has_room(const uint64_t size_) const
+    {
+      if(_queued >= _max_queued)
+        return false;
+      if(_queued == 0)
+        return true;
+      if(_max_memory == 0)
+        return true;
+
+      return ((_inflight_bytes + size_) <= _max_memory);
+    }
+
+    void
+    reader()
+    {
+      for(size_t i = 0; i < _filepaths.size(); i++)
+        {
+          std::unique_ptr<Job> job;
+
+          job = std::make_unique<Job>(i,_filepaths[i]);
+          if(!_skip || !_skip(job->input))
+            job->size = l::input_size(_filepaths[i]);
+
+          {
+            std::unique_lock<std::mutex> lk(_mutex);
+
+            _cv_read.wait(lk,[&]{ return (_abort || has_room(job->size)); });
+            if(_abort)
+              return;
+
+            _queued++;
+            _inflight_bytes += job->size;
+          }
+
+          if(job->size)
+            job->input.read();
+
+          {
+            std::lock_guard<std::mutex> lk(_mutex);
+            _queue.emplace_back(std::move(job));
+          }
+          _cv_work.notify_one();
+        }
+
+      {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _reading_done = true;
+      }
+      _cv_work.notify_all();
+    }
+
+    void
+    worker()
+    {
+      while(true)
+        {
+          std::unique_ptr<Job> job;
+
+          {
+            std::unique_lock<std::mutex> lk(_mutex);
+
+            _cv_work.wait(lk,[&]{ return (_abort ||
+                                          _reading_done ||
+                                          !_queue.empty()); });
+            if(_abort)
+              return;
+            if(_queue.empty())
+              return;
+
+            job = std::move(_queue.front());
+            _queue.pop_front();
+          }
+
+          std::string log;
+          std::exception_ptr error;
+
+          try
+            {
+              Log::Capture capture(log);
+
+              _handler(job->input);
+            }
+          catch(...)
+            {
+              error = std::current_exception();
+            }
+
+          job->input.release();
+
+          {
+            std::lock_guard<std::mutex> lk(_mutex);
+            Result &result = _results[job->idx];
+
+            _queued--;
+            _inflight_bytes -= job->size;
+            result.log.swap(log);
+            result.error = error;
+            result.done  = true;
+          }
+
+          _cv_read.notify_one();
+          _cv_done.notify_one();
+        }
+    }
+
+  private:
+    const Options::PathVec &_filepaths;
+    const Batch::SkipFunc  &_skip;
+    const Batch::Handler   &_handler;
+    const unsigned          _jobs;
+    const unsigned          _max_queued;
+    const uint64_t          _max_memory;
+
+    std::mutex              _mutex;
+    std::condition_variable _cv_read;
+    std::condition_variable _cv_work;
+    std::condition_variable _cv_done;
+
+    std::deque<std::unique_ptr<Job>> _queue;
+    unsigned            _queued;
+    uint64_t            _inflight_bytes;
+    bool                _reading_done;
+    bool                _abort;
+    std::vector<Result> _results;
+  };
+}
+
+Batch::Input::Input(const size_t    idx_,
+                    const fs::path &filepath_)
+  : _idx(idx_),
+    _filepath(filepath_),
+    _read(false)
+{
+}
+
+void
+Batch::Input::read()
+{
+  _read = true;
+  try
+    {
+      _file.open(_filepath);
+    }
+  catch(...)
+    {
+      _error = std::current_exception();
+    }
+}
+
+void
+Batch::Input::release()
+{
+  _file.close();
+}
+
+const MappedFile&
+Batch::Input::file()
+{
+  if(!_read)
+    read();
+  if(_error)
+    std::rethrow_exception(_error);
+
+  return _file;
+}
+
+Options::PathVec
+Batch::get_filepaths(const Options::PathVec &filepaths_)
+{
+  Options::PathVec rv;
+
+  for(const auto &filepath : filepaths_)
+    {
+      fs::directory_entry de(filepath);
+
+      if(de.is_regular_file())
+        rv.emplace_back(de.path());
+      else if(de.is_directory())
+        {
+          auto diriter = fs::recursive_directory_iterator(filepath);
+
+          for(const fs::directory_entry &de : diriter)
+            {
+              if(de.is_regular_file())
+                rv.emplace_back(de.path());
+            }
+        }
+      else
+        {
+          l::get_image_filepaths(filepath,rv);
+        }
+    }
+
+  return rv;
+}
+
+void
+Batch::run(const Options::PathVec &filepaths_,
+           const Options::Batch   &opts_,
+           const SkipFunc         &skip_,
+           const Handler          &handler_)
+{
+  unsigned jobs;
+
+  jobs = l::resolve_jobs(opts_.jobs);
+  jobs = std::min<size_t>(jobs,filepaths_.size());
+  if(jobs <= 1)
+    {
+      for(size_t i = 0; i < filepaths_.size(); i++)
+        {
+          Batch::Input input(i,filepaths_[i]);
+
+          handler_(input);
+        }
+
+      return;
+    }
+
+  l::Pipeline pipeline(filepaths_,opts_,jobs,skip_,handler_);
+
+  pipeline.run();
+}
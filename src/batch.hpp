@@ -0,0 +1,81 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "mapped_file.hpp"
+#include "options.hpp"
+
+#include <exception>
+#include <filesystem>
+#include <functional>
+
+
+/*
+  Shared driver for the to-* conversion subcommands.
+
+  A reader stage maps input files ahead of the workers through a
+  bounded queue; the workers run the subcommand's handler (identify,
+  decode, encode, write) on a file each; the calling thread prints
+  every file's captured output in input order. The queue is bounded
+  both by count (a couple of files per worker) and by the total size
+  of the mapped inputs (Options::Batch::max_memory). Identify, decode
+  and encode aren't separate stages so the images a handler decodes
+  aren't counted against that limit. With one job the handler is
+  simply called in order on the calling thread.
+*/
+namespace Batch
+{
+  class Input
+  {
+  public:
+    Input(const size_t                 idx,
+          const std::filesystem::path &filepath);
+
+  public:
+    // Position of the file in the list passed to Batch::run.
+    size_t                       idx() const { return _idx; }
+    const std::filesystem::path &filepath() const { return _filepath; }
+
+    // Returns the file's contents, reading it if the reader stage
+    // didn't. Errors from reading are (re)thrown from here so the
+    // handler reports them like any other conversion error.
+    const MappedFile &file();
+
+  public:
+    void read();
+    void release();
+
+  private:
+    size_t                _idx;
+    std::filesystem::path _filepath;
+    MappedFile            _file;
+    std::exception_ptr    _error;
+    bool                  _read;
+  };
+
+  typedef std::function<bool(const Input&)> SkipFunc;
+  typedef std::function<void(Input&)> Handler;
+
+  Options::PathVec get_filepaths(const Options::PathVec &filepaths);
+
+  void run(const Options::PathVec &filepaths,
+           const Options::Batch   &opts,
+           const SkipFunc         &skip,
+           const Handler          &handler);
+}
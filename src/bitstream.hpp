@@ -2,24 +2,32 @@
 
 #include "CLI11.hpp"
 #include "bits_and_bytes.hpp"
+#include "byteswap.hpp"
 #include "span.hpp"
 
 #include "types_ints.h"
 
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 
 
+// Reads big endian bit fields. Rather than assembling values a bit at
+// a time every read loads the 64bit big endian word containing the
+// field and shifts it out. Reads past the end of the data return zero
+// bits.
 class BitStreamReader
 {
 private:
   const u8 *_data;
+  u64       _bytes;
   u64       _size;
   u64       _idx;
 
 public:
   BitStreamReader()
     : _data(NULL),
+      _bytes(0),
       _size(0),
       _idx(0)
   {
@@ -44,9 +52,10 @@ public:
         const u64  size_,
         const u64  idx_ = 0)
   {
-    _data = data_;
-    _size = size_ * BITS_PER_BYTE;
-    _idx  = idx_;
+    _data  = data_;
+    _bytes = size_;
+    _size  = size_ * BITS_PER_BYTE;
+    _idx   = idx_;
   }
 
   void
@@ -159,58 +168,217 @@ public:
     return ((_idx + (BITS_PER_BYTE - 1)) / BITS_PER_BYTE);
   }
 
+private:
+  // The 64 bits starting at the byte containing idx_. Only valid when
+  // all 8 bytes are in bounds.
+  u64
+  _load_unchecked(const u64 idx_) const
+  {
+    u64 word;
+
+    memcpy(&word,&_data[idx_ >> 3],sizeof(word));
+
+    return byteswap_if_little_endian(word);
+  }
+
+  u64
+  _load(const u64 idx_) const
+  {
+    u64 byte;
+    u64 word;
+
+    byte = (idx_ >> 3);
+    if((byte + sizeof(word)) <= _bytes)
+      return _load_unchecked(idx_);
+
+    word = 0;
+    for(u64 i = 0; i < sizeof(word); i++)
+      {
+        word <<= BITS_PER_BYTE;
+        if((byte + i) < _bytes)
+          word |= _data[byte + i];
+      }
+
+    return word;
+  }
+
 public:
+  // Callers must ensure the 8 bytes from idx_'s byte are in bounds
+  // and that bits_ is between 1 and 57.
   u64
-  read(const u64 idx_,
-       const u64 bits_)
+  read_unchecked(const u64 idx_,
+                 const u64 bits_) const
   {
-    u64 val = 0;
+    return ((_load_unchecked(idx_) << (idx_ & 7)) >> (64 - bits_));
+  }
 
-    for(u64 i = idx_; i < (idx_ + bits_); i++)
-      val = ((val << 1) | ((_data[i >> 3] >> (7 - (i & 7))) & 1));
+  u64
+  read(const u64 idx_,
+       const u64 bits_) const
+  {
+    if(bits_ == 0)
+      return 0;
+    if(bits_ > 57)
+      return ((read(idx_,bits_ - 32) << 32) | read(idx_ + bits_ - 32,32));
 
-    return val;
+    return ((_load(idx_) << (idx_ & 7)) >> (64 - bits_));
   }
 
   u64
   read(const u64 bits_)
   {
-    u32 v;
+    u64 v;
 
     v = read(_idx,bits_);
     _idx += bits_;
 
     return v;
   }
+
+  // Reads count_ consecutive bits_ wide values (1 to 32 bits). Each
+  // 64bit load is drained of as many values as it holds before
+  // refilling and only the tail of the data takes the checked path.
+  template<typename T>
+  void
+  read_n(const u64  bits_,
+         T         *out_,
+         const u64  count_)
+  {
+    u64 i;
+    u64 acc;
+    u64 avail;
+
+    i = 0;
+    while((i < count_) && (((_idx >> 3) + sizeof(acc)) <= _bytes))
+      {
+        acc   = (_load_unchecked(_idx) << (_idx & 7));
+        avail = (64 - (_idx & 7));
+        while((i < count_) && (avail >= bits_))
+          {
+            out_[i++] = (acc >> (64 - bits_));
+            acc     <<= bits_;
+            avail    -= bits_;
+            _idx     += bits_;
+          }
+      }
+
+    for(; i < count_; i++)
+      out_[i] = read(bits_);
+  }
 };
 
 
+// Overwrites bits_ bits (at most 57) at bit idx_ of data_ with the low
+// bits of val_ using a single 64bit read-modify-write when the word is
+// in bounds. Bytes past size_ are left untouched.
+static
+inline
+void
+bitstream_write_bits(u8        *data_,
+                     const u64  size_,
+                     const u64  idx_,
+                     const u64  bits_,
+                     u64        val_)
+{
+  u64 byte;
+  u64 mask;
+  u64 word;
+  u64 shift;
+
+  if(bits_ == 0)
+    return;
+
+  byte  = (idx_ >> 3);
+  shift = (64 - (idx_ & 7) - bits_);
+  mask  = ((~UINT64_C(0) >> (64 - bits_)) << shift);
+  val_  = ((val_ << shift) & mask);
+
+  if((byte + sizeof(word)) <= size_)
+    {
+      memcpy(&word,&data_[byte],sizeof(word));
+      word = byteswap_if_little_endian(word);
+      word = ((word & ~mask) | val_);
+      word = byteswap_if_little_endian(word);
+      memcpy(&data_[byte],&word,sizeof(word));
+      return;
+    }
+
+  for(u64 i = 0; (i < sizeof(word)) && ((byte + i) < size_); i++)
+    {
+      const u8 m = (mask >> (56 - (i * 8)));
+      const u8 v = (val_ >> (56 - (i * 8)));
+
+      data_[byte + i] = ((data_[byte + i] & ~m) | v);
+    }
+}
+
+static
+inline
+void
+bitstream_write(u8  *data_,
+                u64  size_,
+                u64  idx_,
+                u64  bits_,
+                u64  val_)
+{
+  if(bits_ > 32)
+    {
+      bitstream_write_bits(data_,size_,idx_,bits_ - 32,val_ >> 32);
+      idx_  += (bits_ - 32);
+      bits_  = 32;
+    }
+
+  bitstream_write_bits(data_,size_,idx_,bits_,val_);
+}
+
+
+// Sequential writes collect in a 64bit accumulator and go out to the
+// buffer a 32bit word at a time. Anything which moves the index or
+// looks at the buffer flushes first; so does destruction.
 class BitStreamWriter
 {
 private:
   u64 _idx;
+  u64 _acc;
+  u64 _acc_bits;
   std::vector<u8> *_data;
 
 public:
   BitStreamWriter()
     : _idx(0),
+      _acc(0),
+      _acc_bits(0),
       _data(NULL)
   {
   }
 
   BitStreamWriter(std::vector<u8> &data_,
                   const u64        idx_ = 0)
+    : BitStreamWriter()
   {
     reset(data_,idx_);
   }
 
+  ~BitStreamWriter()
+  {
+    flush();
+  }
+
+  BitStreamWriter(const BitStreamWriter&) = delete;
+  BitStreamWriter& operator=(const BitStreamWriter&) = delete;
+
 public:
   void
   reset(std::vector<u8> &data_,
         const u64        idx_ = 0)
   {
-    _data = &data_;
-    _idx  = idx_;
+    if(_data)
+      flush();
+
+    _data     = &data_;
+    _idx      = idx_;
+    _acc      = 0;
+    _acc_bits = 0;
   }
 
   void
@@ -220,6 +388,23 @@ public:
     reset(*data_,idx_);
   }
 
+  void
+  reserve(const u64 size_in_bits_)
+  {
+    assert(_data != NULL);
+
+    _data->reserve((size_in_bits_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+  }
+
+  void
+  flush()
+  {
+    if(_acc_bits == 0)
+      return;
+
+    _emit(_acc_bits);
+  }
+
 private:
   void
   _maybe_resize(const u64 size_in_bits_)
@@ -230,10 +415,29 @@ private:
       _data->resize((size_in_bits_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
   }
 
+  // Writes the oldest bits_ pending bits to the buffer.
+  void
+  _emit(const u64 bits_)
+  {
+    u64 idx;
+
+    idx = (_idx - _acc_bits);
+    _maybe_resize(idx + bits_);
+    ::bitstream_write(_data->data(),
+                      _data->size(),
+                      idx,
+                      bits_,
+                      (_acc >> (_acc_bits - bits_)));
+
+    _acc_bits -= bits_;
+    _acc      &= (_acc_bits ? (~UINT64_C(0) >> (64 - _acc_bits)) : 0);
+  }
+
 public:
   void
   seek(const u64 idx_)
   {
+    flush();
     _maybe_resize(idx_);
     _idx = idx_;
   }
@@ -390,24 +594,28 @@ public:
         u64 bits_,
         u64 val_)
   {
+    flush();
     _maybe_resize(idx_ + bits_);
-
-    for(u64 i = 0; i < bits_; i++)
-      {
-        u8 &d = (*_data)[idx_ >> 3];
-        const int shift = (7 - (idx_ & 7));
-
-        d = ((d & ~(1UL << shift)) | (((val_ >> (bits_ - i - 1)) & 1) << shift));
-        idx_++;
-      }
+    ::bitstream_write(_data->data(),_data->size(),idx_,bits_,val_);
   }
 
   void
   write(u64 bits_,
         u64 val_)
   {
-    write(_idx,bits_,val_);
-    _idx += bits_;
+    if(bits_ > 32)
+      {
+        write(bits_ - 32,val_ >> 32);
+        bits_ = 32;
+      }
+    if(bits_ == 0)
+      return;
+
+    _acc       = ((_acc << bits_) | (val_ & (~UINT64_C(0) >> (64 - bits_))));
+    _acc_bits += bits_;
+    _idx      += bits_;
+    if(_acc_bits >= 32)
+      _emit(32);
   }
 
   void
@@ -417,6 +625,29 @@ public:
       write(8,byte);
   }
 
+  // count_ copies of the bits_ (at most 32) wide val_. As many
+  // copies as fit in 32bits are replicated and written at once.
+  void
+  write_run(const u64 val_,
+            const u64 bits_,
+            u64       count_)
+  {
+    u64 per;
+    u64 pattern;
+
+    if(bits_ == 0)
+      return;
+
+    per     = (32 / bits_);
+    pattern = 0;
+    for(u64 i = 0; i < per; i++)
+      pattern = ((pattern << bits_) | (val_ & (~UINT64_C(0) >> (64 - bits_))));
+
+    for(; count_ >= per; count_ -= per)
+      write(per * bits_,pattern);
+    write(count_ * bits_,pattern);
+  }
+
 public:
   u64
   read(const u64 idx_,
@@ -424,6 +655,7 @@ public:
   {
     u64 val = 0;
 
+    flush();
     for(u64 i = idx_; i < (idx_ + bits_); i++)
       val = ((val << 1) | (((*_data)[i >> 3] >> (7 - (i & 7))) & 1));
 
@@ -442,6 +674,7 @@ private:
 public:
   BitStream()
     : _idx(0),
+      _size(0),
       _data()
   {
   }
@@ -455,6 +688,12 @@ private:
   }
 
 public:
+  void
+  reserve(const u64 size_in_bits_)
+  {
+    _data.reserve((size_in_bits_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+  }
+
   const
   std::vector<u8>&
   data() const
@@ -763,15 +1002,7 @@ public:
         u64 val_)
   {
     _maybe_resize(idx_ + bits_);
-
-    for(u64 i = 0; i < bits_; i++)
-      {
-        u8 &d = _data[idx_ >> 3];
-        const int shift = (7 - (idx_ & 7));
-
-        d = ((d & ~(1UL << shift)) | (((val_ >> (bits_ - i - 1)) & 1) << shift));
-        idx_++;
-      }
+    ::bitstream_write(_data.data(),_data.size(),idx_,bits_,val_);
   }
 
   void
@@ -790,6 +1021,62 @@ public:
       write(8,byte);
   }
 
+  // count_ copies of the bits_ (at most 32) wide val_. As many
+  // copies as fit in 32bits are replicated and written at once.
+  void
+  write_run(const u64 val_,
+            const u64 bits_,
+            u64       count_)
+  {
+    u64 per;
+    u64 pattern;
+
+    if(bits_ == 0)
+      return;
+
+    per     = (32 / bits_);
+    pattern = 0;
+    for(u64 i = 0; i < per; i++)
+      pattern = ((pattern << bits_) | (val_ & (~UINT64_C(0) >> (64 - bits_))));
+
+    for(; count_ >= per; count_ -= per)
+      write(per * bits_,pattern);
+    write(count_ * bits_,pattern);
+  }
+
+  // count_ consecutive bits_ (at most 32) wide values from vals_
+  // gathered into whole 32bit writes rather than one per value.
+  template<typename T>
+  void
+  write_n(const u64  bits_,
+          const T   *vals_,
+          const u64  count_)
+  {
+    u64 acc;
+    u64 acc_bits;
+    const u64 mask = (~UINT64_C(0) >> (64 - bits_));
+
+    _maybe_resize(_idx + (bits_ * count_));
+
+    acc      = 0;
+    acc_bits = 0;
+    for(u64 i = 0; i < count_; i++)
+      {
+        acc       = ((acc << bits_) | (vals_[i] & mask));
+        acc_bits += bits_;
+        if(acc_bits < 32)
+          continue;
+
+        acc_bits -= 32;
+        ::bitstream_write(_data.data(),_data.size(),_idx,32,(acc >> acc_bits));
+        _idx += 32;
+      }
+
+    ::bitstream_write(_data.data(),_data.size(),_idx,acc_bits,acc);
+    _idx += acc_bits;
+    _size = std::max(_idx,_size);
+  }
+
 public:
   u64
   read_bit(const u64 idx_)
@@ -82,6 +82,15 @@ byteswap(const uint32_t v_)
           ((v_ & UINT32_C(0xFF000000)) >> 24));
 }
 
+static
+inline
+uint64_t
+byteswap(const uint64_t v_)
+{
+  return (((uint64_t)byteswap((uint32_t)(v_ >>  0)) << 32) |
+          ((uint64_t)byteswap((uint32_t)(v_ >> 32)) <<  0));
+}
+
 template<typename T>
 static
 inline
@@ -0,0 +1,432 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "cel_cache.hpp"
+
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "version.hpp"
+
+#include "fmt.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  static const char     MAGIC[4]       = {'3','I','T','C'};
+  static const uint32_t FORMAT_VERSION = 1;
+  static const char    *EXTENSION      = ".3itc";
+
+  // Entries are stored in host byte order; the byte order is part of
+  // the key so a cache shared between hosts can't mix them up.
+  class Writer
+  {
+  public:
+    Writer(ByteVec &buf_)
+      : _buf(buf_)
+    {
+    }
+
+  public:
+    void
+    raw(const void   *p_,
+        const size_t  size_)
+    {
+      const uint8_t *p = (const uint8_t*)p_;
+
+      _buf.insert(_buf.end(),p,p + size_);
+    }
+
+    void u32(const uint32_t v_) { raw(&v_,sizeof(v_)); }
+    void u64(const uint64_t v_) { raw(&v_,sizeof(v_)); }
+
+    void
+    str(const std::string &s_)
+    {
+      u32(s_.size());
+      raw(s_.data(),s_.size());
+    }
+
+  private:
+    ByteVec &_buf;
+  };
+
+  class Reader
+  {
+  public:
+    Reader(cspan<uint8_t> data_)
+      : _data(data_),
+        _pos(0)
+    {
+    }
+
+  public:
+    void
+    raw(void         *p_,
+        const size_t  size_)
+    {
+      if((_data.size() - _pos) < size_)
+        throw std::runtime_error("truncated cache entry");
+
+      std::memcpy(p_,&_data[_pos],size_);
+      _pos += size_;
+    }
+
+    uint32_t u32() { uint32_t v; raw(&v,sizeof(v)); return v; }
+    uint64_t u64() { uint64_t v; raw(&v,sizeof(v)); return v; }
+
+    std::string
+    str()
+    {
+      std::string s;
+
+      s.resize(u32());
+      raw(s.data(),s.size());
+
+      return s;
+    }
+
+    bool eof() const { return (_pos == _data.size()); }
+
+  private:
+    cspan<uint8_t> _data;
+    size_t         _pos;
+  };
+
+  static
+  void
+  serialize(const CelCache::Key   &key_,
+            const std::string     &opts_,
+            const CelCache::Entry &entry_,
+            ByteVec               &buf_)
+  {
+    l::Writer w(buf_);
+
+    w.raw(l::MAGIC,sizeof(l::MAGIC));
+    w.u32(l::FORMAT_VERSION);
+    w.u64(key_.hi);
+    w.u64(key_.lo);
+    w.str(opts_);
+    w.u32(entry_.outputs.size());
+    for(const auto &output : entry_.outputs)
+      {
+        w.str(output.log);
+        w.u32(output.extra.size());
+        for(const auto &kv : output.extra)
+          {
+            w.str(kv.first);
+            w.str(kv.second);
+          }
+        w.raw(&output.ccc,sizeof(output.ccc));
+        w.u32(output.pdat.size());
+        w.raw(output.pdat.data(),output.pdat.size());
+        w.u32(output.plut.size());
+        w.raw(output.plut.data(),output.plut.size() * sizeof(uint16_t));
+      }
+    w.str(entry_.log);
+  }
+
+  static
+  bool
+  deserialize(cspan<uint8_t>       data_,
+              const CelCache::Key &key_,
+              const std::string   &opts_,
+              CelCache::Entry     &entry_)
+  {
+    char magic[sizeof(l::MAGIC)];
+    l::Reader r(data_);
+
+    r.raw(magic,sizeof(magic));
+    if(std::memcmp(magic,l::MAGIC,sizeof(magic)))
+      return false;
+    if(r.u32() != l::FORMAT_VERSION)
+      return false;
+    if(r.u64() != key_.hi)
+      return false;
+    if(r.u64() != key_.lo)
+      return false;
+    if(r.str() != opts_)
+      return false;
+
+    entry_.outputs.resize(r.u32());
+    for(auto &output : entry_.outputs)
+      {
+        uint32_t count;
+
+        output.log             = r.str();
+        count = r.u32();
+        for(uint32_t i = 0; i < count; i++)
+          {
+            std::string k;
+
+            k = r.str();
+            output.extra[k] = r.str();
+          }
+        r.raw(&output.ccc,sizeof(output.ccc));
+        output.pdat.resize(r.u32());
+        r.raw(output.pdat.data(),output.pdat.size());
+        output.plut.resize(r.u32());
+        r.raw(output.plut.data(),output.plut.size() * sizeof(uint16_t));
+      }
+    entry_.log = r.str();
+
+    return r.eof();
+  }
+
+  static
+  std::string
+  tmp_suffix()
+  {
+    size_t tid;
+
+    tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+#ifndef _WIN32
+    return fmt::format(".tmp.{}.{:x}",(long)::getpid(),tid);
+#else
+    return fmt::format(".tmp.{:x}",tid);
+#endif
+  }
+}
+
+std::string
+CelCache::Key::str() const
+{
+  return fmt::format("{:016x}{:016x}",hi,lo);
+}
+
+CelCache::Recorder::Recorder(const std::string &log_)
+  : _log(log_),
+    _consumed(0)
+{
+}
+
+void
+CelCache::Recorder::output(const StrMap          &extra_,
+                           const CelControlChunk &ccc_,
+                           const ByteVec         &pdat_,
+                           const PLUT            &plut_)
+{
+  Output output;
+
+  output.log   = _log.substr(_consumed);
+  output.extra = extra_;
+  output.ccc   = ccc_;
+  output.pdat  = pdat_;
+  output.plut  = plut_;
+
+  entry.outputs.emplace_back(std::move(output));
+  _consumed = _log.size();
+}
+
+void
+CelCache::Recorder::mark()
+{
+  _consumed = _log.size();
+}
+
+void
+CelCache::Recorder::finish()
+{
+  entry.log = _log.substr(_consumed);
+  _consumed = _log.size();
+}
+
+CelCache::CelCache(const fs::path &dirpath_,
+                   const uint64_t  max_size_)
+  : _dirpath(dirpath_),
+    _max_size(max_size_),
+    _hits(0),
+    _misses(0),
+    _stores(0),
+    _evictions(0)
+{
+  fs::create_directories(_dirpath);
+}
+
+CelCache::Key
+CelCache::key(cspan<uint8_t>     data_,
+              const std::string &opts_) const
+{
+  Key key;
+  std::string seed_str;
+  uint64_t seed;
+
+  seed_str = fmt::format("3it {}.{}.{} {} {}",
+                         MAJOR,MINOR,PATCH,
+                         ((__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) ? "be" : "le"),
+                         opts_);
+  seed = Hash::xxh64(seed_str.data(),seed_str.size());
+
+  key.hi = Hash::xxh64(data_.data(),data_.size(),seed);
+  key.lo = Hash::xxh64(data_.data(),data_.size(),~seed);
+
+  return key;
+}
+
+fs::path
+CelCache::filepath(const Key &key_) const
+{
+  std::string str;
+
+  str = key_.str();
+
+  return (_dirpath / str.substr(0,2) / (str + l::EXTENSION));
+}
+
+bool
+CelCache::lookup(const Key         &key_,
+                 const std::string &opts_,
+                 Entry             &entry_)
+{
+  bool rv;
+  fs::path path;
+  MappedFile file;
+  std::error_code ec;
+
+  path = filepath(key_);
+
+  try
+    {
+      file.open(path);
+      rv = l::deserialize(file,key_,opts_,entry_);
+    }
+  catch(const std::exception &e_)
+    {
+      rv = false;
+    }
+
+  if(!rv)
+    {
+      _misses++;
+      entry_ = Entry();
+      return false;
+    }
+
+  fs::last_write_time(path,fs::file_time_type::clock::now(),ec);
+  _hits++;
+
+  return true;
+}
+
+void
+CelCache::store(const Key         &key_,
+                const std::string &opts_,
+                const Entry       &entry_)
+{
+  ByteVec buf;
+  fs::path path;
+  fs::path tmppath;
+  std::error_code ec;
+
+  l::serialize(key_,opts_,entry_,buf);
+
+  path    = filepath(key_);
+  tmppath = path.string() + l::tmp_suffix();
+
+  fs::create_directories(path.parent_path(),ec);
+
+  {
+    std::ofstream f(tmppath,std::ios::binary|std::ios::trunc);
+
+    f.write((const char*)buf.data(),buf.size());
+    if(!f)
+      {
+        fs::remove(tmppath,ec);
+        return;
+      }
+  }
+
+  fs::rename(tmppath,path,ec);
+  if(ec)
+    {
+      fs::remove(tmppath,ec);
+      return;
+    }
+
+  _stores++;
+}
+
+void
+CelCache::evict()
+{
+  struct File
+  {
+    fs::path            path;
+    fs::file_time_type  mtime;
+    uint64_t            size;
+  };
+
+  uint64_t total;
+  std::error_code ec;
+  std::vector<File> files;
+
+  if(_max_size == 0)
+    return;
+
+  total = 0;
+  for(auto iter = fs::recursive_directory_iterator(_dirpath,ec);
+      iter != fs::recursive_directory_iterator();
+      iter.increment(ec))
+    {
+      File file;
+
+      if(ec)
+        break;
+      if(!iter->is_regular_file(ec))
+        continue;
+      if(iter->path().extension() != l::EXTENSION)
+        continue;
+
+      file.path  = iter->path();
+      file.size  = iter->file_size(ec);
+      file.mtime = iter->last_write_time(ec);
+      total += file.size;
+      files.emplace_back(std::move(file));
+    }
+
+  if(total <= _max_size)
+    return;
+
+  std::sort(files.begin(),files.end(),
+            [](const File &a_, const File &b_)
+            {
+              return (a_.mtime < b_.mtime);
+            });
+
+  for(const auto &file : files)
+    {
+      if(total <= _max_size)
+        break;
+      if(!fs::remove(file.path,ec))
+        continue;
+
+      total -= file.size;
+      _evictions++;
+    }
+}
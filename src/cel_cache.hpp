@@ -0,0 +1,134 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "bytevec.hpp"
+#include "cel_control_chunk.hpp"
+#include "plut.hpp"
+#include "span.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+  Content addressed cache of to-cel results.
+
+  The key is a 128 bit hash of the input file's bytes seeded with the
+  options which affect the output (everything but the input and
+  output paths) and the 3it version. An entry holds every CEL written
+  for the input: the CCB, PDAT and PLUT, the output path template
+  field values, and the status text printed around each one. A hit
+  replays that against the current input and output paths without
+  decoding or encoding anything.
+
+  Entries are individual files under the cache directory written via
+  rename so concurrent runs can share it. Their mtime is refreshed on
+  every hit and evict() removes the least recently used until the
+  directory is under its size cap.
+*/
+class CelCache
+{
+public:
+  typedef std::unordered_map<std::string,std::string> StrMap;
+
+  struct Output
+  {
+    std::string     log;
+    StrMap          extra;
+    CelControlChunk ccc;
+    ByteVec         pdat;
+    PLUT            plut;
+  };
+
+  struct Entry
+  {
+    std::vector<Output> outputs;
+    std::string         log;
+  };
+
+  struct Key
+  {
+    uint64_t hi;
+    uint64_t lo;
+
+    std::string str() const;
+  };
+
+  // Collects the outputs of a conversion as it happens. `log` is the
+  // capture buffer the conversion prints into.
+  class Recorder
+  {
+  public:
+    Recorder(const std::string &log);
+
+  public:
+    void output(const StrMap          &extra,
+                const CelControlChunk &ccc,
+                const ByteVec         &pdat,
+                const PLUT            &plut);
+    // Marks the status text printed for the last output as consumed.
+    void mark();
+    void finish();
+
+  public:
+    Entry entry;
+
+  private:
+    const std::string &_log;
+    size_t             _consumed;
+  };
+
+public:
+  CelCache(const std::filesystem::path &dirpath,
+           const uint64_t               max_size);
+
+public:
+  Key  key(cspan<uint8_t>     data,
+           const std::string &opts) const;
+  bool lookup(const Key         &key,
+              const std::string &opts,
+              Entry             &entry);
+  void store(const Key         &key,
+             const std::string &opts,
+             const Entry       &entry);
+  void evict();
+
+public:
+  uint64_t hits() const { return _hits; }
+  uint64_t misses() const { return _misses; }
+  uint64_t stores() const { return _stores; }
+  uint64_t evictions() const { return _evictions; }
+
+private:
+  std::filesystem::path filepath(const Key &key) const;
+
+private:
+  const std::filesystem::path _dirpath;
+  const uint64_t              _max_size;
+
+  std::atomic<uint64_t> _hits;
+  std::atomic<uint64_t> _misses;
+  std::atomic<uint64_t> _stores;
+  std::atomic<uint64_t> _evictions;
+};
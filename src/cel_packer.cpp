@@ -26,6 +26,13 @@
   the performance and space considerations are secondary to output and
   maintainability. The code is broken down into numerous passes.
 
+  The abstract image is a single buffer of converted pixels with each
+  row's packets stored as (type, start, count) ranges over it. Every
+  row has room for one packet per pixel so the passes rewrite rows in
+  place rather than building new ones. Passes 0 through 7 are per row
+  and run across the thread pool. Only 8 through 10 look at
+  neighbouring rows and are serial.
+
   0. Convert the raw bitmap into an abstract form. Absolutely worse
   'packed' form with every pixel being an individual literal
   packet. Does color conversion as well to ensure proper packing
@@ -46,11 +53,19 @@
   7. Convert the AbstractPackedImage to a vector of 3DO packed data
   bitstreams. This is necessary to compare end of row 1 with
   beginning of row 2. This is valid output but more can be done.
-  8. For each sequential pair of rows compare the end of row 1 with
-  beginning of row 2. If they overlap remove the overlap from row 1.
+  8. For each row find the longest run of trailing words which match
+  the words stored after it and remove them from the row. Works
+  bottom up so those following words are final. Single pixel packets
+  near the end of a row are also tried as the other of literal or
+  packed, which costs the same, to find more overlaps.
   9. Pad the row bitstreams to ensure they are >= 2 words and padded
   to a multiple of 4 byte word.
   10. Convert the row of bitstreams to a byte vector for writing to disk.
+
+  In OPTIMAL mode passes 1 through 6 are replaced by a single shortest
+  path search over each row (see pass1_optimal_segmentation) which
+  finds the segmentation with the fewest bits. Passes 7 through 10
+  are shared.
 */
 
 #include "cel_packer.hpp"
@@ -64,86 +79,141 @@
 #include "ccb_flags.hpp"
 #include "packed.hpp"
 #include "pixel_converter.hpp"
+#include "thread_pool.hpp"
 
 #include "fmt.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <stdexcept>
 #include <vector>
 
 typedef std::vector<BitStream> BitStreamVec;
 
+// A packet is a range of AbstractPackedImage::pixels. Packets only
+// ever merge with their neighbours so a literal's pixels are always
+// contiguous and a packed or transparent packet's are all the same.
 struct PackedDataPacket
 {
-  uint8_t type;
-  uint8_t bpp;
-  std::vector<u32> pixels;
+  u8  type;
+  u32 start;
+  u32 count;
 
   bool is_literal() const { return type == PACK_LITERAL; };
   bool is_packed() const { return type == PACK_PACKED; };
   bool is_transparent() const { return type == PACK_TRANSPARENT; };
   bool is_eol() const { return type == PACK_EOL; };
 
-  u32 size_in_bits() const;
-  u32 raw_literal_size() const;
+  u32 size_in_bits(const u32 bpp) const;
+  u32 raw_literal_size(const u32 bpp) const;
 };
 
-struct PackedDataPacketVec : public std::vector<PackedDataPacket>
+// View of one row's packet slots. Each row owns line_width slots,
+// enough for one packet per pixel, so passes can rewrite rows in
+// place without allocating.
+class PackedDataPacketRow
 {
+public:
+  PackedDataPacketRow(PackedDataPacket *packets_,
+                      u32              &count_,
+                      const u32         capacity_)
+    : _packets(packets_),
+      _count(count_),
+      _capacity(capacity_)
+  {
+  }
+
+public:
+  PackedDataPacket* begin() const { return _packets; }
+  PackedDataPacket* end() const { return (_packets + _count); }
+  PackedDataPacket& operator[](const size_t i_) const { return _packets[i_]; }
+  PackedDataPacket& back() const { return _packets[_count - 1]; }
+  size_t size() const { return _count; }
+  bool empty() const { return (_count == 0); }
+
+  void
+  resize(const size_t count_)
+  {
+    assert(count_ <= _capacity);
+    _count = count_;
+  }
+
+  void
+  emplace_back(const u8  type_,
+               const u32 start_,
+               const u32 count_)
+  {
+    resize(_count + 1);
+    back() = PackedDataPacket{type_,start_,count_};
+  }
+
   u32 pixel_count() const;
-  u32 size_in_bits() const;
+  u32 size_in_bits(const u32 bpp) const;
+
+private:
+  PackedDataPacket *_packets;
+  u32              &_count;
+  const u32         _capacity;
 };
 
-struct AbstractPackedImage : public std::vector<PackedDataPacketVec>
+struct AbstractPackedImage
 {
   u32 bpp;
   u32 line_width;
   u32 offset_width;
-  u32 size_in_bits() const;
+  std::vector<u32> pixels;
+  std::vector<PackedDataPacket> packets;
+  std::vector<u32> counts;
+
+  void resize(const u32 w, const u32 h);
+  size_t size() const { return counts.size(); }
+  PackedDataPacketRow row(const size_t y);
 };
 
 
 u32
-PackedDataPacketVec::pixel_count() const
+PackedDataPacketRow::pixel_count() const
 {
   u32 c;
 
   c = 0;
   for(const auto &pdp : *this)
-    c += pdp.pixels.size();
+    c += pdp.count;
 
   return c;
 }
 
 u32
-PackedDataPacketVec::size_in_bits() const
+PackedDataPacketRow::size_in_bits(const u32 bpp_) const
 {
   u32 c;
 
   c = 0;
   for(const auto &pdp : *this)
-    c += pdp.size_in_bits();
+    c += pdp.size_in_bits(bpp_);
 
   return c;
 }
 
 u32
-PackedDataPacket::size_in_bits() const
+PackedDataPacket::size_in_bits(const u32 bpp_) const
 {
   switch(type)
     {
     case PACK_LITERAL:
       return (DATA_PACKET_DATA_TYPE_SIZE +
               DATA_PACKET_PIXEL_COUNT_SIZE +
-              (pixels.size() * bpp));
+              (count * bpp_));
     case PACK_TRANSPARENT:
       return (DATA_PACKET_DATA_TYPE_SIZE +
               DATA_PACKET_PIXEL_COUNT_SIZE);
     case PACK_PACKED:
       return (DATA_PACKET_DATA_TYPE_SIZE +
               DATA_PACKET_PIXEL_COUNT_SIZE +
-              bpp);
+              bpp_);
     case PACK_EOL:
       return (DATA_PACKET_DATA_TYPE_SIZE);
     }
@@ -152,13 +222,13 @@ PackedDataPacket::size_in_bits() const
 }
 
 u32
-PackedDataPacket::raw_literal_size() const
+PackedDataPacket::raw_literal_size(const u32 bpp_) const
 {
   switch(type)
     {
     case PACK_LITERAL:
     case PACK_PACKED:
-      return (pixels.size() * bpp);
+      return (count * bpp_);
     case PACK_TRANSPARENT:
     case PACK_EOL:
       return 0;
@@ -167,16 +237,22 @@ PackedDataPacket::raw_literal_size() const
   return 0;
 }
 
-u32
-AbstractPackedImage::size_in_bits() const
+void
+AbstractPackedImage::resize(const u32 w_,
+                            const u32 h_)
 {
-  u32 c;
-
-  c = 0;
-  for(const auto &pdpvec : *this)
-    c += pdpvec.size_in_bits();
+  line_width = w_;
+  pixels.resize((size_t)w_ * h_);
+  packets.resize((size_t)w_ * h_);
+  counts.assign(h_,0);
+}
 
-  return c;
+PackedDataPacketRow
+AbstractPackedImage::row(const size_t y_)
+{
+  return PackedDataPacketRow(packets.data() + (y_ * line_width),
+                             counts[y_],
+                             line_width);
 }
 
 static
@@ -200,305 +276,639 @@ calc_offset_width(const std::size_t bpp_)
 
 #define ALPHA 0xFFFFFFFF
 
+// Passes 0 through 7 only touch a row's own pixels, packet slots and
+// bitstream so they run over blocks of at least 64K pixels worth of
+// rows on the thread pool.
+template<typename Func>
+static
+void
+for_each_row_block(const AbstractPackedImage &api_,
+                   const Func                &fn_)
+{
+  size_t rows_per_block;
+  size_t blocks;
+
+  rows_per_block = std::max<size_t>((64 * 1024) / std::max<size_t>(api_.line_width,1),1);
+  blocks = ((api_.size() + rows_per_block - 1) / rows_per_block);
+
+  ThreadPool::global().for_each(blocks,
+                                [&](const size_t block_)
+                                {
+                                  fn_(block_ * rows_per_block,
+                                      std::min((block_ + 1) * rows_per_block,
+                                               api_.size()));
+                                });
+}
+
 static
 void
 pass0_build_api_from_bitmap(const Bitmap            &b_,
                             const RGBA8888Converter &pc_,
-                            AbstractPackedImage     &api_)
+                            AbstractPackedImage     &api_,
+                            const size_t             y_)
 {
-  api_.bpp = pc_.bpp();
-  api_.line_width = b_.w;
-  api_.offset_width = ::calc_offset_width(pc_.bpp());
-  api_.resize(b_.h);
-  for(size_t y = 0; y < b_.h; y++)
-    {
-      PackedDataPacketVec &pdpvec = api_[y];
+  PackedDataPacketRow row = api_.row(y_);
 
-      for(size_t x = 0; x < b_.w; x++)
-        {
-          RGBA8888 p;
-          PackedDataPacket pdp;
-          u32 c;
-
-          // If alpha is 0 then zero out the color to make packing
-          // easier later
-          p = *b_.xy(x,y);
+  for(size_t x = 0; x < b_.w; x++)
+    {
+      RGBA8888 p;
+      u32 c;
+      u32 idx;
 
-          if(p.a == 0)
-            c = ALPHA;
-          else
-            c = pc_.convert(&p);
+      // If alpha is 0 then zero out the color to make packing
+      // easier later
+      p = *b_.xy(x,y_);
 
-          pdp.type = PACK_LITERAL;
-          pdp.bpp  = pc_.bpp();
-          pdp.pixels.emplace_back(c);
+      if(p.a == 0)
+        c = ALPHA;
+      else
+        c = pc_.convert(&p);
 
-          pdpvec.emplace_back(pdp);
-        }
+      idx = ((y_ * b_.w) + x);
+      api_.pixels[idx] = c;
+      row.emplace_back(PACK_LITERAL,idx,1);
     }
 }
 
 static
 void
-pass1_pack_packed(AbstractPackedImage &api_)
+pass1_pack_packed(AbstractPackedImage &api_,
+                  const size_t         y_)
 {
-  for(auto &pdpvec : api_)
-    {
-      PackedDataPacketVec newpdpvec;
+  size_t n;
+  const u32 *px = api_.pixels.data();
+  PackedDataPacketRow row = api_.row(y_);
 
-      newpdpvec.emplace_back(pdpvec[0]);
+  if(row.empty())
+    return;
 
-      for(size_t i = 1; i < pdpvec.size(); i++)
-        {
-          PackedDataPacket &curpdp = pdpvec[i];
-          PackedDataPacket &newpdp = newpdpvec.back();
+  n = 1;
+  for(size_t i = 1; i < row.size(); i++)
+    {
+      const PackedDataPacket  curpdp = row[i];
+      PackedDataPacket       &newpdp = row[n-1];
 
-          if(curpdp.pixels[0] == newpdp.pixels[0])
-            {
-              newpdp.type = PACK_PACKED;
-              newpdp.pixels.emplace_back(curpdp.pixels[0]);
-            }
-          else
-            {
-              newpdpvec.emplace_back(pdpvec[i]);
-            }
+      if(px[curpdp.start] == px[newpdp.start])
+        {
+          newpdp.type   = PACK_PACKED;
+          newpdp.count += curpdp.count;
+        }
+      else
+        {
+          row[n++] = curpdp;
         }
-
-      pdpvec = newpdpvec;
     }
+
+  row.resize(n);
 }
 
 static
 void
-pass2_mark_transparents(AbstractPackedImage &api_)
+pass2_mark_transparents(AbstractPackedImage &api_,
+                        const size_t         y_)
 {
-  for(auto &pdpvec : api_)
+  const u32 *px = api_.pixels.data();
+
+  for(auto &pdp : api_.row(y_))
     {
-      for(auto &pdp : pdpvec)
-        {
-          if(pdp.pixels[0] != ALPHA)
-            continue;
+      if(px[pdp.start] != ALPHA)
+        continue;
 
-          pdp.type = PACK_TRANSPARENT;
-        }
+      pdp.type = PACK_TRANSPARENT;
     }
 }
 
+// Folds pdp_ into newpdp_ when storing both as one literal is no
+// larger. False if they stay separate.
 static
-void
-pass3_compress_literal_and_packed(AbstractPackedImage &api_)
+bool
+combine_packets(PackedDataPacket       &newpdp_,
+                const PackedDataPacket &pdp_,
+                const u32               bpp_)
 {
-  for(auto &pdpvec : api_)
+  if(newpdp_.is_literal() && pdp_.is_literal())
     {
-      PackedDataPacketVec newpdpvec;
+      newpdp_.count += pdp_.count;
+      return true;
+    }
 
-      newpdpvec.emplace_back(pdpvec.front());
+  if(newpdp_.is_literal() && pdp_.is_packed())
+    {
+      if(pdp_.size_in_bits(bpp_) >= pdp_.raw_literal_size(bpp_))
+        {
+          newpdp_.count += pdp_.count;
+          return true;
+        }
+    }
 
-      for(size_t i = 1; i < pdpvec.size(); i++)
+  if(newpdp_.is_packed() && pdp_.is_literal())
+    {
+      if(newpdp_.size_in_bits(bpp_) >= newpdp_.raw_literal_size(bpp_))
         {
-          auto &pdp    = pdpvec[i];
-          auto &newpdp = newpdpvec.back();
+          newpdp_.type   = PACK_LITERAL;
+          newpdp_.count += pdp_.count;
+          return true;
+        }
+    }
 
-          if(newpdp.is_literal() && pdp.is_literal())
-            {
-              for(auto &p : pdp.pixels)
-                newpdp.pixels.emplace_back(p);
-              continue;
-            }
+  return false;
+}
 
-          if(newpdp.is_literal() && pdp.is_packed())
-            {
-              if(pdp.size_in_bits() >= pdp.raw_literal_size())
-                {
-                  for(auto &p : pdp.pixels)
-                    newpdp.pixels.emplace_back(p);
-                  continue;
-                }
-            }
+static
+void
+pass3_compress_literal_and_packed(AbstractPackedImage &api_,
+                                  const size_t         y_)
+{
+  size_t n;
+  const u32 bpp = api_.bpp;
+  PackedDataPacketRow row = api_.row(y_);
 
-          if(newpdp.is_packed() && pdp.is_literal())
-            {
-              if(newpdp.size_in_bits() >= newpdp.raw_literal_size())
-                {
-                  newpdp.type = PACK_LITERAL;
-                  for(auto &p : pdp.pixels)
-                    newpdp.pixels.emplace_back(p);
-                  continue;
-                }
-            }
+  if(row.empty())
+    return;
 
-          newpdpvec.emplace_back(pdp);
-        }
+  n = 1;
+  for(size_t i = 1; i < row.size(); i++)
+    {
+      const PackedDataPacket pdp = row[i];
+
+      if(::combine_packets(row[n-1],pdp,bpp))
+        continue;
 
-      pdpvec = newpdpvec;
+      row[n++] = pdp;
     }
+
+  row.resize(n);
 }
 
+// Combining never grows a row so the image's size is unchanged
+// exactly when no row's is. Every row is run the same number of
+// times as a loop over the whole image would.
 static
 void
 pass3_combine(AbstractPackedImage &api_)
 {
-  size_t prev_size;
-  size_t comp_size;
+  std::atomic<bool> changed;
 
   do
     {
-      prev_size = api_.size_in_bits();
-      pass3_compress_literal_and_packed(api_);
-      comp_size = api_.size_in_bits();
+      changed = false;
+      ::for_each_row_block(api_,
+                           [&](const size_t begin_,
+                               const size_t end_)
+                           {
+                             for(size_t y = begin_; y < end_; y++)
+                               {
+                                 u32 prev_size;
+
+                                 prev_size = api_.row(y).size_in_bits(api_.bpp);
+                                 pass3_compress_literal_and_packed(api_,y);
+                                 if(api_.row(y).size_in_bits(api_.bpp) != prev_size)
+                                   changed = true;
+                               }
+                           });
     }
-  while(comp_size != prev_size);
+  while(changed);
 }
 
+// Splitting only grows a row so it is done back to front.
 static
 void
-pass4_split_large_packets(AbstractPackedImage &api_)
+pass4_split_large_packets(AbstractPackedImage &api_,
+                          const size_t         y_)
 {
-  for(auto &pdpvec : api_)
+  const u32 max_count = 64;
+  size_t i;
+  size_t n;
+  PackedDataPacketRow row = api_.row(y_);
+
+  i = row.size();
+  n = 0;
+  for(const auto &pdp : row)
+    n += ((pdp.count + max_count - 1) / max_count);
+
+  row.resize(n);
+  while(i-- > 0)
     {
-      PackedDataPacketVec newpdpvec;
+      const PackedDataPacket pdp = row[i];
+      u32 count;
+
+      count = (pdp.count % max_count);
+      if(count == 0)
+        count = max_count;
+      for(u32 end = pdp.count; end > 0; end -= count, count = max_count)
+        row[--n] = PackedDataPacket{pdp.type,pdp.start + end - count,count};
+    }
+}
 
-      for(auto &pdp : pdpvec)
-        {
-          PackedDataPacket newpdp;
+static
+void
+pass5_remove_trailing_transparents(AbstractPackedImage &api_,
+                                   const size_t         y_)
+{
+  size_t orig_size;
+  PackedDataPacketRow row = api_.row(y_);
 
-          newpdp.type = pdp.type;
-          auto i  = pdp.pixels.begin();
-          auto ei = pdp.pixels.end();
-          while(i != ei)
-            {
-              newpdp.pixels.clear();
-              for(size_t c = 0; i != ei && c < 64; ++c, ++i)
-                newpdp.pixels.emplace_back(*i);
-              newpdpvec.emplace_back(newpdp);
-            }
-        }
+  orig_size = row.size();
+  while(!row.empty() && row.back().is_transparent())
+    row.resize(row.size() - 1);
 
-      pdpvec = newpdpvec;
-    }
+  if(orig_size != row.size())
+    row.emplace_back(PACK_EOL,0,0);
 }
 
 static
 void
-pass5_remove_trailing_transparents(AbstractPackedImage &api_)
+pass6_remove_trailing_eol(AbstractPackedImage &api_,
+                          const size_t         y_)
 {
-  for(auto &pdpvec : api_)
-    {
-      size_t orig_size;
+  PackedDataPacketRow row = api_.row(y_);
+
+  if(row.pixel_count() < api_.line_width)
+    return;
+
+  while(!row.empty() && row.back().is_eol())
+    row.resize(row.size() - 1);
+}
+
+// Scratch space for pass1_optimal_segmentation() reused by a block
+// of rows.
+struct ShortestPath
+{
+  ShortestPath(const size_t w_)
+    : run(w_ + 1),
+      cost(w_ + 1),
+      prev(w_ + 1),
+      type(w_ + 1)
+  {
+  }
+
+  std::vector<u32> run;
+  std::vector<u32> cost;
+  std::vector<u32> prev;
+  std::vector<u8>  type;
+};
 
-      orig_size = pdpvec.size();
-      while(!pdpvec.empty() && pdpvec.rbegin()->is_transparent())
-        pdpvec.pop_back();
+// Each row is a shortest path problem: node i is "the first i pixels
+// are encoded" and every legal packet starting at i is an edge
+// weighted by its size in bits. Legal packets are literals of up to
+// 64 opaque pixels, packed runs of up to 64 identical opaque pixels
+// and transparent runs of up to 64 transparent pixels. The row ends
+// either full, with no EOL, or with an EOL standing in for all
+// trailing transparent pixels. Every segmentation passes 1 through 6
+// can produce is a path in this graph so the result is never larger
+// per row. Since a row's size in words is monotonic in its size in
+// bits the word padding and 2 word minimum of pass9 are minimal as
+// well. The overlap trimming of pass8 is applied afterwards as usual.
+static
+void
+pass1_optimal_segmentation(AbstractPackedImage &api_,
+                           const size_t         y_,
+                           ShortestPath        &sp_)
+{
+  const u32 hdr = (DATA_PACKET_DATA_TYPE_SIZE + DATA_PACKET_PIXEL_COUNT_SIZE);
+  const u32 max_count = 64;
+  const size_t w = api_.line_width;
+  size_t end;
+  size_t packets;
+  size_t tail;
+  u32 best;
+  const u32 *px = &api_.pixels[y_ * w];
+  PackedDataPacketRow row = api_.row(y_);
+
+  // run[i]: number of identical pixels starting at i
+  sp_.run[w] = 0;
+  for(size_t i = w; i-- > 0;)
+    sp_.run[i] = (((i + 1) < w && px[i] == px[i+1]) ? sp_.run[i+1] + 1 : 1);
+
+  std::fill(sp_.cost.begin(),sp_.cost.end(),std::numeric_limits<u32>::max());
+  sp_.cost[0] = 0;
+
+  auto relax = [&](const size_t i_,
+                   const size_t n_,
+                   const u32    bits_,
+                   const u8     type_)
+  {
+    if((sp_.cost[i_] + bits_) >= sp_.cost[i_ + n_])
+      return;
+    sp_.cost[i_ + n_] = (sp_.cost[i_] + bits_);
+    sp_.prev[i_ + n_] = i_;
+    sp_.type[i_ + n_] = type_;
+  };
+
+  for(size_t i = 0; i < w; i++)
+    {
+      size_t max_n;
 
-      if(orig_size != pdpvec.size())
+      max_n = std::min<size_t>(max_count,(w - i));
+      if(px[i] == ALPHA)
         {
-          pdpvec.emplace_back();
-          pdpvec.rbegin()->type = PACK_EOL;
+          for(size_t n = 1; n <= std::min<size_t>(sp_.run[i],max_n); n++)
+            relax(i,n,hdr,PACK_TRANSPARENT);
+          continue;
         }
+
+      for(size_t n = 2; n <= std::min<size_t>(sp_.run[i],max_n); n++)
+        relax(i,n,hdr + api_.bpp,PACK_PACKED);
+      for(size_t n = 1; (n <= max_n) && (px[i+n-1] != ALPHA); n++)
+        relax(i,n,hdr + (n * api_.bpp),PACK_LITERAL);
     }
+
+  // Ending early with an EOL is only possible once the remainder
+  // of the row is transparent.
+  tail = w;
+  while((tail > 0) && (px[tail-1] == ALPHA))
+    tail--;
+
+  end  = w;
+  best = sp_.cost[w];
+  for(size_t i = tail; i < w; i++)
+    {
+      if((sp_.cost[i] + DATA_PACKET_DATA_TYPE_SIZE) >= best)
+        continue;
+      end  = i;
+      best = (sp_.cost[i] + DATA_PACKET_DATA_TYPE_SIZE);
+    }
+
+  packets = 0;
+  for(size_t i = end; i > 0; i = sp_.prev[i])
+    packets++;
+
+  row.resize(packets);
+  for(size_t i = end; i > 0; i = sp_.prev[i])
+    row[--packets] = PackedDataPacket{sp_.type[i],(u32)((y_ * w) + sp_.prev[i]),(u32)(i - sp_.prev[i])};
+
+  if(end != w)
+    row.emplace_back(PACK_EOL,0,0);
 }
 
 static
 void
-pass6_remove_trailing_eol(AbstractPackedImage &api_)
+write_row_bitstream(AbstractPackedImage &api_,
+                    const size_t         y_,
+                    BitStream           &row_)
 {
-  for(auto &pdpvec : api_)
-    {
-      if(pdpvec.pixel_count() < api_.line_width)
-        continue;
+  const u32 *px = api_.pixels.data();
+  const auto pdprow = api_.row(y_);
+
+  row_ = BitStream();
+
+  // Rows are padded to at least two words in pass9
+  row_.reserve(api_.offset_width + pdprow.size_in_bits(api_.bpp) + (2 * BITS_PER_WORD));
 
-      while(!pdpvec.empty() && pdpvec.rbegin()->is_eol())
-        pdpvec.pop_back();
+  // Reserve space for the offset
+  row_.write(api_.offset_width,0);
+  for(const auto &pdp : pdprow)
+    {
+      row_.write(DATA_PACKET_DATA_TYPE_SIZE,pdp.type);
+      switch(pdp.type)
+        {
+        case PACK_PACKED:
+          row_.write(DATA_PACKET_PIXEL_COUNT_SIZE,
+                     pdp.count-1);
+          row_.write(api_.bpp,
+                     px[pdp.start]);
+          break;
+        case PACK_LITERAL:
+          row_.write(DATA_PACKET_PIXEL_COUNT_SIZE,
+                     pdp.count-1);
+          row_.write_n(api_.bpp,
+                       &px[pdp.start],
+                       pdp.count);
+          break;
+        case PACK_TRANSPARENT:
+          row_.write(DATA_PACKET_PIXEL_COUNT_SIZE,
+                     pdp.count-1);
+          break;
+        case PACK_EOL:
+          break;
+        }
     }
+
+  // Needs to be done in prep for overlap pass
+  {
+    int word_offset;
+
+    word_offset = std::max((uint64_t)2,
+                           row_.tell_32bits_round_up());
+    row_.write(0,
+               api_.offset_width,
+               (word_offset - 2));
+  }
 }
 
 static
 void
-pass7_api_to_bitstreams(const AbstractPackedImage &api_,
-                        BitStreamVec              &rows_)
+pass7_api_to_bitstream(AbstractPackedImage &api_,
+                       const size_t         y_,
+                       BitStreamVec        &rows_)
 {
-  rows_.clear();
-  rows_.resize(api_.size());
-  for(size_t i = 0; i < api_.size(); i++)
-    {
-      const auto &pdpvec = api_[i];
-      auto       &row    = rows_[i];
+  ::write_row_bitstream(api_,y_,rows_[y_]);
+}
+
+// Word j_ of a row as pass9 will store it: bits past the end of the
+// row are zero padding and a row is at least 2 words.
+static
+u32
+row_word(const BitStream &row_,
+         const u64        j_)
+{
+  u32 word;
+  u64 bits;
+  const auto &data = row_.data();
+
+  bits = row_.tell_bits();
+  if((j_ * BITS_PER_WORD) >= bits)
+    return 0;
+
+  word = 0;
+  for(u64 i = (j_ * 4); i < ((j_ * 4) + 4); i++)
+    word = ((word << 8) | ((i < data.size()) ? data[i] : 0));
+  if(((j_ + 1) * BITS_PER_WORD) > bits)
+    word &= (0xFFFFFFFF << (((j_ + 1) * BITS_PER_WORD) - bits));
+
+  return word;
+}
+
+static
+u64
+row_stored_words(const BitStream &row_)
+{
+  return std::max((u64)2,(u64)row_.tell_32bits_round_up());
+}
 
-      // Reserve space for the offset
-      row.write(api_.offset_width,0);
-      for(const auto &pdp : pdpvec)
+// Smallest word offset s >= 2 at which the words of row_ from s on
+// equal the words stored after it in next_. Only the bits the row
+// actually uses need to match so its last partial word is compared
+// under a mask. lcp(row_[s..],next_) for every s comes from the Z
+// function of next_ + separator + row_ so the search is linear.
+static
+u64
+min_row_advance(const BitStream       &row_,
+                const std::vector<u32> &next_,
+                std::vector<u64>       &s_,
+                std::vector<u64>       &z_)
+{
+  u64 bits;
+  u64 full;
+  u64 rem;
+  u64 total;
+  u64 m;
+  u64 n;
+  u32 mask;
+
+  bits  = row_.tell_bits();
+  full  = (bits / BITS_PER_WORD);
+  rem   = (bits % BITS_PER_WORD);
+  mask  = (u32)(0xFFFFFFFFULL << (BITS_PER_WORD - rem));
+  total = row_stored_words(row_);
+  if(total <= 2)
+    return total;
+
+  m = next_.size();
+  s_.clear();
+  s_.insert(s_.end(),next_.begin(),next_.end());
+  s_.push_back(1ULL << 32);
+  for(u64 j = 0; j < full; j++)
+    s_.push_back(::row_word(row_,j));
+
+  n = s_.size();
+  z_.assign(n,0);
+  for(u64 i = 1, l = 0, r = 0; i < n; i++)
+    {
+      if(i < r)
+        z_[i] = std::min(r - i,z_[i - l]);
+      while(((i + z_[i]) < n) && (s_[z_[i]] == s_[i + z_[i]]))
+        z_[i]++;
+      if((i + z_[i]) > r)
         {
-          row.write(DATA_PACKET_DATA_TYPE_SIZE,pdp.type);
-          switch(pdp.type)
-            {
-            case PACK_PACKED:
-              row.write(DATA_PACKET_PIXEL_COUNT_SIZE,
-                        pdp.pixels.size()-1);
-              row.write(api_.bpp,
-                        pdp.pixels[0]);
-              break;
-            case PACK_LITERAL:
-              row.write(DATA_PACKET_PIXEL_COUNT_SIZE,
-                        pdp.pixels.size()-1);
-              for(const auto pixel : pdp.pixels)
-                row.write(api_.bpp,pixel);
-              break;
-            case PACK_TRANSPARENT:
-              row.write(DATA_PACKET_PIXEL_COUNT_SIZE,
-                        pdp.pixels.size()-1);
-              break;
-            case PACK_EOL:
-              break;
-            }
+          l = i;
+          r = (i + z_[i]);
         }
+    }
 
-      // Needs to be done in prep for overlap pass
-      {
-        int word_offset;
+  for(u64 s = 2; s < total; s++)
+    {
+      u64 lcp;
 
-        word_offset = std::max((uint64_t)2,
-                               row.tell_32bits_round_up());
-        row.write(0,
-                  api_.offset_width,
-                  (word_offset - 2));
-      }
+      lcp = ((s < full) ? z_[m + 1 + s] : 0);
+      if(lcp < (full - std::min(s,full)))
+        continue;
+      if(rem == 0)
+        return s;
+      if((full - s) >= m)
+        continue;
+      if(((::row_word(row_,full) ^ next_[full - s]) & mask) == 0)
+        return s;
     }
+
+  return total;
 }
 
-// The overlap in theory could be from word 3 to the end of the
-// row but in practice this is extremely unlikely. For the moment just
-// checking the trailing bits % 32bit word.
+// The overlap in theory could be anywhere from word 3 to the end of
+// the row. Rows are finished bottom up so the words following each
+// row, which may themselves run on into later rows, are final when
+// it is compared against them. A single pixel packet costs the same
+// as a literal or a packed packet so the last few of those in a row
+// are tried both ways in case that lines up a longer overlap.
 static
-void
-pass8_trim_overlap(const AbstractPackedImage &api_,
-                   BitStreamVec              &rows_)
+bool
+pass8_trim_overlap(AbstractPackedImage      &api_,
+                   BitStreamVec             &rows_,
+                   const CelPacker::Abandon &abandon_)
 {
-  for(size_t i = 0; i < (rows_.size() - 1); i++)
+  const size_t max_alts = 4;
+  u64 done;
+  std::vector<u32> next;
+  std::vector<u64> s;
+  std::vector<u64> z;
+  std::vector<PackedDataPacket*> alts;
+  BitStream alt;
+
+  if(rows_.empty())
+    return true;
+
+  done = 0;
+  for(size_t i = (rows_.size() - 1); i-- > 0;)
     {
-      if(rows_[i].tell_32bits_round_up() <= 2)
+      u64 best;
+      u64 best_mask;
+      u64 words;
+      PackedDataPacketRow row = api_.row(i);
+
+      // The rows after this one are final and none is under 2 words.
+      done += row_stored_words(rows_[i+1]);
+      if(abandon_ && abandon_((done + (2 * (i + 1))) * BYTES_PER_WORD))
+        return false;
+
+      words = row_stored_words(rows_[i]);
+      if(words <= 2)
         continue;
 
-      bool overlap;
-      int trailing_bits;
-      BitStream &a = rows_[i+0];
-      BitStream &b = rows_[i+1];
+      next.clear();
+      for(size_t r = (i + 1); (r < rows_.size()) && (next.size() < words); r++)
+        {
+          u64 n = row_stored_words(rows_[r]);
+          for(u64 j = 0; (j < n) && (next.size() < words); j++)
+            next.push_back(::row_word(rows_[r],j));
+        }
+
+      alts.clear();
+      for(size_t p = row.size(); (p-- > 0) && (alts.size() < max_alts);)
+        {
+          if((row[p].count == 1) && (row[p].is_literal() || row[p].is_packed()))
+            alts.push_back(&row[p]);
+        }
+
+      best      = ::min_row_advance(rows_[i],next,s,z);
+      best_mask = 0;
+      for(u64 mask = 1; (mask < (1ULL << alts.size())) && (best > 2); mask++)
+        {
+          u64 advance;
+
+          for(size_t a = 0; a < alts.size(); a++)
+            {
+              if(mask & (1ULL << a))
+                alts[a]->type ^= (PACK_LITERAL ^ PACK_PACKED);
+            }
+
+          ::write_row_bitstream(api_,i,alt);
+          advance = ::min_row_advance(alt,next,s,z);
+
+          for(size_t a = 0; a < alts.size(); a++)
+            {
+              if(mask & (1ULL << a))
+                alts[a]->type ^= (PACK_LITERAL ^ PACK_PACKED);
+            }
 
-      trailing_bits = (a.tell_bits() & 31);
-      if(trailing_bits == 0)
-        trailing_bits = 32;
+          if(advance >= best)
+            continue;
+          best      = advance;
+          best_mask = mask;
+        }
 
-      overlap = a.cmp(a.tell_bits() - trailing_bits,
-                      b,0,
-                      trailing_bits);
-      if(!overlap)
+      if(best >= words)
         continue;
 
-      a.rewind(trailing_bits);
+      if(best_mask)
+        {
+          for(size_t a = 0; a < alts.size(); a++)
+            {
+              if(best_mask & (1ULL << a))
+                alts[a]->type ^= (PACK_LITERAL ^ PACK_PACKED);
+            }
+          ::write_row_bitstream(api_,i,rows_[i]);
+        }
+
+      BitStream &a = rows_[i];
+
+      a.rewind(a.tell_bits() - (best * BITS_PER_WORD));
       a.shrink_to_idx();
       a.write(0,
               api_.offset_width,
-              (a.tell_32bits_round_up() - 2));
+              (best - 2));
     }
+
+  return true;
 }
 
 static
@@ -530,23 +940,148 @@ pass10_bsvec_to_bytevec(const BitStreamVec &rows_,
     }
 }
 
-void
+CelPacker::Mode
+CelPacker::mode(const Bitmap &b_)
+{
+  if(b_.has("pack-optimal"))
+    return Mode::OPTIMAL;
+  return Mode::HEURISTIC;
+}
+
+bool
 CelPacker::pack(const Bitmap            &b_,
                 const RGBA8888Converter &pc_,
-                ByteVec                 &pdat_)
+                ByteVec                 &pdat_,
+                const Mode               mode_,
+                const Abandon           &abandon_)
 {
   AbstractPackedImage api;
   BitStreamVec rows;
 
-  pass0_build_api_from_bitmap(b_,pc_,api);
-  pass1_pack_packed(api);
-  pass2_mark_transparents(api);
-  pass3_combine(api);
-  pass4_split_large_packets(api);
-  pass5_remove_trailing_transparents(api);
-  pass6_remove_trailing_eol(api);
-  pass7_api_to_bitstreams(api,rows);
-  pass8_trim_overlap(api,rows);
+  api.bpp = pc_.bpp();
+  api.offset_width = ::calc_offset_width(pc_.bpp());
+  api.resize(b_.w,b_.h);
+  rows.resize(api.size());
+
+  if(mode_ == Mode::OPTIMAL)
+    {
+      ::for_each_row_block(api,
+                           [&](const size_t begin_,
+                               const size_t end_)
+                           {
+                             ShortestPath sp(api.line_width);
+
+                             for(size_t y = begin_; y < end_; y++)
+                               {
+                                 pass0_build_api_from_bitmap(b_,pc_,api,y);
+                                 pass1_optimal_segmentation(api,y,sp);
+                                 pass7_api_to_bitstream(api,y,rows);
+                               }
+                           });
+    }
+  else
+    {
+      ::for_each_row_block(api,
+                           [&](const size_t begin_,
+                               const size_t end_)
+                           {
+                             for(size_t y = begin_; y < end_; y++)
+                               {
+                                 pass0_build_api_from_bitmap(b_,pc_,api,y);
+                                 pass1_pack_packed(api,y);
+                                 pass2_mark_transparents(api,y);
+                               }
+                           });
+      pass3_combine(api);
+      ::for_each_row_block(api,
+                           [&](const size_t begin_,
+                               const size_t end_)
+                           {
+                             for(size_t y = begin_; y < end_; y++)
+                               {
+                                 pass4_split_large_packets(api,y);
+                                 pass5_remove_trailing_transparents(api,y);
+                                 pass6_remove_trailing_eol(api,y);
+                                 pass7_api_to_bitstream(api,y,rows);
+                               }
+                           });
+    }
+  if(!pass8_trim_overlap(api,rows,abandon_))
+    {
+      pdat_.clear();
+      return false;
+    }
   pass9_pad_rows(rows);
   pass10_bsvec_to_bytevec(rows,pdat_);
+
+  return true;
 };
+
+// Passes 1 through 6 and the padding of pass9 over runs rather than
+// pixels. Splitting and the trailing EOL only change the row's size
+// so they are counted rather than applied.
+u64
+CelPacker::row_size(const RunVec &runs_,
+                    const u32     bpp_)
+{
+  const u32 max_count = 64;
+  u64 bits;
+  u64 prev_bits;
+  std::vector<PackedDataPacket> row;
+
+  row.reserve(runs_.size());
+  for(const auto &run : runs_)
+    {
+      if(run.transparent)
+        row.emplace_back(PackedDataPacket{PACK_TRANSPARENT,0,run.count});
+      else if(run.count > 1)
+        row.emplace_back(PackedDataPacket{PACK_PACKED,0,run.count});
+      else
+        row.emplace_back(PackedDataPacket{PACK_LITERAL,0,run.count});
+    }
+
+  bits = 0;
+  do
+    {
+      size_t n;
+
+      prev_bits = bits;
+      n = std::min<size_t>(row.size(),1);
+      for(size_t i = 1; i < row.size(); i++)
+        {
+          const PackedDataPacket pdp = row[i];
+
+          if(::combine_packets(row[n-1],pdp,bpp_))
+            continue;
+
+          row[n++] = pdp;
+        }
+      row.resize(n);
+
+      bits = 0;
+      for(const auto &pdp : row)
+        bits += pdp.size_in_bits(bpp_);
+    }
+  while(bits != prev_bits);
+
+  if(!row.empty() && row.back().is_transparent())
+    {
+      row.pop_back();
+      row.emplace_back(PackedDataPacket{PACK_EOL,0,0});
+    }
+
+  bits = ::calc_offset_width(bpp_);
+  for(const auto &pdp : row)
+    {
+      u32 full;
+      u32 rest;
+
+      full = (pdp.count / max_count);
+      rest = (pdp.count % max_count);
+      bits += (full * PackedDataPacket{pdp.type,0,max_count}.size_in_bits(bpp_));
+      if(rest || pdp.is_eol())
+        bits += PackedDataPacket{pdp.type,0,rest}.size_in_bits(bpp_);
+    }
+
+  return (std::max<u64>((bits + BITS_PER_WORD - 1) / BITS_PER_WORD,2) * BYTES_PER_WORD);
+}
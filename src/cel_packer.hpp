@@ -21,14 +21,50 @@
 #include "bitmap.hpp"
 #include "bytevec.hpp"
 #include "pixel_converter.hpp"
+#include "types_ints.h"
 
 #include <cstdint>
+#include <functional>
+#include <vector>
 
 
 namespace CelPacker
 {
-  void
+  // HEURISTIC is the original multi-pass packer. OPTIMAL finds the
+  // smallest legal segmentation of each row.
+  enum class Mode
+    {
+      HEURISTIC,
+      OPTIMAL
+    };
+
+  // Called with a lower bound on the PDAT's size in bytes as packing
+  // proceeds. Returning true abandons it.
+  typedef std::function<bool(const u64)> Abandon;
+
+  // OPTIMAL if to-cel --pack-optimal marked the bitmap.
+  Mode mode(const Bitmap &b_);
+
+  // False, leaving pdat_ empty, if abandoned.
+  bool
   pack(const Bitmap            &b_,
        const RGBA8888Converter &pc_,
-       ByteVec                 &pdat_);
+       ByteVec                 &pdat_,
+       const Mode               mode_    = Mode::HEURISTIC,
+       const Abandon           &abandon_ = Abandon());
+
+  // A row's pixels as runs of identical converted colors.
+  struct Run
+  {
+    u32  count;
+    bool transparent;
+  };
+
+  typedef std::vector<Run> RunVec;
+
+  // Bytes the HEURISTIC packer stores a row of these runs in before
+  // overlapping it with the following rows. Uses the same packet
+  // sizes and combining rules without building a bitstream.
+  u64 row_size(const RunVec &runs,
+               const u32     bpp);
 }
@@ -0,0 +1,497 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "cel_search.hpp"
+
+#include "bpp.hpp"
+#include "cel_control_chunk.hpp"
+#include "cel_packer.hpp"
+#include "chunk_sizes.hpp"
+#include "convert.hpp"
+#include "palette_cache.hpp"
+#include "pixel_converter.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace l
+{
+  typedef std::shared_ptr<const PaletteCache::Palette> PalettePtr;
+
+  static const std::array<u8,6> BPPS = {1,2,4,6,8,16};
+  static const size_t CANDIDATES = (BPPS.size() * 2 * 2);
+
+  typedef std::array<CelSearch::Sizes,CANDIDATES> SizesArray;
+
+  // Enough rows of an image to order candidates by.
+  static const size_t RANKING_ROWS = 32;
+
+  // The k_th type in the order the serial loops tried them.
+  static
+  CelType
+  celtype(const size_t k_)
+  {
+    CelType celtype;
+
+    celtype.switchable = 0;
+    celtype.bpp        = BPPS[k_ / 4];
+    celtype.lrform     = false;
+    celtype.packed     = ((k_ / 2) & 1);
+    celtype.coded      = (k_ & 1);
+
+    return celtype;
+  }
+
+  // The PLUT every coded candidate of this rotation shares. Empty if
+  // no coded type can hold colors_ colors.
+  static
+  PalettePtr
+  palette(const Bitmap &bitmap_,
+          const u64     colors_)
+  {
+    std::shared_ptr<PaletteCache::Palette> palette;
+
+    if(colors_ > (u64)convert::coded_colors(BPP_16))
+      return {};
+
+    if(bitmap_.has("external-palette"))
+      {
+        try
+          {
+            return PaletteCache::get(bitmap_.get("external-palette"));
+          }
+        catch(const std::runtime_error &e_)
+          {
+            return {};
+          }
+      }
+
+    palette = std::make_shared<PaletteCache::Palette>();
+    palette->plut.build(bitmap_);
+
+    return palette;
+  }
+
+  // Uncoded CELs are 8 or 16bpp. Coded ones need a PLUT and no more
+  // colors than the bpp can index.
+  static
+  bool
+  feasible(const CelType                &celtype_,
+           const u64                     colors_,
+           const PaletteCache::Palette  *palette_)
+  {
+    if(!celtype_.coded)
+      return ((celtype_.bpp == BPP_8) || (celtype_.bpp == BPP_16));
+
+    return (palette_ && (colors_ <= (u64)convert::coded_colors(celtype_.bpp)));
+  }
+
+  // What the unpacked encoders produce: rows padded to a word and,
+  // when coded, to at least 2 words.
+  static
+  u64
+  unpacked_size(const Bitmap  &bitmap_,
+                const CelType &celtype_)
+  {
+    u64 row_bits;
+
+    row_bits = (bitmap_.w * celtype_.bpp);
+    row_bits = (((row_bits + 31) / 32) * 32);
+    if(celtype_.coded)
+      row_bits = std::max<u64>(row_bits,64);
+
+    return ((row_bits / 8) * bitmap_.h);
+  }
+
+  static
+  u64
+  plut_size(const CelType &celtype_,
+            const PLUT    &plut_)
+  {
+    u64 entries;
+
+    if(!celtype_.coded || plut_.empty())
+      return 0;
+
+    entries = std::max<u64>(plut_.size(),plut_.min_size(celtype_.bpp));
+
+    return (CHUNK_HDR_SIZE + CHUNK_PLUT_SIZE_SIZE + (entries * CHUNK_PLUT_VAL_SIZE));
+  }
+
+  static const u32 TRANSPARENT = 0xFFFFFFFF;
+
+  static
+  void
+  extend(CelPacker::RunVec &runs_,
+         u32               &prev_,
+         const u32          color_)
+  {
+    if(!runs_.empty() && (color_ == prev_))
+      {
+        runs_.back().count++;
+        return;
+      }
+
+    runs_.emplace_back(CelPacker::Run{1,(color_ == TRANSPARENT)});
+    prev_ = color_;
+  }
+
+  // A row's runs of the colors uncoded 8bpp stores (RGB332) and of
+  // those every other type stores (RGB0555, which a built PLUT maps
+  // one to one to indexes). Pixels equal to the one before only
+  // extend the runs.
+  static
+  void
+  row_runs(const Bitmap      &bitmap_,
+           const size_t       y_,
+           CelPacker::RunVec &runs332_,
+           CelPacker::RunVec &runs555_)
+  {
+    u32 prev332;
+    u32 prev555;
+    const RGBA8888 *prev;
+
+    runs332_.clear();
+    runs555_.clear();
+    prev = nullptr;
+    prev332 = prev555 = TRANSPARENT;
+    for(size_t x = 0; x < bitmap_.w; x++)
+      {
+        const RGBA8888 *p = bitmap_.xy(x,y_);
+
+        if(prev && (*p == *prev))
+          {
+            runs332_.back().count++;
+            runs555_.back().count++;
+            continue;
+          }
+
+        prev = p;
+        if(p->a == 0)
+          {
+            l::extend(runs332_,prev332,TRANSPARENT);
+            l::extend(runs555_,prev555,TRANSPARENT);
+            continue;
+          }
+
+        l::extend(runs332_,prev332,RGBA8888Converter::to_rgb332(p));
+        l::extend(runs555_,prev555,RGBA8888Converter::to_rgb0555(p));
+      }
+  }
+
+  // Fills in the feasible candidates of estimates_. Packed sizes
+  // are summed over rows_ evenly spaced rows, or all of them if 0,
+  // and scaled to the full height. Rows are handled in blocks across
+  // the thread pool.
+  static
+  void
+  estimate(const Bitmap                 &bitmap_,
+           const u64                     colors_,
+           const PaletteCache::Palette  *palette_,
+           const size_t                  rows_,
+           SizesArray                   &estimates_)
+  {
+    size_t rows;
+    size_t blocks;
+    size_t rows_per_block;
+    std::vector<size_t> packed;
+    std::vector<std::array<u64,CANDIDATES>> sums;
+
+    for(size_t k = 0; k < CANDIDATES; k++)
+      {
+        const CelType celtype = l::celtype(k);
+
+        if(celtype.packed && l::feasible(celtype,colors_,palette_))
+          packed.emplace_back(k);
+      }
+
+    rows = (((rows_ == 0) || (rows_ > bitmap_.h)) ? bitmap_.h : rows_);
+    rows_per_block = std::max<size_t>((64 * 1024) / std::max<size_t>(bitmap_.w,1),1);
+    blocks = ((rows + rows_per_block - 1) / rows_per_block);
+    sums.resize(blocks);
+    ThreadPool::global().for_each(blocks,
+                                  [&](const size_t block_)
+                                  {
+                                    size_t end;
+                                    CelPacker::RunVec runs332;
+                                    CelPacker::RunVec runs555;
+
+                                    sums[block_].fill(0);
+                                    end = std::min<size_t>((block_ + 1) * rows_per_block,rows);
+                                    for(size_t i = (block_ * rows_per_block); i < end; i++)
+                                      {
+                                        l::row_runs(bitmap_,((i * bitmap_.h) / rows),runs332,runs555);
+                                        for(const auto k : packed)
+                                          {
+                                            const CelType celtype = l::celtype(k);
+                                            const bool rgb332 = (!celtype.coded && (celtype.bpp == BPP_8));
+
+                                            sums[block_][k] += CelPacker::row_size((rgb332 ? runs332 : runs555),
+                                                                                   celtype.bpp);
+                                          }
+                                      }
+                                  });
+
+    for(size_t k = 0; k < CANDIDATES; k++)
+      {
+        u64 sum;
+        CelSearch::Sizes &estimate = estimates_[k];
+
+        estimate.celtype = l::celtype(k);
+        if(!l::feasible(estimate.celtype,colors_,palette_))
+          continue;
+
+        estimate.ccb  = sizeof(CelControlChunk);
+        estimate.pdat = CHUNK_HDR_SIZE;
+        estimate.plut = (palette_ ? l::plut_size(estimate.celtype,palette_->plut) : 0);
+        if(!estimate.celtype.packed)
+          {
+            estimate.pdat += l::unpacked_size(bitmap_,estimate.celtype);
+            continue;
+          }
+
+        sum = 0;
+        for(const auto &block : sums)
+          sum += block[k];
+        estimate.pdat += ((rows == bitmap_.h) ? sum : ((sum * bitmap_.h) / rows));
+      }
+  }
+
+  // Feasible candidates, smallest estimated PDAT first.
+  static
+  std::vector<size_t>
+  ranked(const SizesArray            &estimates_,
+         const u64                    colors_,
+         const PaletteCache::Palette *palette_)
+  {
+    std::vector<size_t> ks;
+
+    for(size_t k = 0; k < CANDIDATES; k++)
+      {
+        if(l::feasible(l::celtype(k),colors_,palette_))
+          ks.emplace_back(k);
+      }
+
+    std::stable_sort(ks.begin(),
+                     ks.end(),
+                     [&](const size_t a_,
+                         const size_t b_)
+                     {
+                       return (estimates_[a_].pdat < estimates_[b_].pdat);
+                     });
+
+    return ks;
+  }
+
+  // False if abandon_ gave up on it.
+  static
+  bool
+  encode(const Bitmap                 &bitmap_,
+         const CelType                &celtype_,
+         const PaletteCache::Palette  *palette_,
+         const CelPacker::Abandon     &abandon_,
+         CelSearch::Result            &result_)
+  {
+    result_.celtype = celtype_;
+
+    if(!celtype_.packed)
+      {
+        if(abandon_ && abandon_(l::unpacked_size(bitmap_,celtype_)))
+          return false;
+
+        if(!celtype_.coded)
+          {
+            convert::bitmap_to_cel(bitmap_,celtype_,result_.pdat,result_.plut);
+            return true;
+          }
+
+        result_.plut = palette_->plut;
+        convert::bitmap_to_coded_unpacked_linear(bitmap_,
+                                                 celtype_.bpp,
+                                                 palette_->plut,
+                                                 result_.pdat);
+        return true;
+      }
+
+    if(!celtype_.coded)
+      return CelPacker::pack(bitmap_,
+                             RGBA8888Converter(celtype_.bpp),
+                             result_.pdat,
+                             CelPacker::mode(bitmap_),
+                             abandon_);
+
+    result_.plut = palette_->plut;
+    return CelPacker::pack(bitmap_,
+                           RGBA8888Converter(celtype_.bpp,palette_->plut),
+                           result_.pdat,
+                           CelPacker::mode(bitmap_),
+                           abandon_);
+  }
+}
+
+void
+CelSearch::all(const Bitmap &bitmap_,
+               ResultVec    &results_)
+{
+  u64 colors;
+  l::PalettePtr palette;
+  std::vector<CelType> celtypes;
+  std::vector<Result> results;
+  std::vector<char> ok;
+
+  colors  = bitmap_.color_count();
+  palette = l::palette(bitmap_,colors);
+  for(size_t k = 0; k < l::CANDIDATES; k++)
+    {
+      if(l::feasible(l::celtype(k),colors,palette.get()))
+        celtypes.emplace_back(l::celtype(k));
+    }
+
+  results.resize(celtypes.size());
+  ok.resize(celtypes.size(),false);
+  ThreadPool::global().for_each(celtypes.size(),
+                                [&](const size_t i_)
+                                {
+                                  try
+                                    {
+                                      ok[i_] = l::encode(bitmap_,
+                                                         celtypes[i_],
+                                                         palette.get(),
+                                                         CelPacker::Abandon(),
+                                                         results[i_]);
+                                    }
+                                  catch(const std::runtime_error &e_)
+                                    {
+                                    }
+                                });
+
+  for(size_t i = 0; i < results.size(); i++)
+    {
+      if(ok[i])
+        results_.emplace_back(std::move(results[i]));
+    }
+}
+
+bool
+CelSearch::smallest(Bitmap                 &bitmap_,
+                    const std::vector<int> &rotations_,
+                    Result                 &result_)
+{
+  u64 colors;
+  int rotation;
+  std::mutex mutex;
+  std::atomic<u64> best;
+
+  // Candidates are ranked by (size << 16 | order) so equal sizes go
+  // to whichever the serial loops reached first no matter which was
+  // tried first here.
+  best     = std::numeric_limits<u64>::max();
+  colors   = bitmap_.color_count();
+  rotation = std::stoi(bitmap_.get("rotation","0"));
+  for(size_t r = 0; r < rotations_.size(); r++)
+    {
+      l::PalettePtr palette;
+      l::SizesArray estimates;
+      std::vector<size_t> ks;
+
+      bitmap_.rotate_to(rotations_[r]);
+      palette = l::palette(bitmap_,colors);
+      l::estimate(bitmap_,colors,palette.get(),l::RANKING_ROWS,estimates);
+      ks = l::ranked(estimates,colors,palette.get());
+      ThreadPool::global().for_each(ks.size(),
+                                    [&](const size_t i_)
+                                    {
+                                      u64 key;
+                                      u64 order;
+                                      CelType celtype;
+                                      Result result;
+
+                                      celtype = l::celtype(ks[i_]);
+                                      order   = ((r * l::CANDIDATES) + ks[i_]);
+                                      try
+                                        {
+                                          if(!l::encode(bitmap_,
+                                                        celtype,
+                                                        palette.get(),
+                                                        [&](const u64 size_)
+                                                        {
+                                                          return (((size_ << 16) | order) > best);
+                                                        },
+                                                        result))
+                                            return;
+                                        }
+                                      catch(const std::runtime_error &e_)
+                                        {
+                                          return;
+                                        }
+
+                                      key = ((result.pdat.size() << 16) | order);
+
+                                      std::lock_guard<std::mutex> lk(mutex);
+                                      if(key >= best)
+                                        return;
+                                      best     = key;
+                                      result_  = std::move(result);
+                                      rotation = rotations_[r];
+                                    });
+    }
+
+  bitmap_.rotate_to(rotation);
+
+  return (best != std::numeric_limits<u64>::max());
+}
+
+void
+CelSearch::estimate(const Bitmap &bitmap_,
+                    SizesVec     &sizes_)
+{
+  u64 colors;
+  l::PalettePtr palette;
+  l::SizesArray estimates;
+
+  colors  = bitmap_.color_count();
+  palette = l::palette(bitmap_,colors);
+  l::estimate(bitmap_,colors,palette.get(),0,estimates);
+  for(size_t k = 0; k < l::CANDIDATES; k++)
+    {
+      if(l::feasible(l::celtype(k),colors,palette.get()))
+        sizes_.emplace_back(estimates[k]);
+    }
+}
+
+CelSearch::Sizes
+CelSearch::sizes(const Result &result_)
+{
+  Sizes sizes;
+
+  sizes.celtype = result_.celtype;
+  sizes.ccb     = sizeof(CelControlChunk);
+  sizes.pdat    = (CHUNK_HDR_SIZE + result_.pdat.size());
+  sizes.plut    = l::plut_size(result_.celtype,result_.plut);
+
+  return sizes;
+}
@@ -0,0 +1,88 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "bitmap.hpp"
+#include "bytevec.hpp"
+#include "convert.hpp"
+#include "plut.hpp"
+#include "types_ints.h"
+
+#include <vector>
+
+
+/*
+  Encodes an image as every linear CEL type for --generate-all and
+  --find-smallest. The color count is taken once and the PLUT built
+  once per rotation. bpp/coded combinations which can't hold the
+  image are ruled out up front rather than by letting the encoder
+  throw. The remaining candidates are encoded on the thread pool. When only the smallest is wanted, unpacked sizes are
+  computed without encoding and packing is abandoned once it can no
+  longer beat the best so far. Candidates are tried smallest
+  estimate() first so that happens early. Ties go to the candidate
+  the serial bpp, packed, coded, rotation loops used to try first.
+*/
+namespace CelSearch
+{
+  struct Result
+  {
+    CelType celtype;
+    ByteVec pdat;
+    PLUT    plut;
+  };
+
+  typedef std::vector<Result> ResultVec;
+
+  // Bytes each chunk of a CEL takes, headers included, as to-cel
+  // writes them by default.
+  struct Sizes
+  {
+    CelType celtype;
+    u64     ccb;
+    u64     pdat;
+    u64     plut;
+
+    u64 total() const { return (ccb + pdat + plut); }
+  };
+
+  typedef std::vector<Sizes> SizesVec;
+
+  // Every type bitmap can be stored as, in bpp then packed then
+  // coded order.
+  void all(const Bitmap &bitmap,
+           ResultVec    &results);
+
+  // The smallest type over rotations. bitmap is left rotated as the
+  // result needs. False if no type could hold it.
+  bool smallest(Bitmap                 &bitmap,
+                const std::vector<int> &rotations,
+                Result                 &result);
+
+  // Predicts the sizes of the types all() would produce, in the same
+  // order, from each row's runs of colors without encoding. CCB,
+  // PLUT and unpacked PDAT sizes are exact. Packed PDAT sizes are
+  // what the HEURISTIC packer stores before overlapping rows so are
+  // an upper bound on it and on OPTIMAL. A PLUT from
+  // --external-palette which maps several colors to one index can
+  // make runs longer than estimated.
+  void estimate(const Bitmap &bitmap,
+                SizesVec     &sizes);
+
+  Sizes sizes(const Result &result);
+}
@@ -122,9 +122,12 @@ Chunk::operator=(cspan<uint8_t> data_)
 {
   size_t size;
 
-  validate(data_);
-
-  size = Chunk::size(data_);
+  // A chunk claiming more than is there (a truncated file) is clamped
+  // to what is so it stays invalid and is never read past the end of
+  // the input, which for a mapped file would fault.
+  size = data_.size();
+  if(size >= (sizeof(uint32_t) + sizeof(uint32_t)))
+    size = std::min<size_t>(Chunk::size(data_),size);
   _chunk = cspan<uint8_t>(data_.data(),size);
 
   return *this;
@@ -150,6 +153,8 @@ Chunk::validate(cspan<uint8_t> chunk_)
                        (isprint(chunk_[3]) ? chunk_[3] : '?'));
 
   size = Chunk::size(chunk_);
+  if(size < (sizeof(uint32_t) + sizeof(uint32_t)))
+    return fmt::format("invalid chunk size - {} < header size",size);
   if(chunk_.size() < size)
     return fmt::format("invalid chunk size - less than buffer size - {} < {}",chunk_.size(),size);
   if(size > (1024 * 1024 * 64))
@@ -0,0 +1,143 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "coded_lut.hpp"
+
+#include "clamp.hpp"
+#include "fmt.hpp"
+#include "scale.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+
+const
+RGBA8888*
+CodedLUT::rgb0555()
+{
+  static const std::vector<RGBA8888> table = []()
+  {
+    std::vector<RGBA8888> t(0x8000);
+
+    for(u32 i = 0; i < t.size(); i++)
+      t[i] = RGBA8888(scale_u5_to_u8((i >> 10) & 0x1F),
+                      scale_u5_to_u8((i >>  5) & 0x1F),
+                      scale_u5_to_u8((i >>  0) & 0x1F),
+                      0xFF);
+
+    return t;
+  }();
+
+  return table.data();
+}
+
+std::shared_ptr<const CodedLUT>
+CodedLUT::get(const PLUT &plut_,
+              const u8    bpp_,
+              const u8    pluta_,
+              const u32   pdv_)
+{
+  thread_local std::shared_ptr<CodedLUT> last;
+
+  if(last &&
+     (last->_bpp   == bpp_)   &&
+     (last->_pluta == pluta_) &&
+     (last->_pdv   == pdv_)   &&
+     (last->_plut  == plut_))
+    return last;
+
+  last = std::make_shared<CodedLUT>();
+  last->_plut  = plut_;
+  last->_bpp   = bpp_;
+  last->_pluta = pluta_;
+  last->_pdv   = pdv_;
+  last->build();
+
+  return last;
+}
+
+// Which PLUT entry pixel value p_ selects. Low bpp CELs take the
+// upper bits of the index from PLUTA.
+u32
+CodedLUT::plut_idx(const u32 p_) const
+{
+  switch(_bpp)
+    {
+    case 1:
+      return ((p_ & 0x01) | (_pluta & 0x1E));
+    case 2:
+      return ((p_ & 0x03) | (_pluta & 0x1C));
+    case 4:
+      return ((p_ & 0x0F) | (_pluta & 0x10));
+    default:
+      return (p_ & 0x1F);
+    }
+}
+
+void
+CodedLUT::build()
+{
+  const RGBA8888 *rgb0555 = CodedLUT::rgb0555();
+
+  _mask  = ((_bpp <= 8) ? ((1 << _bpp) - 1) : 0x1F);
+  _limit = 0;
+  while((_limit <= std::min<u32>(_mask,0x1F)) &&
+        (plut_idx(_limit) < _plut.size()))
+    _limit++;
+
+  for(u32 p = 0; p <= _mask; p++)
+    {
+      u16 rgb;
+
+      if((p & 0x1F) >= _limit)
+        continue;
+
+      rgb = (_plut[plut_idx(p)] & 0x7FFF);
+      if(_bpp == 8)
+        {
+          u32 r,g,b;
+          u32 amv;
+
+          amv = (((p >> 5) & 0x7) + 1);
+
+          r = ((((rgb >> 10) & 0x1F) * amv) / _pdv);
+          g = ((((rgb >>  5) & 0x1F) * amv) / _pdv);
+          b = ((((rgb >>  0) & 0x1F) * amv) / _pdv);
+
+          // FIXME: clamping is optional
+          r = clamp_u5(r);
+          g = clamp_u5(g);
+          b = clamp_u5(b);
+
+          rgb = ((r << 10) | (g << 5) | (b << 0));
+        }
+
+      _rgba[p] = rgb0555[rgb];
+    }
+}
+
+// A pixel referencing a PLUT entry which doesn't exist, such as when
+// the PLUT chunk is missing or cut short, is an error in that input
+// rather than the program.
+void
+CodedLUT::out_of_range(const u32 p_) const
+{
+  throw fmt::exception("PLUT index out of range - {} >= {}",
+                       plut_idx(p_),
+                       _plut.size());
+}
@@ -0,0 +1,69 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "plut.hpp"
+#include "rgba8888.hpp"
+#include "types_ints.h"
+
+#include <array>
+#include <memory>
+
+
+// The RGBA8888 value of every pixel value a coded CEL of a given bpp
+// can contain, resolved through the PLUT, PLUTA and (8bpp) AMV/PDV
+// once rather than per pixel. Tables are shared by consecutive CELs
+// decoded with the same parameters such as the frames of an ANIM or
+// the objects of an SHPM.
+class CodedLUT
+{
+public:
+  static std::shared_ptr<const CodedLUT> get(const PLUT &plut,
+                                             const u8    bpp,
+                                             const u8    pluta,
+                                             const u32   pdv);
+
+  // RGB0555 -> RGBA8888 (opaque) for all 32K colors.
+  static const RGBA8888 *rgb0555();
+
+public:
+  RGBA8888
+  lookup(u32 p_) const
+  {
+    p_ &= _mask;
+    if((p_ & 0x1F) >= _limit)
+      out_of_range(p_);
+
+    return _rgba[p_];
+  }
+
+private:
+  u32  plut_idx(const u32 p) const;
+  void build();
+  [[noreturn]] void out_of_range(const u32 p) const;
+
+private:
+  PLUT _plut;
+  u8   _bpp;
+  u8   _pluta;
+  u32  _pdv;
+  u32  _mask;
+  u32  _limit;
+  std::array<RGBA8888,256> _rgba;
+};
@@ -31,20 +31,28 @@
 #include "chunk_reader.hpp"
 #include "identify_file.hpp"
 #include "image_control_chunk.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
 #include "packed.hpp"
+#include "palette_cache.hpp"
 #include "pdat.hpp"
 #include "pixel_converter.hpp"
 #include "pixel_converter.hpp"
+#include "pixel_kernels.hpp"
 #include "pixel_writer.hpp"
-#include "pixel_writer_coded_8bpp_amv.hpp"
-#include "read_file.hpp"
+#include "pixel_writer_coded.hpp"
+#include "thread_pool.hpp"
 #include "vecrw.hpp"
 #include "video_image.hpp"
+#include "write_pdat.hpp"
 
 #include "fmt.hpp"
 
+#include <algorithm>
 #include <cstddef>
-#include <optional>
+#include <exception>
+#include <string>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -64,6 +72,25 @@ round_up(const u32 number_,
   return (((number_ + multiple_ - 1) / multiple_) * multiple_);
 }
 
+static
+std::size_t
+calc_offset_width(const std::size_t bpp_)
+{
+  switch(bpp_)
+    {
+    case BPP_1:
+    case BPP_2:
+    case BPP_4:
+    case BPP_6:
+      return 8;
+    case BPP_8:
+    case BPP_16:
+      return 16;
+    }
+
+  throw fmt::exception("invalid bpp: {}",bpp_);
+}
+
 static
 void
 resize_pdat(const size_t  w_,
@@ -78,9 +105,8 @@ resize_pdat(const size_t  w_,
   pdat_.resize(size);
 }
 
-static
 int
-coded_colors(int bpp_)
+convert::coded_colors(const int bpp_)
 {
   switch(bpp_)
     {
@@ -107,7 +133,7 @@ check_coded_colors(const Bitmap &bitmap_,
   u32 max_colors;
 
   colors = bitmap_.color_count();
-  max_colors = ::coded_colors(bpp_);
+  max_colors = convert::coded_colors(bpp_);
   if(colors > max_colors)
     throw fmt::exception("input image has {} colors, more than the {} coded colors ({}bpp) possible",
                          colors,
@@ -115,24 +141,33 @@ check_coded_colors(const Bitmap &bitmap_,
                          bpp_);
 }
 
+static
+void
+read_video_image(cspan<u8>   data_,
+                 VideoImage &vi_)
+{
+  ByteReader br;
+
+  br.reset(data_)
+    .readbe(vi_.vi_Version)
+    .read(vi_.vi_Pattern,sizeof(vi_.vi_Pattern))
+    .readbe(vi_.vi_Size)
+    .readbe(vi_.vi_Height)
+    .readbe(vi_.vi_Width)
+    .readbe(vi_.vi_Depth)
+    .readbe(vi_.vi_Type)
+    .readbe(vi_.vi_Reserved1)
+    .readbe(vi_.vi_Reserved2)
+    .readbe(vi_.vi_Reserved3);
+}
+
 void
 convert::banner_to_bitmap(cspan<u8>       data_,
                           std::vector<Bitmap> &bitmaps_)
 {
   VideoImage vi;
-  ByteReader br;
 
-  br.reset(data_)
-    .readbe(vi.vi_Version)
-    .read(vi.vi_Pattern,sizeof(vi.vi_Pattern))
-    .readbe(vi.vi_Size)
-    .readbe(vi.vi_Height)
-    .readbe(vi.vi_Width)
-    .readbe(vi.vi_Depth)
-    .readbe(vi.vi_Type)
-    .readbe(vi.vi_Reserved1)
-    .readbe(vi.vi_Reserved2)
-    .readbe(vi.vi_Reserved3);
+  ::read_video_image(data_,vi);
 
   switch(vi.vi_Depth)
     {
@@ -150,10 +185,10 @@ convert::banner_to_bitmap(cspan<u8>       data_,
 
 static
 void
-to_bitmap(CelControlChunk &ccc_,
-          cPDAT            pdat_,
-          const PLUT      &plut_,
-          Bitmap          &b_)
+to_bitmap(const CelControlChunk &ccc_,
+          cPDAT                  pdat_,
+          const PLUT            &plut_,
+          Bitmap                &b_)
 {
   b_.reset(ccc_.ccb_Width,ccc_.ccb_Height);
   switch(ccc_.type())
@@ -232,30 +267,195 @@ to_bitmap(CelControlChunk &ccc_,
     b_.replace_color(Bitmap::Color::BLACK,Bitmap::Color::NOTBLACK);
 }
 
+// Rows decoded per strip when streaming: enough pixels to keep the
+// thread pool busy with unpack_rows() sized blocks. Always even so
+// LRFORM row pairs are never split.
 static
-std::optional<PLUT>
-get_cel_file_plut(cspan<u8> data_)
+size_t
+strip_rows(const u64 w_)
 {
-  PLUT plut;
-  ChunkVec chunks;
+  size_t rows;
 
-  ChunkReader::chunkify(data_,chunks);
-  for(auto const &chunk : chunks)
+  rows = (((64 * 1024) * (ThreadPool::global().size() + 1)) / std::max<u64>(w_,1));
+  rows = std::max<size_t>(rows,2);
+
+  return (rows + (rows & 1));
+}
+
+// The PDAT from off_ on. Empty if off_ is past the end.
+static
+cPDAT
+pdat_tail(cPDAT        pdat_,
+          const size_t off_)
+{
+  return pdat_(std::min(off_,pdat_.size()));
+}
+
+static
+void
+emit_rows(const Bitmap &bitmap_,
+          RowSink      &sink_)
+{
+  for(u64 y = 0; y < bitmap_.h; y++)
+    sink_.row(bitmap_.y(y));
+}
+
+static
+u64
+cel_height(const CelControlChunk &ccc_)
+{
+  if((ccc_.type() == UNCODED_UNPACKED_LRFORM_16BPP) && (ccc_.ccb_Height & 1))
+    return (ccc_.ccb_Height + 1);
+  return ccc_.ccb_Height;
+}
+
+// Bytes of PDAT used by the first rows_ rows of a CEL. Packed rows
+// are found by following the offset chain as packed_row_offsets()
+// does. LRFORM rows are stored in pairs.
+static
+size_t
+cel_rows_size(const CelControlChunk &ccc_,
+              cPDAT                  pdat_,
+              const size_t           rows_)
+{
+  if(ccc_.packed())
     {
-      if(chunk.id() != CHUNK_PLUT)
-        continue;
+      size_t offset;
+      size_t offset_width;
+      BitStreamReader bs(pdat_);
+
+      offset = 0;
+      offset_width = ::calc_offset_width(ccc_.bpp());
+      for(size_t y = 0; y < rows_; y++)
+        {
+          if((offset * BITS_PER_BYTE) >= bs.size())
+            break;
+
+          bs.seek(offset * BITS_PER_BYTE);
+          offset += ((bs.read(offset_width) + 2) * BYTES_PER_WORD);
+        }
+
+      return offset;
+    }
+
+  if(ccc_.lrform())
+    return ((rows_ / 2) * ccc_.ccb_Width * 4);
+
+  return ((::round_up(ccc_.ccb_Width * ccc_.bpp(),32) / 8) * rows_);
+}
+
+// Decodes the CEL a strip at a time by treating each strip as a CEL
+// of its own: the same CCB with a shorter height and the PDAT from
+// the strip's first row on.
+static
+void
+cel_rows(const CelControlChunk &ccc_,
+         cPDAT                  pdat_,
+         const PLUT            &plut_,
+         RowSink               &sink_)
+{
+  u64 h;
+  size_t off;
+  size_t rows;
+  Bitmap strip;
+  CelControlChunk ccc;
+
+  h    = ::cel_height(ccc_);
+  rows = ::strip_rows(ccc_.ccb_Width);
+  ccc  = ccc_;
+  off  = 0;
+  for(u64 y = 0; y < h; y += rows)
+    {
+      cPDAT pdat;
+
+      pdat = ::pdat_tail(pdat_,off);
+      ccc.ccb_Height = std::min<u64>(rows,h - y);
+
+      ::to_bitmap(ccc,pdat,plut_,strip);
+      ::emit_rows(strip,sink_);
+
+      off += ::cel_rows_size(ccc,pdat,ccc.ccb_Height);
+    }
+}
+
+static
+Frame
+cel_frame(const CelControlChunk &ccc_,
+          cPDAT                  pdat_,
+          const PLUT            &plut_)
+{
+  Frame frame;
+
+  frame.decode = [ccc_,pdat_,plut_](Bitmap &b_)
+  {
+    ::to_bitmap(ccc_,pdat_,plut_,b_);
+  };
 
-      plut = chunk;
+  if((ccc_.ccb_Width <= 0) || (ccc_.ccb_Height <= 0))
+    return frame;
 
-      return plut;
+  frame.w    = ccc_.ccb_Width;
+  frame.h    = ::cel_height(ccc_);
+  frame.rows = [ccc_,pdat_,plut_](RowSink &sink_)
+  {
+    ::cel_rows(ccc_,pdat_,plut_,sink_);
+  };
+
+  return frame;
+}
+
+// Uncoded 16bpp LRFORM data as used by banners, IMAG and LRFORM
+// files: row pairs of w_ 32bit words.
+static
+void
+lrform_rows(cPDAT      pdat_,
+            const u64  w_,
+            const u64  h_,
+            RowSink   &sink_)
+{
+  size_t rows;
+  Bitmap strip;
+
+  rows = ::strip_rows(w_);
+  for(u64 y = 0; y < h_; y += rows)
+    {
+      strip.reset(w_,std::min<u64>(rows,h_ - y));
+      convert::uncoded_unpacked_lrform_16bpp_to_bitmap(::pdat_tail(pdat_,(y / 2) * w_ * 4),
+                                                       strip);
+      ::emit_rows(strip,sink_);
     }
+}
+
+static
+Frame
+lrform_frame(cPDAT     pdat_,
+             const u64 w_,
+             const u64 h_)
+{
+  Frame frame;
+
+  frame.decode = [pdat_,w_,h_](Bitmap &b_)
+  {
+    b_.reset(w_,h_);
+    convert::uncoded_unpacked_lrform_16bpp_to_bitmap(pdat_,b_);
+  };
 
-  return {};
+  if((w_ == 0) || (h_ == 0))
+    return frame;
+
+  frame.w    = w_;
+  frame.h    = h_;
+  frame.rows = [pdat_,w_,h_](RowSink &sink_)
+  {
+    ::lrform_rows(pdat_,w_,h_,sink_);
+  };
+
+  return frame;
 }
 
 void
-convert::cel_to_bitmap(cspan<u8>       data_,
-                       std::vector<Bitmap> &bitmaps_)
+convert::cel_to_frames(cspan<u8>  data_,
+                       FrameVec  &frames_)
 {
   ChunkVec chunks;
   CelControlChunk ccc;
@@ -271,10 +471,7 @@ convert::cel_to_bitmap(cspan<u8>       data_,
         case CHUNK_CCB:
           {
             if(ccc && pdat)
-              {
-                bitmaps_.emplace_back();
-                ::to_bitmap(ccc,pdat,plut,bitmaps_.back());
-              }
+              frames_.emplace_back(::cel_frame(ccc,pdat,plut));
 
             ccc  = chunk;
             pdat = cPDAT();
@@ -286,10 +483,7 @@ convert::cel_to_bitmap(cspan<u8>       data_,
             u32 offset;
 
             if(ccc && pdat)
-              {
-                bitmaps_.emplace_back();
-                ::to_bitmap(ccc,pdat,plut,bitmaps_.back());
-              }
+              frames_.emplace_back(::cel_frame(ccc,pdat,plut));
 
             offset = (ccc.ccbpre() ? 0 : (ccc.packed() ? 4 : 8));
 
@@ -316,21 +510,28 @@ convert::cel_to_bitmap(cspan<u8>       data_,
           //fmt::print("Credits: {}\n",(const char*)chunk.data());
           break;
         default:
-          fmt::print("WARNING - unknown chunk ID: {}\n",chunk.idstr());
+          Log::print("WARNING - unknown chunk ID: {}\n",chunk.idstr());
           break;
         }
     }
 
   if(ccc && pdat)
-    {
-      bitmaps_.emplace_back();
-      ::to_bitmap(ccc,pdat,plut,bitmaps_.back());
-    }
+    frames_.emplace_back(::cel_frame(ccc,pdat,plut));
+}
+
+void
+convert::cel_to_bitmap(cspan<u8>  data_,
+                       BitmapVec &bitmaps_)
+{
+  FrameVec frames;
+
+  convert::cel_to_frames(data_,frames);
+  convert::frames_to_bitmap(frames,bitmaps_);
 }
 
 void
-convert::anim_to_bitmap(cspan<u8>       data_,
-                        std::vector<Bitmap> &bitmaps_)
+convert::anim_to_frames(cspan<u8>  data_,
+                        FrameVec  &frames_)
 {
   ChunkVec chunks;
   CelControlChunk ccc;
@@ -346,11 +547,9 @@ convert::anim_to_bitmap(cspan<u8>       data_,
           ccc = chunk;
           break;
         case CHUNK_PDAT:
-          {
-            cPDAT pdat(chunk.data(),chunk.data_size());
-            bitmaps_.emplace_back();
-            ::to_bitmap(ccc,pdat,plut,bitmaps_.back());
-          }
+          frames_.emplace_back(::cel_frame(ccc,
+                                           cPDAT(chunk.data(),chunk.data_size()),
+                                           plut));
           break;
         case CHUNK_PLUT:
           plut = chunk;
@@ -378,6 +577,16 @@ convert::anim_to_bitmap(cspan<u8>       data_,
     }
 }
 
+void
+convert::anim_to_bitmap(cspan<u8>  data_,
+                        BitmapVec &bitmaps_)
+{
+  FrameVec frames;
+
+  convert::anim_to_frames(data_,frames);
+  convert::frames_to_bitmap(frames,bitmaps_);
+}
+
 void
 convert::lrform_to_bitmap(cspan<u8>  data_,
                           BitmapVec &bitmaps_)
@@ -394,9 +603,29 @@ convert::lrform_to_bitmap(cspan<u8>  data_,
  convert:uncoded_unpacked_lrform_16bpp_to_bitmap(pdat,bitmaps_.back());
 }
 
+static
 void
-convert::imag_to_bitmap(cspan<u8>  data_,
-                        BitmapVec &bitmaps_)
+check_imag(const ImageControlChunk &icc_)
+{
+  if(icc_.bitsperpixel  != 16)
+    throw fmt::exception("bitsperpixel {} not yet supported",icc_.bitsperpixel);
+  if(icc_.numcomponents != 3)
+    throw fmt::exception("numcomponents {} not yet supported",icc_.numcomponents);
+  if(icc_.numplanes     != 1)
+    throw fmt::exception("numplanes {} not yet supported",icc_.numplanes);
+  if(icc_.colorspace    != 0)
+    throw fmt::exception("colorspace {} not yet supported",icc_.colorspace);
+  if(icc_.comptype      != 0)
+    throw fmt::exception("comptype {} not yet supported",icc_.comptype);
+  if(icc_.hvformat      != 0)
+    throw fmt::exception("hvformat {} not yet supported",icc_.hvformat);
+  if(icc_.pixelorder    != 1)
+    throw fmt::exception("pixelorder {} not yet supported",icc_.pixelorder);
+}
+
+void
+convert::imag_to_frames(cspan<u8>  data_,
+                        FrameVec  &frames_)
 {
   ImageControlChunk icc;
   ChunkVec chunks;
@@ -414,23 +643,19 @@ convert::imag_to_bitmap(cspan<u8>  data_,
           {
             cPDAT pdat(chunk.data(),chunk.data_size());
 
-            if(icc.bitsperpixel  != 16)
-              throw fmt::exception("bitsperpixel {} not yet supported",icc.bitsperpixel);
-            if(icc.numcomponents != 3)
-              throw fmt::exception("numcomponents {} not yet supported",icc.numcomponents);
-            if(icc.numplanes     != 1)
-              throw fmt::exception("numplanes {} not yet supported",icc.numplanes);
-            if(icc.colorspace    != 0)
-              throw fmt::exception("colorspace {} not yet supported",icc.colorspace);
-            if(icc.comptype      != 0)
-              throw fmt::exception("comptype {} not yet supported",icc.comptype);
-            if(icc.hvformat      != 0)
-              throw fmt::exception("hvformat {} not yet supported",icc.hvformat);
-            if(icc.pixelorder    != 1)
-              throw fmt::exception("pixelorder {} not yet supported",icc.pixelorder);
-
-            bitmaps_.emplace_back(icc.w,icc.h);
-            convert::uncoded_unpacked_lrform_16bpp_to_bitmap(pdat,bitmaps_.back());
+            try
+              {
+                ::check_imag(icc);
+                frames_.emplace_back(::lrform_frame(pdat,icc.w,icc.h));
+              }
+            catch(...)
+              {
+                frames_.push_back({[error = std::current_exception()](Bitmap &b_)
+                {
+                  std::rethrow_exception(error);
+                }});
+                frames_.back().image = false;
+              }
           }
           break;
         case CHUNK_PLUT:
@@ -459,8 +684,108 @@ convert::imag_to_bitmap(cspan<u8>  data_,
 }
 
 void
-convert::to_bitmap(cspan<u8>  data_,
-                   BitmapVec &bitmaps_)
+convert::imag_to_bitmap(cspan<u8>  data_,
+                        BitmapVec &bitmaps_)
+{
+  FrameVec frames;
+
+  convert::imag_to_frames(data_,frames);
+  convert::frames_to_bitmap(frames,bitmaps_);
+}
+
+// Formats which only ever hold one image are decoded whole when
+// their frame is.
+static
+Frame
+single_frame(cspan<u8>                                     data_,
+             void (*to_bitmap_)(cspan<u8>,BitmapVec&))
+{
+  return {[data_,to_bitmap_](Bitmap &b_)
+  {
+    BitmapVec bitmaps;
+
+    to_bitmap_(data_,bitmaps);
+    if(!bitmaps.empty())
+      b_ = std::move(bitmaps.front());
+  }};
+}
+
+// Banners and LRFORM files which can be decoded stream like any
+// other LRFORM data. Anything else is left to the whole image decoder
+// to reject.
+static
+Frame
+banner_frame(cspan<u8> data_)
+{
+  VideoImage vi;
+
+  ::read_video_image(data_,vi);
+  if(vi.vi_Depth != 16)
+    return ::single_frame(data_,convert::banner_to_bitmap);
+
+  return ::lrform_frame(cPDAT(data_,sizeof(vi)),vi.vi_Width,vi.vi_Height);
+}
+
+static
+Frame
+lrform_file_frame(cspan<u8> data_)
+{
+  cPDAT pdat(data_.data(),data_.size());
+
+  if(data_.size() == (320 * 240 * 2))
+    return ::lrform_frame(pdat,320,240);
+  if(data_.size() == (352 * 288 * 2))
+    return ::lrform_frame(pdat,352,288);
+
+  return ::single_frame(data_,convert::lrform_to_bitmap);
+}
+
+static
+void
+stbi_to_bitmap(cspan<u8>  data_,
+               BitmapVec &bitmaps_)
+{
+  bitmaps_.emplace_back();
+  stbi_load(data_,bitmaps_.back());
+}
+
+static
+std::string
+index_str(const size_t idx_,
+          const size_t count_)
+{
+  unsigned const width = (std::floor(std::log10(count_)) + 1);
+
+  return fmt::format("{:0{}}",idx_,width);
+}
+
+// Images are numbered in the order found skipping entries known to
+// hold none, so a file with an unreadable entry numbers the rest as
+// though it weren't there. A file of one image isn't numbered.
+static
+void
+number_frames(FrameVec &frames_)
+{
+  u64 count;
+  u64 number;
+
+  count  = convert::frame_images(frames_);
+  number = 0;
+  for(auto &frame : frames_)
+    {
+      frame.number = number;
+      frame.index.clear();
+      if(!frame.image)
+        continue;
+      if(count > 1)
+        frame.index = ::index_str(number,count);
+      number++;
+    }
+}
+
+void
+convert::to_frames(cspan<u8>  data_,
+                   FrameVec  &frames_)
 {
   u32 type;
 
@@ -468,153 +793,277 @@ convert::to_bitmap(cspan<u8>  data_,
   switch(type)
     {
     case FILE_ID_3DO_CEL:
-      convert::cel_to_bitmap(data_,bitmaps_);
+      convert::cel_to_frames(data_,frames_);
       break;
     case FILE_ID_3DO_BANNER:
-      convert::banner_to_bitmap(data_,bitmaps_);
+      frames_.emplace_back(::banner_frame(data_));
       break;
     case FILE_ID_3DO_IMAGE:
-      convert::imag_to_bitmap(data_,bitmaps_);
+      convert::imag_to_frames(data_,frames_);
       break;
     case FILE_ID_3DO_ANIM:
-      convert::anim_to_bitmap(data_,bitmaps_);
+      convert::anim_to_frames(data_,frames_);
       break;
     case FILE_ID_3DO_LRFORM:
-      convert::lrform_to_bitmap(data_,bitmaps_);
+      frames_.emplace_back(::lrform_file_frame(data_));
       break;
     case FILE_ID_BMP:
     case FILE_ID_PNG:
     case FILE_ID_JPG:
     case FILE_ID_GIF:
-      bitmaps_.emplace_back();
-      stbi_load(data_,bitmaps_.back());
+      frames_.emplace_back(::single_frame(data_,::stbi_to_bitmap));
       break;
     case FILE_ID_NFS_SHPM:
-      convert::nfs_shpm_to_bitmap(data_,bitmaps_);
+      convert::nfs_shpm_to_frames(data_,frames_);
       break;
     case FILE_ID_NFS_WWWW:
-      convert::nfs_wwww_to_bitmap(data_,bitmaps_);
+      convert::nfs_wwww_to_frames(data_,frames_);
       break;
     default:
       throw std::runtime_error("unknown image type");
     }
 
-  unsigned i = 0;
-  unsigned const width = (std::floor(std::log10(bitmaps_.size())) + 1);
-  if(bitmaps_.size() > 1)
-    {
-      for(auto &bitmap : bitmaps_)
-        bitmap.set("index",fmt::format("{:0{}}",i++,width));
-    }
+  ::number_frames(frames_);
 }
 
 void
-convert::to_bitmap(const fs::path &filepath_,
-                   BitmapVec      &bitmaps_)
+convert::frame_to_bitmap(const FrameVec &frames_,
+                         const size_t    idx_,
+                         Bitmap         &bitmap_)
 {
-  ByteVec data;
+  const Frame &frame = frames_[idx_];
 
-  ReadFile::read(filepath_,data);
-  if(data.empty())
-    throw fmt::exception("file empty: {}",filepath_);
+  frame.decode(bitmap_);
+  if(bitmap_ && !frame.index.empty())
+    bitmap_.set("index",frame.index);
+}
 
-  convert::to_bitmap(data,bitmaps_);
+std::vector<size_t>
+convert::select_frames(const FrameVec    &frames_,
+                       const FrameFilter &selected_)
+{
+  std::vector<size_t> rv;
 
-  for(auto &bitmap : bitmaps_)
+  for(size_t i = 0; i < frames_.size(); i++)
     {
-      bitmap.set("filename",filepath_.filename().stem().string());
+      if(!selected_)
+        rv.emplace_back(i);
+      else if(frames_[i].image && selected_(frames_[i].number))
+        rv.emplace_back(i);
     }
+
+  return rv;
+}
+
+u64
+convert::frame_images(const FrameVec &frames_)
+{
+  return std::count_if(frames_.begin(),
+                       frames_.end(),
+                       [](const Frame &frame_) { return frame_.image; });
 }
 
 void
-convert::bitmap_to_uncoded_unpacked_linear_8bpp(const Bitmap &bitmap_,
-                                                ByteVec      &pdat_)
+convert::for_each_frame(const FrameVec            &frames_,
+                        const std::vector<size_t> &idxs_,
+                        const FrameFilter         &decode_,
+                        const FrameFunc           &fn_)
 {
-  u8 rgb;
-  const size_t w = bitmap_.w;
-  const size_t h = bitmap_.h;
-  VecRW pdat;
+  struct Output
+  {
+    Bitmap             bitmap;
+    std::string        log;
+    std::exception_ptr error;
+  };
+
+  size_t window;
+  std::vector<size_t> decode;
+  std::vector<Output> outputs;
+
+  window = (ThreadPool::global().size() + 1);
+  for(size_t first = 0; first < idxs_.size(); first += window)
+    {
+      size_t last;
 
-  // Approximate. VecRW will manage the size as needed.
-  pdat_.reserve(w * h * sizeof(u8));
-  pdat.reset(&pdat_);
+      last = std::min(first + window,idxs_.size());
 
-  for(size_t y = 0; y < h; y++)
-    {
-      for(size_t x = 0; x < w; x++)
+      decode.clear();
+      outputs.clear();
+      outputs.resize(last - first);
+      for(size_t i = first; i < last; i++)
         {
-          const RGBA8888 *p = bitmap_.xy(x,y);
-
-          rgb = RGBA8888Converter::to_rgb332(p);
+          if(!decode_ || decode_(idxs_[i]))
+            decode.emplace_back(i - first);
+        }
 
+      ThreadPool::global().for_each(decode.size(),
+                                    [&](const size_t i_)
+                                    {
+                                      Output &output = outputs[decode[i_]];
+                                      Log::Capture capture(output.log);
+
+                                      try
+                                        {
+                                          convert::frame_to_bitmap(frames_,
+                                                                   idxs_[first + decode[i_]],
+                                                                   output.bitmap);
+                                        }
+                                      catch(...)
+                                        {
+                                          output.error = std::current_exception();
+                                        }
+                                    });
+
+      for(size_t i = first; i < last; i++)
+        {
+          Output &output = outputs[i - first];
 
-          pdat.u8(rgb);
+          Log::write(output.log);
+          if(output.error)
+            std::rethrow_exception(output.error);
+          fn_(idxs_[i],output.bitmap);
+          output.bitmap = Bitmap();
         }
+    }
+}
 
-      pdat.skip_to_4byte_boundary();
+RowSource
+convert::bitmap_rows(const Bitmap &bitmap_)
+{
+  return [&bitmap_](RowSink &sink_)
+  {
+    ::emit_rows(bitmap_,sink_);
+  };
+}
+
+bool
+convert::frame_to_rows(const FrameVec &frames_,
+                       const size_t    idx_,
+                       Bitmap         &bitmap_,
+                       RowSource      &rows_)
+{
+  const Frame &frame = frames_[idx_];
+
+  if(!frame.rows)
+    {
+      convert::frame_to_bitmap(frames_,idx_,bitmap_);
+      rows_ = convert::bitmap_rows(bitmap_);
+
+      return (bool)bitmap_;
     }
+
+  bitmap_.reset();
+  bitmap_.w = frame.w;
+  bitmap_.h = frame.h;
+  if(!frame.index.empty())
+    bitmap_.set("index",frame.index);
+  rows_ = frame.rows;
+
+  return true;
 }
 
 void
-convert::bitmap_to_uncoded_unpacked_linear_16bpp(const Bitmap &bitmap_,
-                                                 ByteVec      &pdat_)
+convert::to_bitmap(cspan<u8>  data_,
+                   BitmapVec &bitmaps_)
 {
-  u16 rgb;
-  int w = bitmap_.w;
-  int h = bitmap_.h;
-  VecRW pdat;
+  FrameVec frames;
 
-  // Approximate. VecRW will manage the size as needed.
-  pdat_.reserve(w * h * sizeof(u16));
-  pdat.reset(&pdat_);
+  convert::to_frames(data_,frames);
+  convert::frames_to_bitmap(frames,bitmaps_);
+}
 
-  for(int y = 0; y < h; y++)
-    {
-      for(int x = 0; x < w; x++)
-        {
-          const RGBA8888 *p = bitmap_.xy(x,y);
+void
+convert::frames_to_bitmap(const FrameVec &frames_,
+                          BitmapVec      &bitmaps_)
+{
+  convert::for_each_frame(frames_,
+                          convert::select_frames(frames_,{}),
+                          {},
+                          [&](const size_t, Bitmap &bitmap_)
+                          {
+                            if(bitmap_)
+                              bitmaps_.emplace_back(std::move(bitmap_));
+                          });
+}
 
-          rgb = RGBA8888Converter::to_rgb0555(p);
+void
+convert::to_bitmap(const fs::path &filepath_,
+                   BitmapVec      &bitmaps_)
+{
+  MappedFile file;
 
-          pdat.u16be(rgb);
-        }
+  file.open(filepath_);
+
+  convert::to_bitmap(filepath_,file,bitmaps_);
+}
+
+void
+convert::to_bitmap(const fs::path &filepath_,
+                   cspan<u8>       data_,
+                   BitmapVec      &bitmaps_)
+{
+  if(data_.size() == 0)
+    throw fmt::exception("file empty: {}",filepath_);
 
-      pdat.skip_to_4byte_boundary();
+  convert::to_bitmap(data_,bitmaps_);
+
+  for(auto &bitmap : bitmaps_)
+    {
+      bitmap.set("filename",filepath_.filename().stem().string());
     }
 }
 
+// The uncoded unpacked encoders are a PDATRowWriter fed the bitmap's
+// rows so whole image and streamed output are the same code.
+static
 void
-convert::bitmap_to_uncoded_unpacked_lrform_16bpp(const Bitmap &bitmap_,
-                                                 ByteVec      &pdat_)
+uncoded_unpacked(const Bitmap                &bitmap_,
+                 const PDATRowWriter::Format  format_,
+                 const u64                    h_,
+                 ByteVec                     &pdat_)
 {
-  int w;
-  int h;
-  VecRW pdat;
-  u16 rgb;
+  VecRW rw;
 
-  // LRForm height must be an even number of rows so truncate if odd.
-  w = bitmap_.w;
-  h = (bitmap_.h & ~0x1);
+  pdat_.clear();
+  pdat_.reserve(PDATRowWriter::size(format_,bitmap_.w,h_));
+  rw.reset(&pdat_);
 
-  // Approximate. VecRW will manage the size as needed.
-  pdat_.reserve(w * h * sizeof(u16));
-  pdat.reset(&pdat_);
+  PDATRowWriter writer(rw,format_,bitmap_.w,h_);
 
-  for(int y = 0; y < h; y += 2)
-    {
-      for(int x = 0; x < w; x++)
-        {
-          const RGBA8888 *lp = bitmap_.xy(x,y+0);
-          rgb = RGBA8888Converter::to_rgb0555(lp);
-          pdat.u16be(rgb);
+  ::emit_rows(bitmap_,writer);
+  writer.finish();
+}
 
-          const RGBA8888 *rp = bitmap_.xy(x,y+1);
-          rgb = RGBA8888Converter::to_rgb0555(rp);
-          pdat.u16be(rgb);
-        }
+void
+convert::bitmap_to_uncoded_unpacked_linear_8bpp(const Bitmap &bitmap_,
+                                                ByteVec      &pdat_)
+{
+  ::uncoded_unpacked(bitmap_,
+                     PDATRowWriter::Format::LINEAR_8BPP,
+                     bitmap_.h,
+                     pdat_);
+}
 
-      pdat.skip_to_4byte_boundary();
-    }
+void
+convert::bitmap_to_uncoded_unpacked_linear_16bpp(const Bitmap &bitmap_,
+                                                 ByteVec      &pdat_)
+{
+  ::uncoded_unpacked(bitmap_,
+                     PDATRowWriter::Format::LINEAR_16BPP,
+                     bitmap_.h,
+                     pdat_);
+}
+
+// LRForm height must be an even number of rows so an odd last row is
+// dropped.
+void
+convert::bitmap_to_uncoded_unpacked_lrform_16bpp(const Bitmap &bitmap_,
+                                                 ByteVec      &pdat_)
+{
+  ::uncoded_unpacked(bitmap_,
+                     PDATRowWriter::Format::LRFORM_16BPP,
+                     (bitmap_.h & ~UINT64_C(1)),
+                     pdat_);
 }
 
 void
@@ -623,7 +1072,7 @@ convert::bitmap_to_uncoded_packed_linear_8bpp(const Bitmap &bitmap_,
 {
   RGBA8888Converter pc(BPP_8);
 
-  CelPacker::pack(bitmap_,pc,pdat_);
+  CelPacker::pack(bitmap_,pc,pdat_,CelPacker::mode(bitmap_));
 }
 
 void
@@ -632,47 +1081,27 @@ convert::bitmap_to_uncoded_packed_linear_16bpp(const Bitmap &bitmap_,
 {
   RGBA8888Converter pc(BPP_16);
 
-  CelPacker::pack(bitmap_,pc,pdat_);
+  CelPacker::pack(bitmap_,pc,pdat_,CelPacker::mode(bitmap_));
 }
 
+// Rows of bpp_ wide PLUT indexes from lookup_, each padded to a word
+// and to at least 2 words.
+template<typename Lookup>
 static
 void
-bitmap_to_coded_unpacked_linear_Xbpp(const Bitmap  &bitmap_,
-                                     const u8  bpp_,
-                                     ByteVec       &pdat_,
-                                     PLUT          &plut_)
+coded_unpacked_rows(const Bitmap &bitmap_,
+                    const u8      bpp_,
+                    const Lookup &lookup_,
+                    ByteVec      &pdat_)
 {
+  u64 row_bits;
   BitStreamWriter bs;
 
-  ::check_coded_colors(bitmap_,bpp_);
+  row_bits = std::max<u64>(round_up(bitmap_.w * bpp_,32),2 * BITS_PER_WORD);
 
   resize_pdat(bitmap_.w,bitmap_.h,bpp_,pdat_);
   bs.reset(pdat_);
-
-  if(bitmap_.has("external-palette"))
-    {
-      u32 filetype;
-      ByteVec data;
-      fs::path filepath;
-      std::optional<PLUT> plut;
-
-      filepath = bitmap_.get("external-palette");
-
-      ReadFile::read(filepath,data);
-      filetype = IdentifyFile::identify(data);
-      if(!IdentifyFile::chunked_type(filetype))
-        throw fmt::exception("'{}' does not appear to be a 3DO formated file",filepath);
-
-      plut = ::get_cel_file_plut(data);
-      if(plut)
-        plut_ = plut.value();
-      else
-        throw fmt::exception("No CEL PLUT found in '{}'",filepath);
-    }
-  else
-    {
-      plut_.build(bitmap_);
-    }
+  bs.reserve(row_bits * bitmap_.h);
 
   for(size_t y = 0; y < bitmap_.h; y++)
     {
@@ -685,7 +1114,7 @@ bitmap_to_coded_unpacked_linear_Xbpp(const Bitmap  &bitmap_,
           const RGBA8888 *p = bitmap_.xy(x,y);
 
           color = RGBA8888Converter::to_rgb0555(p);
-          color = plut_.lookup(color);
+          color = lookup_(color);
 
           bs.write(bpp_,color);
         }
@@ -696,10 +1125,56 @@ bitmap_to_coded_unpacked_linear_Xbpp(const Bitmap  &bitmap_,
       // bytes (2 words.)
       // https://3dodev.com/documentation/development/opera/pf25/ppgfldr/ggsfldr/gpgfldr/5gpge#the_woffset_value
       if((bs.tell() - start) < (2 * BITS_PER_WORD))
-        bs.write(((2 * BITS_PER_WORD) - (bs.tell() - start)),0);
+        bs.write_run(0,
+                     BITS_PER_WORD,
+                     ((2 * BITS_PER_WORD) - (bs.tell() - start)) / BITS_PER_WORD);
+    }
+
+  bs.flush();
+}
+
+static
+void
+bitmap_to_coded_unpacked_linear_Xbpp(const Bitmap  &bitmap_,
+                                     const u8  bpp_,
+                                     ByteVec       &pdat_,
+                                     PLUT          &plut_)
+{
+  std::shared_ptr<const PaletteCache::Palette> palette;
+
+  ::check_coded_colors(bitmap_,bpp_);
+
+  if(bitmap_.has("external-palette"))
+    {
+      palette = PaletteCache::get(bitmap_.get("external-palette"));
+      plut_   = palette->plut;
+      ::coded_unpacked_rows(bitmap_,
+                            bpp_,
+                            [&](const u16 color_) { return palette->plut.lookup(color_); },
+                            pdat_);
+    }
+  else
+    {
+      plut_.build(bitmap_);
+      ::coded_unpacked_rows(bitmap_,
+                            bpp_,
+                            [&](const u16 color_) { return plut_.lookup(color_); },
+                            pdat_);
     }
 }
 
+void
+convert::bitmap_to_coded_unpacked_linear(const Bitmap &bitmap_,
+                                         const u8      bpp_,
+                                         const PLUT   &plut_,
+                                         ByteVec      &pdat_)
+{
+  ::coded_unpacked_rows(bitmap_,
+                        bpp_,
+                        [&](const u16 color_) { return plut_.lookup(color_); },
+                        pdat_);
+}
+
 void
 convert::bitmap_to_coded_unpacked_linear_1bpp(const Bitmap &bitmap_,
                                               ByteVec      &pdat_,
@@ -755,36 +1230,24 @@ bitmap_to_coded_packed_linear_Xbpp(const Bitmap &bitmap_,
                                    ByteVec      &pdat_,
                                    PLUT         &plut_)
 {
-  RGBA8888Converter pc(bpp_,plut_);
+  std::shared_ptr<const PaletteCache::Palette> palette;
 
   ::check_coded_colors(bitmap_,bpp_);
 
   if(bitmap_.has("external-palette"))
     {
-      u32 filetype;
-      ByteVec data;
-      fs::path filepath;
-      std::optional<PLUT> plut;
-
-      filepath = bitmap_.get("external-palette");
-
-      ReadFile::read(filepath,data);
-      filetype = IdentifyFile::identify(data);
-      if(!IdentifyFile::chunked_type(filetype))
-        throw fmt::exception("'{}' does not appear to be a 3DO formated file",filepath);
-
-      plut = ::get_cel_file_plut(data);
-      if(plut)
-        plut_ = plut.value();
-      else
-        throw fmt::exception("No CEL PLUT found in '{}'",filepath);
+      palette = PaletteCache::get(bitmap_.get("external-palette"));
+      plut_   = palette->plut;
     }
   else
     {
       plut_.build(bitmap_);
     }
 
-  CelPacker::pack(bitmap_,pc,pdat_);
+  if(palette)
+    CelPacker::pack(bitmap_,RGBA8888Converter(bpp_,palette->plut),pdat_,CelPacker::mode(bitmap_));
+  else
+    CelPacker::pack(bitmap_,RGBA8888Converter(bpp_,plut_),pdat_,CelPacker::mode(bitmap_));
 }
 
 void
@@ -835,32 +1298,48 @@ convert::bitmap_to_coded_packed_linear_16bpp(const Bitmap &bitmap_,
   ::bitmap_to_coded_packed_linear_Xbpp(bitmap_,BPP_16,pdat_,plut_);
 }
 
+// Pixels of row y_ present in pdat_ given the row stride. Rows cut
+// short by truncated data are left transparent.
+static
+size_t
+available_pixels(cPDAT         pdat_,
+                 const size_t  y_,
+                 const size_t  stride_,
+                 const size_t  bytes_per_pixel_,
+                 const size_t  w_)
+{
+  size_t off;
+
+  off = (y_ * stride_);
+  if(off >= pdat_.size())
+    return 0;
+
+  return std::min(w_,((pdat_.size() - off) / bytes_per_pixel_));
+}
+
 void
 convert::uncoded_unpacked_lrform_16bpp_to_bitmap(cPDAT   pdat_,
                                                  Bitmap &bitmap_)
 {
-  size_t i;
-  u8 hb,lb;
-  PixelWriter pwl;
-  PixelWriter pwr;
+  size_t n;
+  size_t stride;
+  std::vector<RGBA8888> discard;
 
-  i = 0;
-  pwl.reset(bitmap_);
-  pwr.reset(bitmap_);
-  for(size_t y = 0; y < bitmap_.h;)
-    {
-      pwl.move_y(y++);
-      pwr.move_y(y++);
-      for(size_t x = 0; x < bitmap_.w; x++)
-        {
-          hb = pdat_[i++];
-          lb = pdat_[i++];
-          pwl.write_0555(hb,lb);
+  // Each 32bit word holds a pixel of an even row and the one below
+  // it. An odd height's final row has nowhere to go.
+  stride = (bitmap_.w * 4);
+  if(bitmap_.h & 1)
+    discard.resize(bitmap_.w);
 
-          hb = pdat_[i++];
-          lb = pdat_[i++];
-          pwr.write_0555(hb,lb);
-        }
+  for(size_t y = 0; y < bitmap_.h; y += 2)
+    {
+      n = ::available_pixels(pdat_,y / 2,stride,4,bitmap_.w);
+      PixelKernels::lrform_to_rgba8888(&pdat_[(y / 2) * stride],
+                                       bitmap_.xy(0,y),
+                                       (((y + 1) < bitmap_.h) ?
+                                        bitmap_.xy(0,y + 1) :
+                                        discard.data()),
+                                       n);
     }
 }
 
@@ -868,23 +1347,16 @@ void
 convert::uncoded_unpacked_linear_8bpp_to_bitmap(cPDAT   pdat_,
                                                 Bitmap &bitmap_)
 {
-  ByteReader br;
-  PixelWriter pw;
+  size_t n;
+  size_t stride;
 
-  br.reset(pdat_);
-  pw.reset(bitmap_);
+  stride = ::round_up(bitmap_.w,4);
   for(size_t y = 0; y < bitmap_.h; y++)
     {
-      for(size_t x = 0; x < bitmap_.w; x++)
-        {
-          u32 p;
-
-          p = br.u8();
-
-          pw.write_332(p);
-        }
-
-      br.skip_to_4byte_boundary();
+      n = ::available_pixels(pdat_,y,stride,1,bitmap_.w);
+      PixelKernels::rgb332_to_rgba8888(&pdat_[y * stride],
+                                       bitmap_.xy(0,y),
+                                       n);
     }
 }
 
@@ -892,23 +1364,16 @@ void
 convert::uncoded_unpacked_linear_rep8_8bpp_to_bitmap(cPDAT   pdat_,
                                                      Bitmap &bitmap_)
 {
-  ByteReader br;
-  PixelWriter pw;
+  size_t n;
+  size_t stride;
 
-  br.reset(pdat_);
-  pw.reset(bitmap_);
+  stride = ::round_up(bitmap_.w,4);
   for(size_t y = 0; y < bitmap_.h; y++)
     {
-      for(size_t x = 0; x < bitmap_.w; x++)
-        {
-          u32 p;
-
-          p = br.u8();
-
-          pw.write_rep8_332(p);
-        }
-
-      br.skip_to_4byte_boundary();
+      n = ::available_pixels(pdat_,y,stride,1,bitmap_.w);
+      PixelKernels::rep8_rgb332_to_rgba8888(&pdat_[y * stride],
+                                            bitmap_.xy(0,y),
+                                            n);
     }
 }
 
@@ -916,23 +1381,16 @@ void
 convert::uncoded_unpacked_linear_16bpp_to_bitmap(cPDAT   pdat_,
                                                  Bitmap &bitmap_)
 {
-  ByteReader br;
-  PixelWriter pw;
+  size_t n;
+  size_t stride;
 
-  br.reset(pdat_);
-  pw.reset(bitmap_);
+  stride = ::round_up(bitmap_.w * 2,4);
   for(size_t y = 0; y < bitmap_.h; y++)
     {
-      for(size_t x = 0; x < bitmap_.w; x++)
-        {
-          u32 p;
-
-          p = br.u16be();
-
-          pw.write_uncoded_16bpp(p);
-        }
-
-      br.skip_to_4byte_boundary();
+      n = ::available_pixels(pdat_,y,stride,2,bitmap_.w);
+      PixelKernels::rgb0555_to_rgba8888(&pdat_[y * stride],
+                                        bitmap_.xy(0,y),
+                                        n);
     }
 }
 
@@ -946,6 +1404,7 @@ unpack_row(BitStreamReader &bs_,
   u8 type;
   u32 pixel;
   u32 count;
+  u32 pixels[1 << DATA_PACKET_PIXEL_COUNT_SIZE];
 
   do
     {
@@ -955,25 +1414,21 @@ unpack_row(BitStreamReader &bs_,
         case PACK_LITERAL:
           {
             count = bs_.read(DATA_PACKET_PIXEL_COUNT_SIZE) + 1;
-            for(size_t i = 0; i < count; i++)
-              {
-                pixel = bs_.read(bpp_);
-                pw_.write(pixel);
-              }
+            bs_.read_n(bpp_,pixels,count);
+            pw_.literal(pixels,count);
           }
           break;
         case PACK_TRANSPARENT:
           {
             count = bs_.read(DATA_PACKET_PIXEL_COUNT_SIZE) + 1;
-            pw_.write_transparent(count);
+            pw_.zero(count);
           }
           break;
         case PACK_PACKED:
           {
             count = bs_.read(DATA_PACKET_PIXEL_COUNT_SIZE) + 1;
             pixel = bs_.read(bpp_);
-            for(u32 i = 0; i < count; i++)
-              pw_.write(pixel);
+            pw_.fill(pixel,count);
           }
           break;
         case PACK_EOL:
@@ -982,23 +1437,72 @@ unpack_row(BitStreamReader &bs_,
     } while((type != PACK_EOL) && !pw_.row_filled());
 }
 
+// Each packed row starts with the offset in words (less 2) to the
+// next so one pass over those finds every row and the rows can then
+// be decoded independently. Stops at the first row which starts past
+// the end of the PDAT.
 static
-std::size_t
-calc_offset_width(const std::size_t bpp_)
+void
+packed_row_offsets(cPDAT                     pdat_,
+                   const size_t              h_,
+                   const std::size_t         offset_width_,
+                   std::vector<std::size_t> &offsets_)
 {
-  switch(bpp_)
+  std::size_t offset;
+  BitStreamReader bs(pdat_);
+
+  offset = 0;
+  offsets_.reserve(h_);
+  for(size_t y = 0; y < h_; y++)
     {
-    case BPP_1:
-    case BPP_2:
-    case BPP_4:
-    case BPP_6:
-      return 8;
-    case BPP_8:
-    case BPP_16:
-      return 16;
+      if((offset * BITS_PER_BYTE) >= bs.size())
+        break;
+
+      offsets_.push_back(offset);
+
+      bs.seek(offset * BITS_PER_BYTE);
+      offset += ((bs.read(offset_width_) + 2) * BYTES_PER_WORD);
     }
+}
 
-  throw fmt::exception("invalid bpp: {}",bpp_);
+// Decodes the rows found by packed_row_offsets() in blocks of at
+// least 64K pixels spread over the thread pool. Each block gets its
+// own writer from init_. An error from a row is rethrown as the
+// serial loop would have: from the earliest failing row.
+template<typename PW, typename InitFunc>
+static
+void
+unpack_rows(cPDAT                           pdat_,
+            Bitmap                         &bitmap_,
+            const u32                       bpp_,
+            const std::size_t               offset_width_,
+            const std::vector<std::size_t> &offsets_,
+            const InitFunc                 &init_)
+{
+  size_t rows_per_block;
+  size_t blocks;
+
+  rows_per_block = std::max<size_t>((64 * 1024) / std::max<size_t>(bitmap_.w,1),1);
+  blocks = ((offsets_.size() + rows_per_block - 1) / rows_per_block);
+
+  ThreadPool::global().for_each(blocks,
+                                [&](const size_t block_)
+                                {
+                                  PW pw;
+                                  size_t end;
+                                  BitStreamReader bs(pdat_);
+
+                                  init_(pw);
+                                  end = std::min((block_ + 1) * rows_per_block,
+                                                 offsets_.size());
+                                  for(size_t y = block_ * rows_per_block; y < end; y++)
+                                    {
+                                      bs.seek((offsets_[y] * BITS_PER_BYTE) + offset_width_);
+                                      pw.move_y(y);
+
+                                      ::unpack_row(bs,pw,bpp_);
+                                    }
+                                });
 }
 
 static
@@ -1007,27 +1511,20 @@ uncoded_packed_linear_Xbpp_to_bitmap(cPDAT        pdat_,
                                      Bitmap      &bitmap_,
                                      const u32    bpp_)
 {
-  PixelWriter pw;
-  std::size_t offset;
   std::size_t offset_width;
-  BitStreamReader bs(pdat_);
+  std::vector<std::size_t> offsets;
 
-  offset = 0;
   offset_width = ::calc_offset_width(bpp_);
-  pw.reset(bitmap_,bpp_);
-  for(size_t y = 0; y < bitmap_.h; y++)
-    {
-      if((offset * BITS_PER_BYTE) >= bs.size())
-        throw fmt::exception("attempted out of bound read - {} {}:{}",
-                             __FILE__,__FUNCTION__,__LINE__);
-
-      bs.seek(offset * BITS_PER_BYTE);
-      pw.move_y(y);
-
-      offset += ((bs.read(offset_width) + 2) * BYTES_PER_WORD);
-
-      ::unpack_row(bs,pw,bpp_);
-    }
+  ::packed_row_offsets(pdat_,bitmap_.h,offset_width,offsets);
+  ::unpack_rows<PixelWriter>(pdat_,bitmap_,bpp_,offset_width,offsets,
+                             [&](PixelWriter &pw_)
+                             {
+                               pw_.reset(bitmap_,bpp_);
+                             });
+
+  if(offsets.size() < bitmap_.h)
+    throw fmt::exception("attempted out of bound read - {} {}:{}",
+                         __FILE__,__FUNCTION__,__LINE__);
 }
 
 void
@@ -1044,36 +1541,29 @@ convert::uncoded_packed_linear_8bpp_to_bitmap(cPDAT   pdat_,
   ::uncoded_packed_linear_Xbpp_to_bitmap(pdat_,bitmap_,BPP_8);
 }
 
+template<u8 BPP>
 static
 void
-coded_packed_linear_to_bitmap(const u32  bpp_,
-                              cPDAT           pdat_,
-                              const PLUT     &plut_,
-                              const u8   pluta_,
-                              Bitmap         &bitmap_)
+coded_packed_linear_to_bitmap(cPDAT       pdat_,
+                              const PLUT &plut_,
+                              const u8    pluta_,
+                              const u32   pdv_,
+                              Bitmap     &bitmap_)
 {
-  PixelWriter pw;
-  std::size_t offset;
   std::size_t offset_width;
-  BitStreamReader bs(pdat_);
-
-  offset = 0;
-  offset_width = calc_offset_width(bpp_);
-  pw.reset(bitmap_,plut_,pluta_,bpp_);
-  for(size_t y = 0; y < bitmap_.h; y++)
-    {
-      if((offset * BITS_PER_BYTE) >= bs.size())
-        throw fmt::exception("attempted out of bound read - {} {}:{}",
-                             __FILE__,__FUNCTION__,__LINE__);
-
-
-      bs.seek(offset * BITS_PER_BYTE);
-      pw.move_y(y);
-
-      offset += ((bs.read(offset_width) + 2) * BYTES_PER_WORD);
-
-      ::unpack_row(bs,pw,bpp_);
-    }
+  std::vector<std::size_t> offsets;
+
+  offset_width = ::calc_offset_width(BPP);
+  ::packed_row_offsets(pdat_,bitmap_.h,offset_width,offsets);
+  ::unpack_rows<PixelWriterCoded<BPP>>(pdat_,bitmap_,BPP,offset_width,offsets,
+                                       [&](PixelWriterCoded<BPP> &pw_)
+                                       {
+                                         pw_.init(bitmap_,plut_,pluta_,pdv_);
+                                       });
+
+  if(offsets.size() < bitmap_.h)
+    throw fmt::exception("attempted out of bound read - {} {}:{}",
+                         __FILE__,__FUNCTION__,__LINE__);
 }
 
 void
@@ -1082,7 +1572,7 @@ convert::coded_packed_linear_1bpp_to_bitmap(cPDAT          pdat_,
                                             const u8  pluta_,
                                             Bitmap        &bitmap_)
 {
-  ::coded_packed_linear_to_bitmap(1,pdat_,plut_,pluta_,bitmap_);
+  ::coded_packed_linear_to_bitmap<1>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1091,7 +1581,7 @@ convert::coded_packed_linear_2bpp_to_bitmap(cPDAT          pdat_,
                                             const u8  pluta_,
                                             Bitmap        &bitmap_)
 {
-  ::coded_packed_linear_to_bitmap(2,pdat_,plut_,pluta_,bitmap_);
+  ::coded_packed_linear_to_bitmap<2>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1100,7 +1590,7 @@ convert::coded_packed_linear_4bpp_to_bitmap(cPDAT          pdat_,
                                             const u8  pluta_,
                                             Bitmap        &bitmap_)
 {
-  ::coded_packed_linear_to_bitmap(4,pdat_,plut_,pluta_,bitmap_);
+  ::coded_packed_linear_to_bitmap<4>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1109,7 +1599,7 @@ convert::coded_packed_linear_6bpp_to_bitmap(cPDAT          pdat_,
                                             const u8  pluta_,
                                             Bitmap        &bitmap_)
 {
-  ::coded_packed_linear_to_bitmap(6,pdat_,plut_,pluta_,bitmap_);
+  ::coded_packed_linear_to_bitmap<6>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1118,35 +1608,7 @@ convert::coded_packed_linear_8bpp_to_bitmap(cPDAT       pdat_,
                                             const u32   pdv_,
                                             Bitmap     &bitmap_)
 {
-  PixelWriterCoded8bppAMV pw;
-  u32 offset;
-  u32 offset_width;
-  BitStreamReader bs(pdat_);
-  const u32 bpp = 8;
-
-  offset = 0;
-  offset_width = ::calc_offset_width(8);
-  pw.init(bitmap_,plut_,pdv_);
-  for(u64 y = 0; y < bitmap_.h; y++)
-    {
-      if((offset * BITS_PER_BYTE) >= bs.size())
-        throw fmt::exception("attempted out of bound read - {} {}:{}",
-                             __FILE__,__FUNCTION__,__LINE__);
-
-
-      bs.seek(offset * BITS_PER_BYTE);
-      pw.move_y(y);
-
-      offset += ((bs.read(offset_width) + 2) * BYTES_PER_WORD);
-
-      ::unpack_row(bs,pw,bpp);
-    }
-
-
-  return;
-
-
-  ::coded_packed_linear_to_bitmap(8,pdat_,plut_,0,bitmap_);
+  ::coded_packed_linear_to_bitmap<8>(pdat_,plut_,0,pdv_,bitmap_);
 }
 
 void
@@ -1155,30 +1617,28 @@ convert::coded_packed_linear_16bpp_to_bitmap(cPDAT          pdat_,
                                              const u8  pluta_,
                                              Bitmap        &bitmap_)
 {
-  ::coded_packed_linear_to_bitmap(16,pdat_,plut_,pluta_,bitmap_);
+  ::coded_packed_linear_to_bitmap<16>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
+template<u8 BPP>
 static
 void
-coded_unpacked_linear_to_bitmap(const u32  bpp_,
-                                cPDAT           pdat_,
-                                const PLUT     &plut_,
-                                const u8   pluta_,
-                                Bitmap         &bitmap_)
+coded_unpacked_linear_to_bitmap(cPDAT       pdat_,
+                                const PLUT &plut_,
+                                const u8    pluta_,
+                                const u32   pdv_,
+                                Bitmap     &bitmap_)
 {
-  u32 p;
-  PixelWriter pw;
+  PixelWriterCoded<BPP> pw;
+  std::vector<u32> row;
   BitStreamReader bs(pdat_);
 
-  pw.reset(bitmap_,plut_,pluta_,bpp_);
+  row.resize(bitmap_.w);
+  pw.init(bitmap_,plut_,pluta_,pdv_);
   for(size_t y = 0; y < bitmap_.h; y++)
     {
-      for(size_t x = 0; x < bitmap_.w; x++)
-        {
-          p = bs.read(bpp_);
-
-          pw.write(p);
-        }
+      bs.read_n(BPP,row.data(),row.size());
+      pw.literal(row.data(),row.size());
 
       bs.skip_to_32bit_boundary();
     }
@@ -1190,7 +1650,7 @@ convert::coded_unpacked_linear_1bpp_to_bitmap(cPDAT          pdat_,
                                               const u8  pluta_,
                                               Bitmap        &bitmap_)
 {
-  ::coded_unpacked_linear_to_bitmap(1,pdat_,plut_,pluta_,bitmap_);
+  ::coded_unpacked_linear_to_bitmap<1>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1199,7 +1659,7 @@ convert::coded_unpacked_linear_2bpp_to_bitmap(cPDAT          pdat_,
                                               const u8  pluta_,
                                               Bitmap        &bitmap_)
 {
-  ::coded_unpacked_linear_to_bitmap(2,pdat_,plut_,pluta_,bitmap_);
+  ::coded_unpacked_linear_to_bitmap<2>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1208,7 +1668,7 @@ convert::coded_unpacked_linear_4bpp_to_bitmap(cPDAT          pdat_,
                                               const u8  pluta_,
                                               Bitmap        &bitmap_)
 {
-  ::coded_unpacked_linear_to_bitmap(4,pdat_,plut_,pluta_,bitmap_);
+  ::coded_unpacked_linear_to_bitmap<4>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1217,7 +1677,7 @@ convert::coded_unpacked_linear_6bpp_to_bitmap(cPDAT          pdat_,
                                               const u8  pluta_,
                                               Bitmap        &bitmap_)
 {
-  ::coded_unpacked_linear_to_bitmap(6,pdat_,plut_,pluta_,bitmap_);
+  ::coded_unpacked_linear_to_bitmap<6>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
@@ -1226,23 +1686,7 @@ convert::coded_unpacked_linear_8bpp_to_bitmap(cPDAT          pdat_,
                                               const u32      pdv_,
                                               Bitmap        &bitmap_)
 {
-  u32 p;
-  const u32 bpp = 8;
-  BitStreamReader bs(pdat_);
-  PixelWriterCoded8bppAMV pw;
-
-  pw.init(bitmap_,plut_,pdv_);
-  for(size_t y = 0; y < bitmap_.h; y++)
-    {
-      for(size_t x = 0; x < bitmap_.w; x++)
-        {
-          p = bs.read(bpp);
-
-          pw.write(p);
-        }
-
-      bs.skip_to_32bit_boundary();
-    }
+  ::coded_unpacked_linear_to_bitmap<8>(pdat_,plut_,0,pdv_,bitmap_);
 }
 
 void
@@ -1251,7 +1695,7 @@ convert::coded_unpacked_linear_16bpp_to_bitmap(cPDAT          pdat_,
                                                const u8  pluta_,
                                                Bitmap        &bitmap_)
 {
-  ::coded_unpacked_linear_to_bitmap(16,pdat_,plut_,pluta_,bitmap_);
+  ::coded_unpacked_linear_to_bitmap<16>(pdat_,plut_,pluta_,1,bitmap_);
 }
 
 void
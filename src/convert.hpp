@@ -20,12 +20,15 @@
 
 #include "bitmap.hpp"
 #include "bitmaps.hpp"
+#include "frame.hpp"
 #include "pdat.hpp"
 #include "plut.hpp"
 #include "span.hpp"
 #include "types_ints.h"
 
 #include <filesystem>
+#include <functional>
+#include <vector>
 
 
 union CelType
@@ -62,6 +65,68 @@ namespace convert
                  BitmapVec &bitmaps);
   void to_bitmap(const std::filesystem::path &filepath,
                  BitmapVec                   &bitmaps);
+  void to_bitmap(const std::filesystem::path &filepath,
+                 cspan<u8>                    data,
+                 BitmapVec                   &bitmaps);
+
+  void cel_to_frames(cspan<u8>  data,
+                     FrameVec  &frames);
+  void anim_to_frames(cspan<u8>  data,
+                      FrameVec  &frames);
+  void imag_to_frames(cspan<u8>  data,
+                      FrameVec  &frames);
+  void nfs_shpm_to_frames(cspan<u8>  data,
+                          FrameVec  &frames);
+  void nfs_wwww_to_frames(cspan<u8>  data,
+                          FrameVec  &frames);
+
+  void to_frames(cspan<u8>  data,
+                 FrameVec  &frames);
+  // Decodes frame idx setting the same metadata as to_bitmap().
+  void frame_to_bitmap(const FrameVec &frames,
+                       const size_t    idx,
+                       Bitmap         &bitmap);
+  // Sets rows to frame idx's own RowSource, leaving bitmap with just
+  // the size and metadata frame_to_bitmap() would give it, or for a
+  // frame which can't stream decodes into bitmap and reads the rows
+  // from it. bitmap must outlive rows. False if the frame holds no
+  // image.
+  bool frame_to_rows(const FrameVec &frames,
+                     const size_t    idx,
+                     Bitmap         &bitmap,
+                     RowSource      &rows);
+  // The rows of an already decoded bitmap, which must outlive them.
+  RowSource bitmap_rows(const Bitmap &bitmap);
+  // Decodes every frame on the thread pool then appends the images,
+  // and each frame's Log output, in order. A frame's exception is
+  // rethrown after the output of those before it as though they had
+  // been decoded one after another.
+  void frames_to_bitmap(const FrameVec &frames,
+                        BitmapVec      &bitmaps);
+
+  typedef std::function<bool(const u64)> FrameFilter;
+  typedef std::function<void(const size_t,Bitmap&)> FrameFunc;
+
+  // Positions of the frames holding the images selected accepts by
+  // number, or of every frame, placeholders included, if it's empty.
+  std::vector<size_t> select_frames(const FrameVec    &frames,
+                                    const FrameFilter &selected);
+  // How many of frames hold an image.
+  u64 frame_images(const FrameVec &frames);
+  // Calls fn for each frame of idxs in order. Those whose position
+  // decode accepts (every one if it's empty) are decoded first, as
+  // frame_to_bitmap() would, on the thread pool a window of about its
+  // size at a time so only that many images are held at once. The
+  // rest get an empty bitmap. Each frame's Log output comes before its
+  // call and its exception is rethrown in its place, as though they
+  // had been decoded one after another.
+  void for_each_frame(const FrameVec            &frames,
+                      const std::vector<size_t> &idxs,
+                      const FrameFilter         &decode,
+                      const FrameFunc           &fn);
+
+  // Colors a coded CEL of bpp can use.
+  int coded_colors(const int bpp);
 
   void bitmap_to_cel(const Bitmap  &bitmap,
                      const CelType &celtype,
@@ -100,6 +165,13 @@ namespace convert
                                              ByteVec      &pdat,
                                              PLUT         &plut);
 
+  // Any coded bpp against an already built PLUT. No color count
+  // check.
+  void bitmap_to_coded_unpacked_linear(const Bitmap &bitmap,
+                                       const u8      bpp,
+                                       const PLUT   &plut,
+                                       ByteVec      &pdat);
+
   void bitmap_to_coded_packed_linear_1bpp(const Bitmap &bitmap,
                                           ByteVec      &pdat,
                                           PLUT         &plut);
@@ -21,9 +21,11 @@
 #include "byte_reader.hpp"
 #include "char4literal.hpp"
 #include "chunkid.hpp"
+#include "log.hpp"
 
 #include "fmt.hpp"
 
+#include <exception>
 #include <vector>
 
 #include <cctype>
@@ -156,7 +158,7 @@ namespace l
         convert::uncoded_unpacked_linear_16bpp_to_bitmap(br,bitmap_);
         break;
       default:
-        fmt::print(" * WARNING - unknown NFS SHPM type: 0x{:02x}; offset: {}\n",
+        Log::print(" * WARNING - unknown NFS SHPM type: 0x{:02x}; offset: {}\n",
                    type,
                    data_.off() + obj_offset_);
       }
@@ -164,42 +166,63 @@ namespace l
 }
 
 void
-convert::nfs_shpm_to_bitmap(cspan<uint8_t>  data_,
-                            BitmapVec      &bitmaps_)
+convert::nfs_shpm_to_frames(cspan<uint8_t>  data_,
+                            FrameVec       &frames_)
 {
   ByteReader br;
   char obj_id[5];
   uint32_t obj_count;
   uint32_t obj_offset;
 
-  br.reset(data_);
-
-  br.seek(8);
-  br.readbe(obj_count);
-  br.seek(16);
-  for(uint32_t i = 0; i < obj_count; i++)
+  // A truncated object table still yields the objects before the
+  // error, which is then raised in the place of the next object.
+  try
     {
-      Bitmap bitmap;
+      br.reset(data_);
 
-      br.read(obj_id,4);
-      obj_id[4] = 0;
-      br.readbe(obj_offset);
-
-      switch(CHAR4LITERAL(obj_id[0],obj_id[1],obj_id[2],obj_id[3]))
+      br.seek(8);
+      br.readbe(obj_count);
+      br.seek(16);
+      for(uint32_t i = 0; i < obj_count; i++)
         {
-        case CHAR4LITERAL('p','l','t','0'):
-        case CHAR4LITERAL('p','l','t','1'):
-        case CHAR4LITERAL('p','l','t','2'):
-        case CHAR4LITERAL('p','l','t','3'):
-        case CHAR4LITERAL('!','o','r','i'):
-          continue;
-        }
-
-      l::nfs_shpm_obj_to_bitmap(data_,obj_offset,bitmap);
-      if(bitmap)
-        {
-          bitmap.set("name",l::strip(obj_id));
-          bitmaps_.emplace_back(bitmap);
+          br.read(obj_id,4);
+          obj_id[4] = 0;
+          br.readbe(obj_offset);
+
+          switch(CHAR4LITERAL(obj_id[0],obj_id[1],obj_id[2],obj_id[3]))
+            {
+            case CHAR4LITERAL('p','l','t','0'):
+            case CHAR4LITERAL('p','l','t','1'):
+            case CHAR4LITERAL('p','l','t','2'):
+            case CHAR4LITERAL('p','l','t','3'):
+            case CHAR4LITERAL('!','o','r','i'):
+              continue;
+            }
+
+          frames_.push_back({[data_,obj_offset,name = l::strip(obj_id)](Bitmap &b_)
+          {
+            l::nfs_shpm_obj_to_bitmap(data_,obj_offset,b_);
+            if(b_)
+              b_.set("name",name);
+          }});
         }
     }
+  catch(...)
+    {
+      frames_.push_back({[error = std::current_exception()](Bitmap &b_)
+      {
+        std::rethrow_exception(error);
+      }});
+      frames_.back().image = false;
+    }
+}
+
+void
+convert::nfs_shpm_to_bitmap(cspan<uint8_t>  data_,
+                            BitmapVec      &bitmaps_)
+{
+  FrameVec frames;
+
+  convert::nfs_shpm_to_frames(data_,frames);
+  convert::frames_to_bitmap(frames,bitmaps_);
 }
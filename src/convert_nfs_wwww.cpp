@@ -19,48 +19,128 @@
 #include "convert.hpp"
 
 #include "byte_reader.hpp"
+#include "log.hpp"
 
 #include "fmt.hpp"
 
+#include <exception>
+#include <vector>
+
 
 // https://3dodev.com/documentation/file_formats/games/nfs
 
 
-void
-convert::nfs_wwww_to_bitmap(cspan<uint8_t>  data_,
-                            BitmapVec      &bitmaps_)
+namespace l
 {
-  ByteReader br;
-  uint32_t chunk_count;
+  static
+  void
+  warn(const std::exception_ptr &error_,
+       cspan<uint8_t>            data_)
+  {
+    try
+      {
+        std::rethrow_exception(error_);
+      }
+    catch(const std::system_error &e_)
+      {
+        Log::print(" * WARNING - {} ({}): offset={}\n",e_.what(),e_.code().message(),data_.off());
+      }
+    catch(const std::runtime_error &e_)
+      {
+        Log::print(" * WARNING - {}: offset={}\n",e_.what(),data_.off());
+      }
+  }
 
-  br.reset(data_);
+  // A chunk which can't be decoded is reported and skipped rather
+  // than failing the whole file.
+  static
+  Frame
+  guarded(const Frame    &frame_,
+          cspan<uint8_t>  data_)
+  {
+    Frame frame;
 
-  br.skip(4); // "wwww"
-  chunk_count = br.u32be();
-
-  for(uint32_t i = 1; i <= chunk_count; i++)
+    frame.decode = [frame_,data_](Bitmap &b_)
     {
-      uint32_t start_offset;
-      uint32_t end_offset;
-
-      start_offset = br.u32be();
-      if(start_offset == 0)
-        continue;
-      end_offset = ((i != chunk_count) ? br.u32be() : data_.size());
-      br.rewind(4);
-
-      cspan<uint8_t> data = data_(start_offset,end_offset);
       try
         {
-          convert::to_bitmap(data,bitmaps_);
+          frame_.decode(b_);
         }
-      catch(const std::system_error &e_)
+      catch(...)
         {
-          fmt::print(" * WARNING - {} ({}): offset={}\n",e_.what(),e_.code().message(),data.off());
+          b_ = Bitmap();
+          l::warn(std::current_exception(),data_);
         }
-      catch(const std::runtime_error &e_)
+    };
+    frame.image = frame_.image;
+
+    return frame;
+  }
+}
+
+void
+convert::nfs_wwww_to_frames(cspan<uint8_t>  data_,
+                            FrameVec       &frames_)
+{
+  ByteReader br;
+  uint32_t chunk_count;
+
+  // A truncated offset table still yields the chunks before the
+  // error, which is then raised in the place of the next chunk.
+  try
+    {
+      br.reset(data_);
+
+      br.skip(4); // "wwww"
+      chunk_count = br.u32be();
+
+      for(uint32_t i = 1; i <= chunk_count; i++)
         {
-          fmt::print(" * WARNING - {}: offset={}\n",e_.what(),data.off());
+          uint32_t start_offset;
+          uint32_t end_offset;
+          FrameVec frames;
+
+          start_offset = br.u32be();
+          if(start_offset == 0)
+            continue;
+          end_offset = ((i != chunk_count) ? br.u32be() : data_.size());
+          br.rewind(4);
+
+          cspan<uint8_t> data = data_(start_offset,end_offset);
+          try
+            {
+              convert::to_frames(data,frames);
+            }
+          catch(...)
+            {
+              frames_.push_back({[error = std::current_exception(),data](Bitmap &b_)
+              {
+                l::warn(error,data);
+              }});
+              frames_.back().image = false;
+              continue;
+            }
+
+          for(const auto &frame : frames)
+            frames_.emplace_back(l::guarded(frame,data));
         }
     }
+  catch(...)
+    {
+      frames_.push_back({[error = std::current_exception()](Bitmap &b_)
+      {
+        std::rethrow_exception(error);
+      }});
+      frames_.back().image = false;
+    }
+}
+
+void
+convert::nfs_wwww_to_bitmap(cspan<uint8_t>  data_,
+                            BitmapVec      &bitmaps_)
+{
+  FrameVec frames;
+
+  convert::nfs_wwww_to_frames(data_,frames);
+  convert::frames_to_bitmap(frames,bitmaps_);
 }
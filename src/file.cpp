@@ -1,6 +1,9 @@
 #include "file.hpp"
 
 #include "byteswap.hpp"
+#include "output_files.hpp"
+
+#include <cstring>
 
 
 File::File()
@@ -17,6 +20,9 @@ File::open(const std::filesystem::path &filepath_,
   _file = fopen(filepath_.string().c_str(),mode_);
   if((_file == NULL) || (ferror(_file) != 0))
     throw std::system_error(errno,std::system_category(),"failed to open "+filepath_.string());
+
+  if(strpbrk(mode_,"wa+"))
+    OutputFiles::add(filepath_);
 }
 
 void
@@ -1,6 +1,9 @@
 #include "filerw.hpp"
 
+#include "output_files.hpp"
+
 #include <cstdint>
+#include <cstring>
 #include <errno.h>
 
 
@@ -20,8 +23,13 @@ FileRW::open(char const *filepath_,
              char const *mode_)
 {
   _file = fopen(filepath_,mode_);
+  if(_file == NULL)
+    return -errno;
+
+  if(strpbrk(mode_,"wa+"))
+    OutputFiles::add(filepath_);
 
-  return ((_file == NULL) ? -errno : 0);
+  return 0;
 }
 
 int
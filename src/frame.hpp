@@ -0,0 +1,61 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "bitmap.hpp"
+#include "row_sink.hpp"
+#include "types_ints.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/*
+  An image located within a file but not yet decoded. Finding the
+  frames of a file reads only its headers and chunk or object tables
+  and captures what each frame needs (CCB, PLUT, PDAT span...).
+  decode() then produces the pixels on demand so pulling a few images
+  out of a large ANIM or SHPM doesn't mean decoding, or holding, all
+  of them. It leaves the bitmap empty for an entry which turns out to
+  hold no image. The file's data must outlive the frames.
+
+  Formats whose rows can be decoded a strip at a time also provide
+  rows() which feeds the same pixels decode() would produce to a
+  RowSink without ever holding more than a strip, w by h, of them.
+  w and h are only meaningful when rows is set.
+
+  Entries the scan already knows hold no image, placeholders which
+  only report why an entry couldn't be read and CELs of no size, have
+  image cleared. The rest are numbered in order by
+  convert::to_frames(): number is what --index selects and index the
+  metadata their image gets, the same as to_bitmap() gives it.
+*/
+struct Frame
+{
+  std::function<void(Bitmap&)> decode;
+  u64                          w = 0;
+  u64                          h = 0;
+  RowSource                    rows;
+  bool                         image = true;
+  u64                          number = 0;
+  std::string                  index;
+};
+
+typedef std::vector<Frame> FrameVec;
@@ -0,0 +1,165 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "hash.hpp"
+
+#include <cstring>
+
+
+namespace l
+{
+  static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+  static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+  static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+  static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+  static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+  static
+  inline
+  uint64_t
+  rotl(const uint64_t x_,
+       const int      r_)
+  {
+    return ((x_ << r_) | (x_ >> (64 - r_)));
+  }
+
+  static
+  inline
+  uint64_t
+  read64(const uint8_t *p_)
+  {
+    uint64_t v;
+
+    std::memcpy(&v,p_,sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+
+    return v;
+  }
+
+  static
+  inline
+  uint32_t
+  read32(const uint8_t *p_)
+  {
+    uint32_t v;
+
+    std::memcpy(&v,p_,sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+
+    return v;
+  }
+
+  static
+  inline
+  uint64_t
+  round(uint64_t       acc_,
+        const uint64_t input_)
+  {
+    acc_ += (input_ * PRIME2);
+    acc_  = l::rotl(acc_,31);
+    acc_ *= PRIME1;
+
+    return acc_;
+  }
+
+  static
+  inline
+  uint64_t
+  merge_round(uint64_t       acc_,
+              const uint64_t val_)
+  {
+    acc_ ^= l::round(0,val_);
+    acc_  = (acc_ * PRIME1) + PRIME4;
+
+    return acc_;
+  }
+}
+
+uint64_t
+Hash::xxh64(const void     *data_,
+            const size_t    size_,
+            const uint64_t  seed_)
+{
+  uint64_t h;
+  const uint8_t *p   = (const uint8_t*)data_;
+  const uint8_t *end = p + size_;
+
+  if(size_ >= 32)
+    {
+      uint64_t v1 = seed_ + l::PRIME1 + l::PRIME2;
+      uint64_t v2 = seed_ + l::PRIME2;
+      uint64_t v3 = seed_;
+      uint64_t v4 = seed_ - l::PRIME1;
+      const uint8_t *limit = end - 32;
+
+      do
+        {
+          v1 = l::round(v1,l::read64(p));
+          v2 = l::round(v2,l::read64(p + 8));
+          v3 = l::round(v3,l::read64(p + 16));
+          v4 = l::round(v4,l::read64(p + 24));
+          p += 32;
+        }
+      while(p <= limit);
+
+      h = (l::rotl(v1,1) + l::rotl(v2,7) + l::rotl(v3,12) + l::rotl(v4,18));
+      h = l::merge_round(h,v1);
+      h = l::merge_round(h,v2);
+      h = l::merge_round(h,v3);
+      h = l::merge_round(h,v4);
+    }
+  else
+    {
+      h = seed_ + l::PRIME5;
+    }
+
+  h += (uint64_t)size_;
+
+  while((p + 8) <= end)
+    {
+      h ^= l::round(0,l::read64(p));
+      h  = (l::rotl(h,27) * l::PRIME1) + l::PRIME4;
+      p += 8;
+    }
+
+  if((p + 4) <= end)
+    {
+      h ^= ((uint64_t)l::read32(p) * l::PRIME1);
+      h  = (l::rotl(h,23) * l::PRIME2) + l::PRIME3;
+      p += 4;
+    }
+
+  while(p < end)
+    {
+      h ^= ((*p) * l::PRIME5);
+      h  = l::rotl(h,11) * l::PRIME1;
+      p++;
+    }
+
+  h ^= (h >> 33);
+  h *= l::PRIME2;
+  h ^= (h >> 29);
+  h *= l::PRIME3;
+  h ^= (h >> 32);
+
+  return h;
+}
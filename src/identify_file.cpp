@@ -18,56 +18,497 @@
 
 #include "identify_file.hpp"
 
-#include "read_file.hpp"
-
+#include "byteswap.hpp"
+#include "cel_control_chunk.hpp"
+#include "image_control_chunk.hpp"
+#include "mapped_file.hpp"
+#include "opera_fs.hpp"
 #include "stbi.hpp"
+#include "video_image.hpp"
 
+#include <cctype>
+#include <cerrno>
 #include <cstring>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Every format identified here can be recognized from its first few
+// hundred bytes. JPEG is the exception: its SOFn marker can sit
+// behind arbitrarily large APPn segments.
+#define HEADER_SIZE 4096
+
+
+namespace l
+{
+  // Random access to a file's bytes which serves the first
+  // HEADER_SIZE bytes from memory and everything else either from a
+  // span or with pread so probing never touches more of the file than
+  // the headers it walks.
+  class Reader
+  {
+  public:
+    Reader(cspan<uint8_t> data_)
+      : _fd(-1),
+        _size(data_.size()),
+        _data(data_)
+    {
+      _head = data_(0,std::min<size_t>(data_.size(),HEADER_SIZE));
+    }
+
+#ifndef _WIN32
+    Reader(const int       fd_,
+           const uint64_t  size_,
+           const fs::path &filepath_)
+      : _fd(fd_),
+        _size(size_),
+        _filepath(filepath_)
+    {
+      _buf.resize(std::min<uint64_t>(size_,HEADER_SIZE));
+      _buf.resize(pread(0,_buf.data(),_buf.size()));
+      _head = cspan<uint8_t>(_buf.data(),_buf.size());
+    }
+#endif
+
+  public:
+    uint64_t
+    size() const
+    {
+      return _size;
+    }
+
+    cspan<uint8_t>
+    head() const
+    {
+      return _head;
+    }
+
+    bool
+    read(const uint64_t  off_,
+         void           *buf_,
+         const size_t    len_)
+    {
+      if((off_ + len_) > _size)
+        return false;
+      if(((off_ + len_) > _head.size()) && (_fd != -1))
+        return (pread(off_,buf_,len_) == len_);
+
+      if((off_ + len_) <= _head.size())
+        memcpy(buf_,&_head[off_],len_);
+      else
+        memcpy(buf_,&_data[off_],len_);
+
+      return true;
+    }
+
+  private:
+#ifndef _WIN32
+    size_t
+    pread(uint64_t  off_,
+          void     *buf_,
+          size_t    len_)
+    {
+      size_t done;
+      ssize_t rv;
+
+      done = 0;
+      while(done < len_)
+        {
+          rv = ::pread(_fd,(uint8_t*)buf_ + done,len_ - done,off_ + done);
+          if((rv == -1) && (errno == EINTR))
+            continue;
+          if(rv == -1)
+            throw std::system_error(errno,std::system_category(),
+                                    "failed to read "+_filepath.string());
+          if(rv == 0)
+            break;
+          done += rv;
+        }
+
+      return done;
+    }
+#else
+    size_t
+    pread(uint64_t,
+          void*,
+          size_t)
+    {
+      return 0;
+    }
+#endif
+
+  private:
+    int            _fd;
+    uint64_t       _size;
+    fs::path       _filepath;
+    ByteVec        _buf;
+    cspan<uint8_t> _data;
+    cspan<uint8_t> _head;
+  };
+
+  static
+  uint32_t
+  magic(cspan<uint8_t> data_)
+  {
+    uint32_t type;
+
+    if(data_.size() < 4)
+      return FILE_ID_UNKNOWN;
+
+    type = CHAR4LITERAL(data_[0],data_[1],data_[2],data_[3]);
+    switch(type)
+      {
+      case FILE_ID_3DO:
+      case FILE_ID_3DO_CEL:
+      case FILE_ID_3DO_IMAGE:
+      case FILE_ID_3DO_ANIM:
+      case FILE_ID_NFS_SHPM:
+      case FILE_ID_NFS_WWWW:
+        return type;
+      default:
+        break;
+      }
+
+    if((data_.size() >= 8) && !memcmp(&data_[0],"\x01""APPSCRN",8))
+      return FILE_ID_3DO_BANNER;
+
+    return FILE_ID_UNKNOWN;
+  }
+
+  static
+  uint32_t
+  lrform(const uint64_t size_)
+  {
+    if(size_ == (320 * 240 * 2))
+      return FILE_ID_3DO_LRFORM;
+    if(size_ == (352 * 288 * 2))
+      return FILE_ID_3DO_LRFORM;
+
+    return FILE_ID_UNKNOWN;
+  }
+
+  static
+  uint32_t
+  u32be(const uint8_t *p_)
+  {
+    return ((p_[0] << 24) | (p_[1] << 16) | (p_[2] << 8) | (p_[3] << 0));
+  }
+
+  static
+  uint16_t
+  u16be(const uint8_t *p_)
+  {
+    return ((p_[0] << 8) | (p_[1] << 0));
+  }
+
+  // Walks the chunk headers only. The image count is the number of
+  // PDAT chunks which covers plain CELs, IMAGs and ANIM frames alike.
+  static
+  void
+  probe_3do_chunks(Reader             &r_,
+                   IdentifyFile::Info &info_)
+  {
+    uint64_t off;
+    uint8_t  hdr[8];
+
+    off = 0;
+    while(r_.read(off,hdr,sizeof(hdr)))
+      {
+        uint32_t id;
+        uint32_t size;
+
+        if(!isprint(hdr[0]) || !isprint(hdr[1]) ||
+           !isprint(hdr[2]) || !isprint(hdr[3]))
+          break;
+
+        id   = l::u32be(&hdr[0]);
+        size = l::u32be(&hdr[4]);
+        if((size < sizeof(hdr)) || ((off + size) > r_.size()))
+          break;
+
+        switch(id)
+          {
+          case CHUNK_CCB:
+            if(info_.w == 0)
+              {
+                CelControlChunk ccc;
+
+                if(!r_.read(off,&ccc,sizeof(ccc)))
+                  break;
+                ccc.byteswap_if_little_endian();
+                info_.w   = ccc.ccb_Width;
+                info_.h   = ccc.ccb_Height;
+                info_.bpp = ccc.bpp();
+              }
+            break;
+          case CHUNK_IMAG:
+            if(info_.w == 0)
+              {
+                ImageControlChunk icc;
+
+                if(!r_.read(off,&icc,sizeof(icc)))
+                  break;
+                icc.byteswap_if_little_endian();
+                info_.w   = icc.w;
+                info_.h   = icc.h;
+                info_.bpp = icc.bitsperpixel;
+              }
+            break;
+          case CHUNK_PDAT:
+            info_.count++;
+            break;
+          }
+
+        off += size;
+      }
+  }
+
+  static
+  void
+  probe_3do_banner(Reader             &r_,
+                   IdentifyFile::Info &info_)
+  {
+    VideoImage vi;
+
+    if(!r_.read(0,&vi,sizeof(vi)))
+      return;
+
+    info_.w     = byteswap_if_little_endian(vi.vi_Width);
+    info_.h     = byteswap_if_little_endian(vi.vi_Height);
+    info_.bpp   = vi.vi_Depth;
+    info_.count = 1;
+  }
+
+  // See convert_nfs_shpm.cpp for the layout.
+  static
+  void
+  probe_nfs_shpm(Reader             &r_,
+                 IdentifyFile::Info &info_)
+  {
+    static const uint8_t bpp[8] = {0,1,2,4,6,8,16,0};
+    uint8_t  buf[8];
+    uint32_t obj_count;
+
+    if(!r_.read(8,buf,4))
+      return;
+
+    obj_count = l::u32be(buf);
+    for(uint32_t i = 0; i < obj_count; i++)
+      {
+        uint32_t id;
+        uint32_t obj_offset;
+
+        if(!r_.read(16 + (i * 8),buf,8))
+          break;
 
+        id         = l::u32be(&buf[0]);
+        obj_offset = l::u32be(&buf[4]);
+        switch(id)
+          {
+          case CHAR4LITERAL('p','l','t','0'):
+          case CHAR4LITERAL('p','l','t','1'):
+          case CHAR4LITERAL('p','l','t','2'):
+          case CHAR4LITERAL('p','l','t','3'):
+          case CHAR4LITERAL('!','o','r','i'):
+            continue;
+          }
 
+        info_.count++;
+        if((info_.w == 0) && r_.read(obj_offset,buf,8))
+          {
+            info_.bpp = bpp[buf[0] & 0x07];
+            info_.w   = l::u16be(&buf[4]);
+            info_.h   = l::u16be(&buf[6]);
+          }
+      }
+  }
+
+  static
+  void
+  probe_stbi(cspan<uint8_t>      head_,
+             IdentifyFile::Info &info_)
+  {
+    int x;
+    int y;
+    int comp;
+
+    info_.type = stbi_identify(head_,&x,&y,&comp);
+    if(info_.type == FILE_ID_UNKNOWN)
+      return;
+
+    info_.w     = x;
+    info_.h     = y;
+    info_.bpp   = comp * 8;
+    info_.count = 1;
+    switch(info_.type)
+      {
+      case FILE_ID_PNG:
+        // IHDR: bit depth at 24, color type at 25
+        info_.bpp = head_[24] * ((head_[25] == 3) ? 1 : comp);
+        break;
+      case FILE_ID_BMP:
+        info_.bpp = (head_[28] | (head_[29] << 8));
+        break;
+      case FILE_ID_GIF:
+        // frames are only found by decoding
+        info_.count = 0;
+        break;
+      }
+  }
+
+  // Returns false when the headers weren't enough and the whole file
+  // needs to be looked at.
+  static
+  bool
+  probe(Reader             &r_,
+        IdentifyFile::Info &info_)
+  {
+    cspan<uint8_t> head;
+
+    head = r_.head();
+
+    info_ = {};
+    info_.type = l::magic(head);
+    switch(info_.type)
+      {
+      case FILE_ID_3DO:
+      case FILE_ID_3DO_CEL:
+      case FILE_ID_3DO_IMAGE:
+      case FILE_ID_3DO_ANIM:
+        l::probe_3do_chunks(r_,info_);
+        return true;
+      case FILE_ID_3DO_BANNER:
+        l::probe_3do_banner(r_,info_);
+        return true;
+      case FILE_ID_NFS_SHPM:
+        l::probe_nfs_shpm(r_,info_);
+        return true;
+      case FILE_ID_NFS_WWWW:
+        return true;
+      }
+
+    l::probe_stbi(head,info_);
+    if(info_.type != FILE_ID_UNKNOWN)
+      return true;
+
+    if((head.size() < r_.size()) &&
+       (head.size() >= 2) &&
+       (head[0] == 0xFF) &&
+       (head[1] == 0xD8))
+      return false;
+
+    info_.type = l::lrform(r_.size());
+    if(info_.type == FILE_ID_UNKNOWN)
+      return true;
+
+    info_.w     = ((r_.size() == (320 * 240 * 2)) ? 320 : 352);
+    info_.h     = ((r_.size() == (320 * 240 * 2)) ? 240 : 288);
+    info_.bpp   = 16;
+    info_.count = 1;
+
+    return true;
+  }
+}
+
+// The 3DO magics are checked before asking stb_image. None of them
+// can pass stb_image's probes (TGA, the loosest, requires the second
+// byte to be 0 or 1) so the order doesn't change the result but saves
+// nine probes per 3DO file.
 uint32_t
 IdentifyFile::identify(cspan<uint8_t> data_)
 {
   uint32_t type;
 
+  type = l::magic(data_);
+  if(type != FILE_ID_UNKNOWN)
+    return type;
+
   type = stbi_identify(data_);
   if(type != FILE_ID_UNKNOWN)
     return type;
 
-  type = CHAR4LITERAL(data_[0],data_[1],data_[2],data_[3]);
-  switch(type)
-    {
-    case FILE_ID_3DO:
-    case FILE_ID_3DO_CEL:
-    case FILE_ID_3DO_IMAGE:
-    case FILE_ID_3DO_ANIM:
-    case FILE_ID_NFS_SHPM:
-    case FILE_ID_NFS_WWWW:
-      return type;
-    default:
-      break;
-    }
+  return l::lrform(data_.size());
+}
 
-  if(!memcmp(&data_[0],"\x01""APPSCRN",8))
-    return FILE_ID_3DO_BANNER;
+uint32_t
+IdentifyFile::identify(const fs::path &filepath_)
+{
+  return IdentifyFile::probe(filepath_).type;
+}
 
-  if(data_.size() == (320 * 240 * 2))
-    return FILE_ID_3DO_LRFORM;
-  if(data_.size() == (352 * 288 * 2))
-    return FILE_ID_3DO_LRFORM;  
+IdentifyFile::Info
+IdentifyFile::probe(cspan<uint8_t> data_)
+{
+  IdentifyFile::Info info;
+  l::Reader r(data_);
 
-  return FILE_ID_UNKNOWN;
+  if(!l::probe(r,info))
+    {
+      l::probe_stbi(data_,info);
+      if(info.type == FILE_ID_UNKNOWN)
+        info.type = l::lrform(data_.size());
+    }
+
+  return info;
 }
 
-uint32_t
-IdentifyFile::identify(const std::filesystem::path &filepath_)
+#ifndef _WIN32
+IdentifyFile::Info
+IdentifyFile::probe(const fs::path &filepath_)
 {
-  ByteVec data;
+  int fd;
+  int rv;
+  bool done;
+  struct stat st;
+  IdentifyFile::Info info;
 
-  ReadFile::read(filepath_,data);
+  if(OperaFS::is_embedded(filepath_))
+    return IdentifyFile::probe(MappedFile(filepath_));
 
-  return IdentifyFile::identify(data);
+  fd = ::open(filepath_.c_str(),O_RDONLY|O_CLOEXEC);
+  if(fd == -1)
+    throw std::system_error(errno,std::system_category(),"failed to open "+filepath_.string());
+
+  rv = ::fstat(fd,&st);
+  if(rv == -1)
+    {
+      int err = errno;
+      ::close(fd);
+      throw std::system_error(err,std::system_category(),"failed to stat "+filepath_.string());
+    }
+
+  try
+    {
+      l::Reader r(fd,st.st_size,filepath_);
+
+      done = l::probe(r,info);
+    }
+  catch(...)
+    {
+      ::close(fd);
+      throw;
+    }
+
+  ::close(fd);
+
+  if(!done)
+    return IdentifyFile::probe(MappedFile(filepath_));
+
+  return info;
+}
+#else
+IdentifyFile::Info
+IdentifyFile::probe(const fs::path &filepath_)
+{
+  return IdentifyFile::probe(MappedFile(filepath_));
 }
+#endif
 
 bool
 IdentifyFile::chunked_type(const uint32_t type_)
@@ -83,3 +524,30 @@ IdentifyFile::chunked_type(const uint32_t type_)
       return false;
     }
 }
+
+const
+char*
+IdentifyFile::type_str(const uint32_t type_)
+{
+  switch(type_)
+    {
+    case FILE_ID_3DO:        return "3DO";
+    case FILE_ID_3DO_CEL:    return "3DO CEL";
+    case FILE_ID_3DO_IMAGE:  return "3DO IMAG";
+    case FILE_ID_3DO_ANIM:   return "3DO ANIM";
+    case FILE_ID_3DO_BANNER: return "3DO banner";
+    case FILE_ID_3DO_LRFORM: return "3DO LRFORM";
+    case FILE_ID_BMP:        return "BMP";
+    case FILE_ID_PNG:        return "PNG";
+    case FILE_ID_GIF:        return "GIF";
+    case FILE_ID_JPG:        return "JPEG";
+    case FILE_ID_PSD:        return "PSD";
+    case FILE_ID_PIC:        return "PIC";
+    case FILE_ID_PNM:        return "PNM";
+    case FILE_ID_HDR:        return "HDR";
+    case FILE_ID_TGA:        return "TGA";
+    case FILE_ID_NFS_SHPM:   return "NFS SHPM";
+    case FILE_ID_NFS_WWWW:   return "NFS wwww";
+    default:                 return "unknown";
+    }
+}
@@ -48,7 +48,21 @@
 
 namespace IdentifyFile
 {
+  // What can be learned about a file from its headers alone. Zero
+  // means unknown.
+  struct Info
+  {
+    uint32_t type  = FILE_ID_UNKNOWN;
+    uint32_t w     = 0;
+    uint32_t h     = 0;
+    uint32_t bpp   = 0;
+    uint32_t count = 0;
+  };
+
   uint32_t identify(cspan<uint8_t> data);
   uint32_t identify(const std::filesystem::path &filepath);
+  Info     probe(cspan<uint8_t> data);
+  Info     probe(const std::filesystem::path &filepath);
   bool     chunked_type(const uint32_t type);
+  const char *type_str(const uint32_t type);
 }
@@ -0,0 +1,672 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "json.hpp"
+
+#include "fmt.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace l
+{
+  class Parser
+  {
+  public:
+    Parser(std::string_view str_)
+      : _str(str_),
+        _pos(0)
+    {
+    }
+
+  public:
+    JSON::Value
+    document()
+    {
+      JSON::Value v;
+
+      v = value();
+      skip_ws();
+      if(_pos != _str.size())
+        error("trailing characters");
+
+      return v;
+    }
+
+  private:
+    [[noreturn]]
+    void
+    error(const char *msg_) const
+    {
+      throw fmt::exception("invalid JSON: {} at offset {}",msg_,_pos);
+    }
+
+    void
+    skip_ws()
+    {
+      while(_pos < _str.size())
+        {
+          switch(_str[_pos])
+            {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+              _pos++;
+              break;
+            default:
+              return;
+            }
+        }
+    }
+
+    char
+    peek()
+    {
+      skip_ws();
+      if(_pos >= _str.size())
+        error("unexpected end of input");
+
+      return _str[_pos];
+    }
+
+    void
+    expect(const char c_)
+    {
+      if(peek() != c_)
+        error("unexpected character");
+      _pos++;
+    }
+
+    void
+    literal(std::string_view lit_)
+    {
+      if(_str.substr(_pos,lit_.size()) != lit_)
+        error("unknown literal");
+      _pos += lit_.size();
+    }
+
+    JSON::Value
+    value()
+    {
+      switch(peek())
+        {
+        case '{':
+          return object();
+        case '[':
+          return array();
+        case '"':
+          return JSON::Value(string());
+        case 't':
+          literal("true");
+          return JSON::Value(true);
+        case 'f':
+          literal("false");
+          return JSON::Value(false);
+        case 'n':
+          literal("null");
+          return JSON::Value();
+        default:
+          return number();
+        }
+    }
+
+    JSON::Value
+    object()
+    {
+      JSON::Value v = JSON::Value::object();
+
+      expect('{');
+      if(peek() == '}')
+        {
+          _pos++;
+          return v;
+        }
+
+      while(true)
+        {
+          std::string key;
+
+          if(peek() != '"')
+            error("expected object key");
+          key = string();
+          expect(':');
+          v[key] = value();
+          if(peek() == ',')
+            {
+              _pos++;
+              continue;
+            }
+          expect('}');
+          return v;
+        }
+    }
+
+    JSON::Value
+    array()
+    {
+      JSON::Value v = JSON::Value(JSON::Value::Array());
+
+      expect('[');
+      if(peek() == ']')
+        {
+          _pos++;
+          return v;
+        }
+
+      while(true)
+        {
+          v.push_back(value());
+          if(peek() == ',')
+            {
+              _pos++;
+              continue;
+            }
+          expect(']');
+          return v;
+        }
+    }
+
+    unsigned
+    hex4()
+    {
+      unsigned rv = 0;
+
+      if((_pos + 4) > _str.size())
+        error("truncated \\u escape");
+
+      for(int i = 0; i < 4; i++)
+        {
+          char c = _str[_pos++];
+
+          rv <<= 4;
+          if((c >= '0') && (c <= '9'))
+            rv |= (c - '0');
+          else if((c >= 'a') && (c <= 'f'))
+            rv |= (c - 'a' + 10);
+          else if((c >= 'A') && (c <= 'F'))
+            rv |= (c - 'A' + 10);
+          else
+            error("invalid \\u escape");
+        }
+
+      return rv;
+    }
+
+    static
+    void
+    append_utf8(std::string &s_,
+                unsigned     cp_)
+    {
+      if(cp_ < 0x80)
+        {
+          s_ += (char)cp_;
+        }
+      else if(cp_ < 0x800)
+        {
+          s_ += (char)(0xC0 | (cp_ >> 6));
+          s_ += (char)(0x80 | (cp_ & 0x3F));
+        }
+      else if(cp_ < 0x10000)
+        {
+          s_ += (char)(0xE0 | (cp_ >> 12));
+          s_ += (char)(0x80 | ((cp_ >> 6) & 0x3F));
+          s_ += (char)(0x80 | (cp_ & 0x3F));
+        }
+      else
+        {
+          s_ += (char)(0xF0 | (cp_ >> 18));
+          s_ += (char)(0x80 | ((cp_ >> 12) & 0x3F));
+          s_ += (char)(0x80 | ((cp_ >> 6) & 0x3F));
+          s_ += (char)(0x80 | (cp_ & 0x3F));
+        }
+    }
+
+    std::string
+    string()
+    {
+      std::string s;
+
+      expect('"');
+      while(true)
+        {
+          char c;
+
+          if(_pos >= _str.size())
+            error("unterminated string");
+
+          c = _str[_pos++];
+          if(c == '"')
+            return s;
+          if(c != '\\')
+            {
+              s += c;
+              continue;
+            }
+
+          if(_pos >= _str.size())
+            error("unterminated string");
+
+          c = _str[_pos++];
+          switch(c)
+            {
+            case '"':
+            case '\\':
+            case '/':
+              s += c;
+              break;
+            case 'b':
+              s += '\b';
+              break;
+            case 'f':
+              s += '\f';
+              break;
+            case 'n':
+              s += '\n';
+              break;
+            case 'r':
+              s += '\r';
+              break;
+            case 't':
+              s += '\t';
+              break;
+            case 'u':
+              {
+                unsigned cp;
+
+                cp = hex4();
+                if((cp >= 0xD800) && (cp <= 0xDBFF))
+                  {
+                    unsigned lo;
+
+                    literal("\\u");
+                    lo = hex4();
+                    if((lo < 0xDC00) || (lo > 0xDFFF))
+                      error("invalid surrogate pair");
+                    cp = (0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00));
+                  }
+                append_utf8(s,cp);
+              }
+              break;
+            default:
+              error("invalid escape");
+            }
+        }
+    }
+
+    // Parsed by hand rather than with strtod so the result doesn't
+    // depend on the process locale.
+    JSON::Value
+    number()
+    {
+      bool neg;
+      bool digits;
+      double rv;
+      int exp;
+
+      neg    = false;
+      digits = false;
+      rv     = 0;
+      exp    = 0;
+
+      if(_str[_pos] == '-')
+        {
+          neg = true;
+          _pos++;
+        }
+
+      while((_pos < _str.size()) && std::isdigit((unsigned char)_str[_pos]))
+        {
+          rv = (rv * 10) + (_str[_pos++] - '0');
+          digits = true;
+        }
+
+      if((_pos < _str.size()) && (_str[_pos] == '.'))
+        {
+          _pos++;
+          while((_pos < _str.size()) && std::isdigit((unsigned char)_str[_pos]))
+            {
+              rv = (rv * 10) + (_str[_pos++] - '0');
+              exp--;
+              digits = true;
+            }
+        }
+
+      if(!digits)
+        error("unexpected character");
+
+      if((_pos < _str.size()) && ((_str[_pos] == 'e') || (_str[_pos] == 'E')))
+        {
+          bool eneg = false;
+          int e = 0;
+
+          _pos++;
+          if((_pos < _str.size()) && ((_str[_pos] == '+') || (_str[_pos] == '-')))
+            eneg = (_str[_pos++] == '-');
+          if((_pos >= _str.size()) || !std::isdigit((unsigned char)_str[_pos]))
+            error("invalid exponent");
+          while((_pos < _str.size()) && std::isdigit((unsigned char)_str[_pos]))
+            e = std::min((e * 10) + (_str[_pos++] - '0'),100000);
+          exp += (eneg ? -e : e);
+        }
+
+      if(exp)
+        rv *= std::pow(10.0,exp);
+
+      return JSON::Value(neg ? -rv : rv);
+    }
+
+  private:
+    std::string_view _str;
+    size_t           _pos;
+  };
+
+  static
+  void
+  dump(const JSON::Value &v_,
+       std::string       &out_)
+  {
+    switch(v_.type())
+      {
+      case JSON::Value::Type::NUL:
+        out_ += "null";
+        break;
+      case JSON::Value::Type::BOOL:
+        out_ += (v_.as_bool() ? "true" : "false");
+        break;
+      case JSON::Value::Type::NUMBER:
+        out_ += v_.to_arg();
+        break;
+      case JSON::Value::Type::STRING:
+        out_ += '"';
+        out_ += JSON::escape(v_.as_string());
+        out_ += '"';
+        break;
+      case JSON::Value::Type::ARRAY:
+        {
+          bool first = true;
+
+          out_ += '[';
+          for(const auto &item : v_.as_array())
+            {
+              if(!first)
+                out_ += ',';
+              first = false;
+              l::dump(item,out_);
+            }
+          out_ += ']';
+        }
+        break;
+      case JSON::Value::Type::OBJECT:
+        {
+          bool first = true;
+
+          out_ += '{';
+          for(const auto &member : v_.as_object())
+            {
+              if(!first)
+                out_ += ',';
+              first = false;
+              out_ += '"';
+              out_ += JSON::escape(member.first);
+              out_ += "\":";
+              l::dump(member.second,out_);
+            }
+          out_ += '}';
+        }
+        break;
+      }
+  }
+}
+
+JSON::Value::Value()
+  : _type(Type::NUL),
+    _bool(false),
+    _number(0)
+{
+}
+
+JSON::Value::Value(const bool b_)
+  : _type(Type::BOOL),
+    _bool(b_),
+    _number(0)
+{
+}
+
+JSON::Value::Value(const double n_)
+  : _type(Type::NUMBER),
+    _bool(false),
+    _number(n_)
+{
+}
+
+JSON::Value::Value(const char *s_)
+  : _type(Type::STRING),
+    _bool(false),
+    _number(0),
+    _string(s_)
+{
+}
+
+JSON::Value::Value(const std::string &s_)
+  : _type(Type::STRING),
+    _bool(false),
+    _number(0),
+    _string(s_)
+{
+}
+
+JSON::Value::Value(const Array &a_)
+  : _type(Type::ARRAY),
+    _bool(false),
+    _number(0),
+    _array(a_)
+{
+}
+
+JSON::Value
+JSON::Value::object()
+{
+  Value v;
+
+  v._type = Type::OBJECT;
+
+  return v;
+}
+
+bool
+JSON::Value::as_bool() const
+{
+  if(_type != Type::BOOL)
+    throw std::runtime_error("JSON value is not a boolean");
+
+  return _bool;
+}
+
+double
+JSON::Value::as_number() const
+{
+  if(_type != Type::NUMBER)
+    throw std::runtime_error("JSON value is not a number");
+
+  return _number;
+}
+
+int64_t
+JSON::Value::as_int() const
+{
+  return (int64_t)as_number();
+}
+
+const std::string&
+JSON::Value::as_string() const
+{
+  if(_type != Type::STRING)
+    throw std::runtime_error("JSON value is not a string");
+
+  return _string;
+}
+
+const JSON::Value::Array&
+JSON::Value::as_array() const
+{
+  if(_type != Type::ARRAY)
+    throw std::runtime_error("JSON value is not an array");
+
+  return _array;
+}
+
+const JSON::Value::Object&
+JSON::Value::as_object() const
+{
+  if(_type != Type::OBJECT)
+    throw std::runtime_error("JSON value is not an object");
+
+  return _object;
+}
+
+std::string
+JSON::Value::to_arg() const
+{
+  switch(_type)
+    {
+    case Type::NUL:
+      return {};
+    case Type::BOOL:
+      return (_bool ? "true" : "false");
+    case Type::NUMBER:
+      if((std::floor(_number) == _number) && (std::fabs(_number) < 9.0e15))
+        return fmt::to_string((int64_t)_number);
+      return fmt::format("{}",_number);
+    case Type::STRING:
+      return _string;
+    default:
+      break;
+    }
+
+  throw std::runtime_error("JSON value is not a scalar");
+}
+
+const JSON::Value*
+JSON::Value::find(const std::string &key_) const
+{
+  if(_type != Type::OBJECT)
+    return nullptr;
+
+  for(const auto &member : _object)
+    {
+      if(member.first == key_)
+        return &member.second;
+    }
+
+  return nullptr;
+}
+
+JSON::Value&
+JSON::Value::operator[](const std::string &key_)
+{
+  if(_type == Type::NUL)
+    _type = Type::OBJECT;
+  if(_type != Type::OBJECT)
+    throw std::runtime_error("JSON value is not an object");
+
+  for(auto &member : _object)
+    {
+      if(member.first == key_)
+        return member.second;
+    }
+
+  _object.emplace_back(key_,Value());
+
+  return _object.back().second;
+}
+
+void
+JSON::Value::push_back(const Value &v_)
+{
+  if(_type == Type::NUL)
+    _type = Type::ARRAY;
+  if(_type != Type::ARRAY)
+    throw std::runtime_error("JSON value is not an array");
+
+  _array.push_back(v_);
+}
+
+std::string
+JSON::Value::dump() const
+{
+  std::string rv;
+
+  l::dump(*this,rv);
+
+  return rv;
+}
+
+JSON::Value
+JSON::parse(std::string_view str_)
+{
+  l::Parser parser(str_);
+
+  return parser.document();
+}
+
+std::string
+JSON::escape(std::string_view str_)
+{
+  std::string rv;
+
+  rv.reserve(str_.size());
+  for(const char c : str_)
+    {
+      switch(c)
+        {
+        case '"':
+          rv += "\\\"";
+          break;
+        case '\\':
+          rv += "\\\\";
+          break;
+        case '\b':
+          rv += "\\b";
+          break;
+        case '\f':
+          rv += "\\f";
+          break;
+        case '\n':
+          rv += "\\n";
+          break;
+        case '\r':
+          rv += "\\r";
+          break;
+        case '\t':
+          rv += "\\t";
+          break;
+        default:
+          if((unsigned char)c < 0x20)
+            rv += fmt::format("\\u{:04x}",(unsigned)(unsigned char)c);
+          else
+            rv += c;
+          break;
+        }
+    }
+
+  return rv;
+}
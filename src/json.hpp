@@ -0,0 +1,110 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/*
+  Just enough JSON for 3it's own messages and files: parse a document
+  into a tree of Values and serialize a Value back to compact text.
+  Objects keep their members in document order.
+*/
+namespace JSON
+{
+  class Value
+  {
+  public:
+    enum class Type
+      {
+       NUL,
+       BOOL,
+       NUMBER,
+       STRING,
+       ARRAY,
+       OBJECT
+      };
+
+    typedef std::vector<Value>           Array;
+    typedef std::pair<std::string,Value> Member;
+    typedef std::vector<Member>          Object;
+
+  public:
+    Value();
+    Value(const bool b);
+    Value(const double n);
+    template<typename T,
+             typename std::enable_if<std::is_integral<T>::value,int>::type = 0>
+    Value(const T n)
+      : Value(static_cast<double>(n))
+    {
+    }
+    Value(const char *s);
+    Value(const std::string &s);
+    Value(const Array &a);
+
+    static Value object();
+
+  public:
+    Type type() const { return _type; }
+    bool is_null() const { return (_type == Type::NUL); }
+    bool is_bool() const { return (_type == Type::BOOL); }
+    bool is_number() const { return (_type == Type::NUMBER); }
+    bool is_string() const { return (_type == Type::STRING); }
+    bool is_array() const { return (_type == Type::ARRAY); }
+    bool is_object() const { return (_type == Type::OBJECT); }
+
+  public:
+    bool               as_bool() const;
+    double             as_number() const;
+    int64_t            as_int() const;
+    const std::string &as_string() const;
+    const Array       &as_array() const;
+    const Object      &as_object() const;
+
+    // Scalars rendered the way they'd be typed on a command line.
+    std::string to_arg() const;
+
+  public:
+    const Value *find(const std::string &key) const;
+    Value &operator[](const std::string &key);
+    void push_back(const Value &v);
+
+  public:
+    std::string dump() const;
+
+  private:
+    Type        _type;
+    bool        _bool;
+    double      _number;
+    std::string _string;
+    Array       _array;
+    Object      _object;
+  };
+
+  // Throws std::runtime_error describing the problem and its offset.
+  Value parse(std::string_view str);
+
+  std::string escape(std::string_view str);
+}
@@ -0,0 +1,47 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "log.hpp"
+
+#include <cstdio>
+
+
+namespace l
+{
+  static thread_local std::string *g_capture = nullptr;
+}
+
+void
+Log::write(const std::string &str_)
+{
+  if(l::g_capture)
+    l::g_capture->append(str_);
+  else
+    std::fwrite(str_.data(),1,str_.size(),stdout);
+}
+
+Log::Capture::Capture(std::string &buf_)
+  : _prev(l::g_capture)
+{
+  l::g_capture = &buf_;
+}
+
+Log::Capture::~Capture()
+{
+  l::g_capture = _prev;
+}
@@ -0,0 +1,60 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "fmt.hpp"
+
+#include <string>
+#include <utility>
+
+
+/*
+  Per-file status output. Normally written straight to stdout. While
+  a Capture is alive on the current thread the text is appended to
+  its buffer instead so the batch engine can emit each file's output
+  as a single block, in input order, regardless of which worker
+  produced it.
+*/
+namespace Log
+{
+  void write(const std::string &str);
+
+  template<typename... Args>
+  static
+  inline
+  void
+  print(fmt::format_string<Args...> fmt_,
+        Args &&...                  args_)
+  {
+    Log::write(fmt::format(fmt_,std::forward<Args>(args_)...));
+  }
+
+  class Capture
+  {
+  public:
+    Capture(std::string &buf);
+    ~Capture();
+
+    Capture(const Capture&) = delete;
+    Capture& operator=(const Capture&) = delete;
+
+  private:
+    std::string *_prev;
+  };
+}
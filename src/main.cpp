@@ -18,17 +18,52 @@
 
 #include "version.hpp"
 
+#include "log.hpp"
+#include "opera_fs.hpp"
 #include "subcmd.hpp"
 
 #include "CLI11.hpp"
 #include "fmt.hpp"
 
 #include <filesystem>
+#include <iostream>
+#include <sstream>
 
 #include <locale>
 
 namespace fs = std::filesystem;
 
+// CLI::ExistingFile / CLI::ExistingPath which also accept IMAGE:PATH
+// paths into 3DO disc images.
+static
+CLI::Validator
+existing_input(const bool allow_dirs_)
+{
+  return CLI::Validator(
+    [allow_dirs_](std::string &s_) -> std::string
+    {
+      std::error_code ec;
+
+      if(fs::is_directory(s_,ec))
+        return (allow_dirs_ ? "" : "File is actually a directory: " + s_);
+      if(fs::exists(s_,ec))
+        return {};
+
+      try
+        {
+          if(OperaFS::exists(s_))
+            return {};
+        }
+      catch(const std::exception &e_)
+        {
+          return e_.what();
+        }
+
+      return "Path does not exist: " + s_;
+    },
+    (allow_dirs_ ? "PATH(existing)" : "FILE"));
+}
+
 static
 std::string
 color2rgb_transform(std::string &s_)
@@ -84,8 +119,12 @@ generate_info_argparser(CLI::App      &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("path to file")
     ->type_name("PATH")
-    ->check(CLI::ExistingFile)
+    ->check(existing_input(false))
     ->required();
+  subcmd->add_flag("--brief",options_.brief)
+    ->description("one line per file from headers only: type, size, bpp, count")
+    ->default_val(false)
+    ->default_str("false");
 
   subcmd->callback(std::bind(SubCmd::info,std::cref(options_)));
 }
@@ -101,12 +140,34 @@ generate_list_chunks(CLI::App            &app_,
   subcmd->add_option("filepaths",opts_.filepaths)
     ->description("path to images")
     ->type_name("PATH")
-    ->check(CLI::ExistingFile)
+    ->check(existing_input(false))
     ->required();
 
   subcmd->callback(std::bind(SubCmd::list_chunks,std::cref(opts_)));
 }
 
+static
+void
+generate_list_files(CLI::App           &app_,
+                    Options::ListFiles &opts_)
+{
+  CLI::App *subcmd;
+
+  subcmd = app_.add_subcommand("list-files","list files in a 3DO disc image");
+  subcmd->add_option("filepaths",opts_.filepaths)
+    ->description("path to disc image or IMAGE:PATH within one")
+    ->type_name("PATH")
+    ->check(existing_input(false))
+    ->required();
+  subcmd->footer("Files in an image can be given to the other subcommands as IMAGE:PATH:\n"
+                 "  3it list-files game.iso\n"
+                 "  3it to-png -j0 game.iso:/Art\n"
+                 "  3it info game.iso:/BannerScreen\n"
+                 "Outputs for them default to IMAGE.d/PATH.\n");
+
+  subcmd->callback(std::bind(SubCmd::list_files,std::cref(opts_)));
+}
+
 static
 void
 generate_dump_packed_instructions(CLI::App            &app_,
@@ -120,13 +181,85 @@ generate_dump_packed_instructions(CLI::App            &app_,
   subcmd->add_option("filepath",opts_.filepath)
     ->description("path to packed CEL image")
     ->type_name("PATH")
-    ->check(CLI::ExistingFile)
+    ->check(existing_input(false))
     ->required();
 
   subcmd->callback(std::bind(SubCmd::dump_packed_instructions,
                              std::cref(opts_)));
 }
 
+static
+void
+generate_batch_argparser(CLI::App       *subcmd_,
+                         Options::Batch &opts_)
+{
+  subcmd_->add_option("-j,--jobs",opts_.jobs)
+    ->description("Number of files to convert concurrently (0 = number of CPUs)")
+    ->type_name("N")
+    ->default_val(1)
+    ->take_last();
+  subcmd_->add_option("--max-memory",opts_.max_memory)
+    ->description("Limit on input file bytes read ahead of the workers, not decoded images (0 = unlimited)")
+    ->type_name("SIZE")
+    ->transform(CLI::AsSizeValue(false))
+    ->default_val("256MiB")
+    ->take_last();
+}
+
+static
+void
+generate_select_argparser(CLI::App        *subcmd_,
+                          Options::Select &opts_)
+{
+  subcmd_->add_option("--index",opts_.indexes)
+    ->description("Only convert the images at these indexes ({index})")
+    ->type_name("N[,N...]")
+    ->delimiter(',');
+  subcmd_->add_option_function<std::string>("--range",
+                                            [&opts_](const std::string &s_)
+                                            {
+                                              size_t pos;
+
+                                              pos = s_.find('-');
+                                              if(pos == std::string::npos)
+                                                throw CLI::ValidationError("--range","expected FIRST-LAST: " + s_);
+
+                                              try
+                                                {
+                                                  if(pos > 0)
+                                                    opts_.first = std::stoull(s_.substr(0,pos));
+                                                  if((pos + 1) < s_.size())
+                                                    opts_.last = std::stoull(s_.substr(pos + 1));
+                                                }
+                                              catch(const std::exception &)
+                                                {
+                                                  throw CLI::ValidationError("--range","expected FIRST-LAST: " + s_);
+                                                }
+
+                                              opts_.range = true;
+                                            })
+    ->description("Only convert images FIRST through LAST inclusive (either may be omitted)")
+    ->type_name("FIRST-LAST")
+    ->take_last();
+}
+
+static
+void
+generate_cache_argparser(CLI::App       *subcmd_,
+                         Options::Cache &opts_)
+{
+  subcmd_->add_option("--cache",opts_.dirpath)
+    ->description("Directory to cache conversion results in (disabled if unset)")
+    ->type_name("PATH")
+    ->take_last();
+  subcmd_->add_option("--cache-max-size",opts_.max_size)
+    ->description("Size the cache is trimmed to after a run (0 = unlimited)")
+    ->type_name("SIZE")
+    ->transform(CLI::AsSizeValue(false))
+    ->default_val("1GiB")
+    ->take_last();
+}
+
 #define ADD_FLAG(NAME)                                          \
   subcmd_->add_option("--ccb-"#NAME,flags_.NAME)                \
   ->description("Set CCB flag "#NAME)                           \
@@ -211,7 +344,7 @@ generate_to_cel_argparser(CLI::App       &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("Path to image or directory")
     ->type_name("PATH")
-    ->check(CLI::ExistingPath)
+    ->check(existing_input(true))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -240,6 +373,11 @@ generate_to_cel_argparser(CLI::App       &app_,
     ->default_val(false)
     ->default_str("false")
     ->take_last();
+  subcmd->add_flag("--pack-optimal",options_.pack_optimal)
+    ->description("Search for the smallest packed encoding of each row")
+    ->default_val(false)
+    ->default_str("false")
+    ->take_last();
   subcmd->add_option("--transparent",options_.transparent)
     ->description("Set packed pixel transparent color")
     ->type_name("HEX_RGBA32")
@@ -255,7 +393,7 @@ generate_to_cel_argparser(CLI::App       &app_,
   subcmd->add_option("--external-palette",options_.external_palette)
     ->description("Use a different CEL file's PLUT instead of building a unique one")
     ->type_name("PATH")
-    ->check(CLI::ExistingFile)
+    ->check(existing_input(false))
     ->take_last();
   subcmd->add_option("--write-plut",options_.write_plut)
     ->description("Write PLUT to 3DO CEL file")
@@ -290,6 +428,9 @@ generate_to_cel_argparser(CLI::App       &app_,
     ->take_last();
   generate_ccb_flag_argparser(subcmd,options_.ccb_flags);
   generate_pre0_flag_argparser(subcmd,options_.pre0_flags);
+  generate_select_argparser(subcmd,options_.select);
+  generate_batch_argparser(subcmd,options_.batch);
+  generate_cache_argparser(subcmd,options_.cache);
   subcmd->footer("Output Path Template Values:\n"
                  "  {filepath}: input filepath\n"
                  "  {dirpath}: base path of filepath\n"
@@ -316,6 +457,83 @@ generate_to_cel_argparser(CLI::App       &app_,
                              std::cref(options_)));
 }
 
+static
+void
+generate_manifest_argparser(CLI::App          &app_,
+                            Options::Manifest &options_)
+{
+  CLI::App *subcmd;
+
+  subcmd = app_.add_subcommand("manifest","convert images to CEL as described by a manifest");
+  subcmd->add_option("filepath",options_.filepath)
+    ->description("Path to JSON manifest")
+    ->type_name("PATH")
+    ->check(CLI::ExistingFile)
+    ->required();
+  generate_batch_argparser(subcmd,options_.batch);
+  generate_cache_argparser(subcmd,options_.cache);
+  subcmd->footer("Manifest format:\n"
+                 "  {\n"
+                 "    \"defaults\": {\"bpp\": 8, \"packed\": true},\n"
+                 "    \"entries\":\n"
+                 "      [\n"
+                 "        {\"filepath\": \"hero.png\", \"coded\": true, \"external_palette\": \"hero.cel\"},\n"
+                 "        {\"filepaths\": [\"ui/\"], \"rotation\": 90, \"output_path\": \"{filepath}.r90{ext}\"},\n"
+                 "        {\"filepath\": \"bg.png\", \"ccb_flags\": {\"bgnd\": \"unset\"}}\n"
+                 "      ]\n"
+                 "  }\n"
+                 "Entry fields are the to-cel options with '_' in place of '-'.\n"
+                 "Relative paths are relative to the manifest.\n"
+                 );
+
+  subcmd->callback(std::bind(SubCmd::manifest,
+                             std::cref(options_)));
+}
+
+static
+void
+generate_estimate_argparser(CLI::App          &app_,
+                            Options::Estimate &options_)
+{
+  CLI::App *subcmd;
+
+  subcmd = app_.add_subcommand("estimate","estimate the size of each CEL type without encoding");
+  subcmd->add_option("filepaths",options_.filepaths)
+    ->description("Path to image or directory")
+    ->type_name("PATH")
+    ->check(existing_input(true))
+    ->required();
+  subcmd->add_option("--transparent",options_.transparent)
+    ->description("Set packed pixel transparent color")
+    ->type_name("HEX_RGBA32")
+    ->option_text("COLOR:{black,white,red,green,blue,magenta,cyan,0xRRGGBBAA} [magenta]")
+    ->transform(CLI::Validator(color2rgb_transform,""))
+    ->default_val("magenta")
+    ->take_last();
+  subcmd->add_option("--external-palette",options_.external_palette)
+    ->description("Use a different CEL file's PLUT instead of building a unique one")
+    ->type_name("PATH")
+    ->check(existing_input(false))
+    ->take_last();
+  subcmd->add_flag("--pack-optimal",options_.pack_optimal)
+    ->description("Verify against --pack-optimal encodes")
+    ->default_val(false)
+    ->default_str("false")
+    ->take_last();
+  subcmd->add_flag("--verify",options_.verify)
+    ->description("Also encode every type and report the estimates' error")
+    ->default_val(false)
+    ->default_str("false")
+    ->take_last();
+  generate_select_argparser(subcmd,options_.select);
+  subcmd->footer("Prints JSON with the CCB, PDAT and PLUT chunk bytes to-cel would\n"
+                 "write for every linear CEL type which can hold each image.\n"
+                 "Packed PDAT sizes are an upper bound which ignores overlapping rows.\n");
+
+  subcmd->callback(std::bind(SubCmd::estimate,
+                             std::cref(options_)));
+}
+
 static
 void
 generate_to_banner_argparser(CLI::App          &app_,
@@ -330,7 +548,7 @@ generate_to_banner_argparser(CLI::App          &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("Path to image or directory")
     ->type_name("PATH")
-    ->check(CLI::ExistingPath)
+    ->check(existing_input(true))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -343,6 +561,7 @@ generate_to_banner_argparser(CLI::App          &app_,
     ->default_val(false)
     ->default_str("false")
     ->take_last();
+  generate_batch_argparser(subcmd,options_.batch);
   subcmd->footer("Output Path Template Values:\n"
                  "  {filepath}: input filepath\n"
                  "  {dirpath}: base path of filepath\n"
@@ -375,7 +594,7 @@ generate_to_imag_argparser(CLI::App        &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("Path to image or directory")
     ->type_name("PATH")
-    ->check(CLI::ExistingPath)
+    ->check(existing_input(true))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -388,6 +607,7 @@ generate_to_imag_argparser(CLI::App        &app_,
     ->default_val(false)
     ->default_str("false")
     ->take_last();
+  generate_batch_argparser(subcmd,options_.batch);
   subcmd->footer("Output Path Template Values:\n"
                  "  {filepath}: input filepath\n"
                  "  {dirpath}: base path of filepath\n"
@@ -419,7 +639,7 @@ generate_to_lrform_argparser(CLI::App          &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("Path to image or directory")
     ->type_name("PATH")
-    ->check(CLI::ExistingPath)
+    ->check(existing_input(true))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -432,6 +652,7 @@ generate_to_lrform_argparser(CLI::App          &app_,
     ->default_val(false)
     ->default_str("false")
     ->take_last();
+  generate_batch_argparser(subcmd,options_.batch);
   subcmd->footer("Output Path Template Values:\n"
                  "  {filepath}: input filepath\n"
                  "  {dirpath}: base path of filepath\n"
@@ -463,7 +684,7 @@ generate_to_bmp_argparser(CLI::App         &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("Path to image or directory")
     ->type_name("PATH")
-    ->check(CLI::ExistingPath)
+    ->check(existing_input(true))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -476,6 +697,8 @@ generate_to_bmp_argparser(CLI::App         &app_,
     ->default_val(false)
     ->default_str("false")
     ->take_last();
+  generate_select_argparser(subcmd,options_.select);
+  generate_batch_argparser(subcmd,options_.batch);
   subcmd->footer("Output Path Template Values:\n"
                  "  {filepath}: input filepath\n"
                  "  {dirpath}: base path of filepath\n"
@@ -508,7 +731,7 @@ generate_to_png_argparser(CLI::App         &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("Path to image or directory")
     ->type_name("PATH")
-    ->check(CLI::ExistingPath)
+    ->check(existing_input(true))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -521,6 +744,8 @@ generate_to_png_argparser(CLI::App         &app_,
     ->default_val(false)
     ->default_str("false")
     ->take_last();
+  generate_select_argparser(subcmd,options_.select);
+  generate_batch_argparser(subcmd,options_.batch);
   subcmd->footer("Output Path Template Values:\n"
                  "  {filepath}: input filepath\n"
                  "  {dirpath}: base path of filepath\n"
@@ -553,7 +778,7 @@ generate_to_jpg_argparser(CLI::App         &app_,
   subcmd->add_option("filepaths",options_.filepaths)
     ->description("Path to image or directory")
     ->type_name("PATH")
-    ->check(CLI::ExistingPath)
+    ->check(existing_input(true))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -566,6 +791,8 @@ generate_to_jpg_argparser(CLI::App         &app_,
     ->default_val(false)
     ->default_str("false")
     ->take_last();
+  generate_select_argparser(subcmd,options_.select);
+  generate_batch_argparser(subcmd,options_.batch);
   subcmd->footer("Output Path Template Values:\n"
                  "  {filepath}: input filepath\n"
                  "  {dirpath}: base path of filepath\n"
@@ -595,7 +822,7 @@ generate_to_nfs_shpm(CLI::App           &app_,
   subcmd->add_option("filepath",options_.filepaths)
     ->description("Path to source image")
     ->type_name("PATH")
-    ->check(CLI::ExistingFile)
+    ->check(existing_input(false))
     ->required();
   subcmd->add_option("-o,--output-path",options_.output_path)
     ->description("Path to output file")
@@ -617,6 +844,92 @@ generate_to_nfs_shpm(CLI::App           &app_,
                              std::cref(options_)));
 }
 
+static
+int
+run_args(const SubCmd::ArgVec &args_,
+         const Options::Batch &batch_,
+         std::string          &out_,
+         std::string          &err_);
+
+static
+void
+generate_serve_argparser(CLI::App       &app_,
+                         Options::Serve &options_)
+{
+  CLI::App *subcmd;
+
+  subcmd = app_.add_subcommand("serve","run a conversion daemon on a unix socket");
+  subcmd->add_option("-s,--socket",options_.socket)
+    ->description("Path of the socket to listen on")
+    ->type_name("PATH")
+    ->envname("THREEIT_SOCKET")
+    ->required()
+    ->take_last();
+  generate_batch_argparser(subcmd,options_.batch);
+  subcmd->get_option("--jobs")->default_val(0);
+  subcmd->footer("Jobs are newline-delimited JSON objects, one reply line per job:\n"
+                 "  {\"cwd\":DIR,\"args\":[\"to-cel\",\"--bpp\",\"8\",\"a.png\"]}\n"
+                 "  {\"cwd\":DIR,\"command\":\"to-cel\",\"bpp\":8,\"filepaths\":[\"a.png\"]}\n"
+                 "  -> {\"status\":0,\"stdout\":\"...\",\"stderr\":\"...\"}\n"
+                 "--jobs and --max-memory are the defaults for jobs which don't set them.\n"
+                 );
+
+  subcmd->callback(std::bind(SubCmd::serve,
+                             std::cref(options_),
+                             SubCmd::Runner(run_args)));
+}
+
+static
+void
+generate_client_argparser(CLI::App        &app_,
+                          Options::Client &options_)
+{
+  CLI::App *subcmd;
+
+  subcmd = app_.add_subcommand("client","run a 3it command on a daemon started with 'serve'");
+  subcmd->add_option("-s,--socket",options_.socket)
+    ->description("Path of the daemon's socket")
+    ->type_name("PATH")
+    ->envname("THREEIT_SOCKET")
+    ->required()
+    ->take_last();
+  subcmd->prefix_command();
+  subcmd->footer("Everything after the options is forwarded as is:\n"
+                 "  3it client -s /tmp/3it.sock to-cel --bpp 8 sprite.png\n");
+
+  subcmd->callback([&options_,subcmd]()
+  {
+    SubCmd::client(options_,subcmd->remaining());
+  });
+}
+
+static
+void
+generate_watch_argparser(CLI::App       &app_,
+                         Options::Watch &options_)
+{
+  CLI::App *subcmd;
+
+  subcmd = app_.add_subcommand("watch","rerun a conversion whenever its inputs change");
+  subcmd->add_option("--debounce",options_.debounce)
+    ->description("Milliseconds without changes before converting")
+    ->type_name("MS")
+    ->default_val(200)
+    ->take_last();
+  generate_batch_argparser(subcmd,options_.batch);
+  subcmd->get_option("--jobs")->default_val(0);
+  subcmd->prefix_command();
+  subcmd->footer("Paths to watch come first and the subcommand, without inputs, after '--':\n"
+                 "  3it watch art/ -- to-cel --bpp 8 --packed\n"
+                 "The subcommand is run over all the paths once and then over just\n"
+                 "the files written or moved into them. Linux only.\n");
+
+  subcmd->callback([&options_,subcmd]()
+  {
+    SubCmd::watch(options_,subcmd->remaining(),SubCmd::Runner(run_args));
+  });
+}
+
 static
 void
 generate_argparser(CLI::App &app_,
@@ -624,10 +937,12 @@ generate_argparser(CLI::App &app_,
 {
   app_.set_help_all_flag("--help-all",
                          "Print help all help messages and exit");
-  app_.require_subcommand();
+  app_.require_subcommand(1);
 
   generate_info_argparser(app_,options_.info);
   generate_to_cel_argparser(app_,options_.to_cel);
+  generate_manifest_argparser(app_,options_.manifest);
+  generate_estimate_argparser(app_,options_.estimate);
   generate_to_banner_argparser(app_,options_.to_banner);
   generate_to_imag_argparser(app_,options_.to_imag);
   generate_to_lrform_argparser(app_,options_.to_lrform);
@@ -636,11 +951,28 @@ generate_argparser(CLI::App &app_,
   generate_to_png_argparser(app_,options_.to_image);
   generate_to_jpg_argparser(app_,options_.to_image);
   generate_list_chunks(app_,options_.list_chunks);
+  generate_list_files(app_,options_.list_files);
   generate_dump_packed_instructions(app_,options_.dump_packed);
+  generate_serve_argparser(app_,options_.serve);
+  generate_client_argparser(app_,options_.client);
+  generate_watch_argparser(app_,options_.watch);
   generate_version_argparser(app_);
   generate_docs_argparser(app_);
 }
 
+static
+void
+set_batch_defaults(Options              &options_,
+                   const Options::Batch &batch_)
+{
+  options_.to_cel.batch    = batch_;
+  options_.manifest.batch  = batch_;
+  options_.to_banner.batch = batch_;
+  options_.to_imag.batch   = batch_;
+  options_.to_lrform.batch = batch_;
+  options_.to_image.batch  = batch_;
+}
+
 static
 void
 set_locale()
@@ -655,9 +987,13 @@ set_locale()
     }
 }
 
+static
 int
-main(int    argc_,
-     char **argv_)
+run(int                   argc_,
+    char                **argv_,
+    const Options::Batch *batch_,
+    std::ostream         &out_,
+    std::ostream         &err_)
 {
   CLI::App app;
   Options options;
@@ -665,9 +1001,9 @@ main(int    argc_,
   app.description(fmt::format("3it: 3DO Image Tool v{}.{}.{}",
                               MAJOR,MINOR,PATCH));
 
-  set_locale();
-
   generate_argparser(app,options);
+  if(batch_)
+    set_batch_defaults(options,*batch_);
 
   try
     {
@@ -675,16 +1011,54 @@ main(int    argc_,
     }
   catch(const CLI::ParseError &e_)
     {
-      return app.exit(e_);
+      return app.exit(e_,out_,err_);
     }
   catch(const std::system_error &e_)
     {
-      fmt::print("{} ({})\n",e_.what(),e_.code().message());
+      Log::print("{} ({})\n",e_.what(),e_.code().message());
     }
   catch(const std::runtime_error &e_)
     {
-      fmt::print("{}\n",e_.what());
+      Log::print("{}\n",e_.what());
     }
 
   return 0;
 }
+
+static
+int
+run_args(const SubCmd::ArgVec &args_,
+         const Options::Batch &batch_,
+         std::string          &out_,
+         std::string          &err_)
+{
+  int rv;
+  std::ostringstream out;
+  std::ostringstream err;
+  std::vector<char*> argv;
+
+  argv.push_back(const_cast<char*>("3it"));
+  for(const auto &arg : args_)
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  {
+    Log::Capture capture(out_);
+
+    rv = run(argv.size() - 1,argv.data(),&batch_,out,err);
+  }
+
+  out_ += out.str();
+  err_ += err.str();
+
+  return rv;
+}
+
+int
+main(int    argc_,
+     char **argv_)
+{
+  set_locale();
+
+  return run(argc_,argv_,nullptr,std::cout,std::cerr);
+}
@@ -0,0 +1,441 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "manifest.hpp"
+
+#include "json.hpp"
+#include "mapped_file.hpp"
+
+#include "fmt.hpp"
+
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  typedef std::pair<const char*,Options::Flag Options::CCBFlags::*>  CCBFlagField;
+  typedef std::pair<const char*,Options::Flag Options::Pre0Flags::*> Pre0FlagField;
+
+  static const CCBFlagField CCB_FLAG_FIELDS[] =
+    {
+     {"skip",&Options::CCBFlags::skip},
+     {"last",&Options::CCBFlags::last},
+     {"npabs",&Options::CCBFlags::npabs},
+     {"spabs",&Options::CCBFlags::spabs},
+     {"ppabs",&Options::CCBFlags::ppabs},
+     {"ldsize",&Options::CCBFlags::ldsize},
+     {"ldprs",&Options::CCBFlags::ldprs},
+     {"ldppmp",&Options::CCBFlags::ldppmp},
+     {"ldplut",&Options::CCBFlags::ldplut},
+     {"ccbpre",&Options::CCBFlags::ccbpre},
+     {"yoxy",&Options::CCBFlags::yoxy},
+     {"acsc",&Options::CCBFlags::acsc},
+     {"alsc",&Options::CCBFlags::alsc},
+     {"acw",&Options::CCBFlags::acw},
+     {"accw",&Options::CCBFlags::accw},
+     {"twd",&Options::CCBFlags::twd},
+     {"lce",&Options::CCBFlags::lce},
+     {"ace",&Options::CCBFlags::ace},
+     {"maria",&Options::CCBFlags::maria},
+     {"pxor",&Options::CCBFlags::pxor},
+     {"useav",&Options::CCBFlags::useav},
+     {"packed",&Options::CCBFlags::packed},
+     {"plutpos",&Options::CCBFlags::plutpos},
+     {"bgnd",&Options::CCBFlags::bgnd},
+     {"noblk",&Options::CCBFlags::noblk}
+    };
+
+  static const Pre0FlagField PRE0_FLAG_FIELDS[] =
+    {
+     {"literal",&Options::Pre0Flags::literal},
+     {"bgnd",&Options::Pre0Flags::bgnd},
+     {"uncoded",&Options::Pre0Flags::uncoded},
+     {"rep8",&Options::Pre0Flags::rep8}
+    };
+
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  class Loader
+  {
+  public:
+    Loader(const fs::path &filepath_)
+      : _filepath(filepath_),
+        _basedir(filepath_.parent_path())
+    {
+    }
+
+  public:
+    void
+    load(Manifest::EntryVec &entries_)
+    {
+      MappedFile file;
+      JSON::Value doc;
+      Options::ToCEL defaults;
+      std::set<std::string> defaults_given;
+      const JSON::Value *entries;
+
+      file.open(_filepath);
+      try
+        {
+          doc = JSON::parse(std::string_view((const char*)file.data(),
+                                             file.size()));
+        }
+      catch(const std::runtime_error &e_)
+        {
+          throw fmt::exception("{}: {}",_filepath,e_.what());
+        }
+
+      l::Loader::set_defaults(defaults);
+
+      if(doc.is_array())
+        {
+          entries = &doc;
+        }
+      else
+        {
+          const JSON::Value *val;
+
+          val = doc.find("defaults");
+          if(val)
+            {
+              _where = "defaults";
+              apply(*val,defaults,defaults_given);
+              check(defaults,defaults_given);
+            }
+
+          entries = doc.find("entries");
+        }
+
+      if(!entries || !entries->is_array())
+        throw fmt::exception("{}: no 'entries' array",_filepath);
+
+      for(size_t i = 0; i < entries->as_array().size(); i++)
+        {
+          Options::ToCEL opts = defaults;
+          std::set<std::string> given = defaults_given;
+          const JSON::Value &entry = entries->as_array()[i];
+
+          _where = fmt::format("entry {}",i);
+          apply(entry,opts,given);
+          check(opts,given);
+          if(opts.filepaths.empty())
+            error("no 'filepath' or 'filepaths'");
+
+          entries_.emplace_back(std::move(opts));
+        }
+    }
+
+  private:
+    // Same as the to-cel command line defaults.
+    static
+    void
+    set_defaults(Options::ToCEL &opts_)
+    {
+      opts_.output_path = "{filepath}{_index}{_name}{ext}";
+      opts_.bpp         = 16;
+      opts_.transparent = 0xFF00FFFF;
+    }
+
+    template<typename... Args>
+    [[noreturn]]
+    void
+    error(fmt::format_string<Args...> fmt_,
+          Args &&...                  args_) const
+    {
+      throw l::Error(fmt::format("{}: {}: {}",
+                                 _filepath,
+                                 _where,
+                                 fmt::format(fmt_,std::forward<Args>(args_)...)));
+    }
+
+    fs::path
+    path(const JSON::Value &val_) const
+    {
+      fs::path path;
+
+      path = val_.as_string();
+      if(path.is_relative())
+        path = _basedir / path;
+
+      return path;
+    }
+
+    fs::path
+    output_path(const JSON::Value &val_) const
+    {
+      const std::string &str = val_.as_string();
+
+      // Templates built from the input path are already relative to
+      // wherever the input is.
+      if(!str.empty() && (str[0] == '{'))
+        return str;
+
+      return path(val_);
+    }
+
+    fs::path
+    palette_path(const JSON::Value &val_)
+    {
+      fs::path path;
+
+      path = this->path(val_);
+      if(_palettes.count(path))
+        return path;
+
+      if(!fs::is_regular_file(path))
+        error("external palette not found: {}",path);
+      _palettes.insert(path);
+
+      return path;
+    }
+
+    uint32_t
+    color(const JSON::Value &val_) const
+    {
+      static const std::pair<const char*,uint32_t> names[] =
+        {
+         {"black",0x000000FF},
+         {"white",0xFFFFFFFF},
+         {"magenta",0xFF00FFFF},
+         {"cyan",0x00FFFFFF},
+         {"red",0xFF0000FF},
+         {"green",0x00FF00FF},
+         {"blue",0x0000FFFF}
+        };
+
+      if(val_.is_number())
+        return (uint32_t)val_.as_int();
+
+      const std::string &str = val_.as_string();
+
+      for(const auto &name : names)
+        {
+          if(str == name.first)
+            return name.second;
+        }
+
+      try
+        {
+          return std::stoul(str,nullptr,0);
+        }
+      catch(const std::logic_error &e_)
+        {
+          error("invalid color: {}",str);
+        }
+    }
+
+    template<typename T>
+    T
+    member_of(const JSON::Value &val_,
+              const std::initializer_list<T> &valid_,
+              const char *name_) const
+    {
+      T v;
+
+      if constexpr (std::is_same<T,std::string>::value)
+        v = val_.as_string();
+      else
+        v = (T)val_.as_int();
+
+      for(const auto &valid : valid_)
+        {
+          if(v == valid)
+            return v;
+        }
+
+      error("invalid {}: {}",name_,val_.to_arg());
+    }
+
+    Options::Flag
+    flag(const JSON::Value &val_) const
+    {
+      const std::string &str = val_.as_string();
+
+      if(str == "set")
+        return Options::Flag::SET;
+      if(str == "unset")
+        return Options::Flag::UNSET;
+      if(str == "default")
+        return Options::Flag::DEFAULT;
+
+      error("invalid flag value: {}",str);
+    }
+
+    template<typename Flags, typename Field, size_t N>
+    void
+    flags(const JSON::Value &val_,
+          const Field      (&fields_)[N],
+          Flags             &flags_) const
+    {
+      for(const auto &member : val_.as_object())
+        {
+          bool found = false;
+
+          for(const auto &field : fields_)
+            {
+              if(member.first != field.first)
+                continue;
+              flags_.*(field.second) = flag(member.second);
+              found = true;
+              break;
+            }
+
+          if(!found)
+            error("unknown flag: {}",member.first);
+        }
+    }
+
+    void
+    filepaths(const JSON::Value &val_,
+              Options::ToCEL    &opts_) const
+    {
+      opts_.filepaths.clear();
+      if(!val_.is_array())
+        {
+          opts_.filepaths.emplace_back(path(val_));
+          return;
+        }
+
+      for(const auto &item : val_.as_array())
+        opts_.filepaths.emplace_back(path(item));
+    }
+
+    void
+    apply_field(const std::string &key_,
+                const JSON::Value &val_,
+                Options::ToCEL    &opts_)
+    {
+      if((key_ == "filepath") || (key_ == "filepaths"))
+        filepaths(val_,opts_);
+      else if(key_ == "output_path")
+        opts_.output_path = output_path(val_);
+      else if(key_ == "bpp")
+        opts_.bpp = member_of<int>(val_,{1,2,4,6,8,16},"bpp");
+      else if(key_ == "coded")
+        opts_.coded = val_.as_bool();
+      else if(key_ == "packed")
+        opts_.packed = val_.as_bool();
+      else if(key_ == "pack_optimal")
+        opts_.pack_optimal = val_.as_bool();
+      else if(key_ == "lrform")
+        opts_.lrform = val_.as_bool();
+      else if(key_ == "rotation")
+        opts_.rotation = member_of<int>(val_,{0,90,180,270},"rotation");
+      else if(key_ == "transparent")
+        opts_.transparent = color(val_);
+      else if(key_ == "external_palette")
+        opts_.external_palette = palette_path(val_);
+      else if(key_ == "write_plut")
+        opts_.write_plut = val_.as_bool();
+      else if(key_ == "ignore_target_ext")
+        opts_.ignore_target_ext = val_.as_bool();
+      else if(key_ == "generate_all")
+        opts_.generate_all = val_.as_bool();
+      else if(key_ == "find_smallest")
+        opts_.find_smallest = member_of<std::string>(val_,{"","regular","rotation"},"find_smallest");
+      else if(key_ == "ccb_flags")
+        flags(val_,CCB_FLAG_FIELDS,opts_.ccb_flags);
+      else if(key_ == "pre0_flags")
+        flags(val_,PRE0_FLAG_FIELDS,opts_.pre0_flags);
+      else
+        error("unknown field: {}",key_);
+    }
+
+    void
+    apply(const JSON::Value     &obj_,
+          Options::ToCEL        &opts_,
+          std::set<std::string> &given_)
+    {
+      if(!obj_.is_object())
+        error("expected an object");
+
+      for(const auto &member : obj_.as_object())
+        {
+          std::string key = member.first;
+
+          for(auto &c : key)
+            {
+              if(c == '-')
+                c = '_';
+            }
+          given_.insert(key);
+
+          try
+            {
+              apply_field(key,member.second,opts_);
+            }
+          catch(const l::Error &e_)
+            {
+              throw;
+            }
+          catch(const std::runtime_error &e_)
+            {
+              error("{}: {}",member.first,e_.what());
+            }
+        }
+    }
+
+    // The same option exclusions to-cel's argparser enforces, applied
+    // to the fields given in the defaults and the entry together.
+    // generate_all and find_smallest count when enabled as they are
+    // flags on the command line.
+    void
+    check(const Options::ToCEL        &opts_,
+          const std::set<std::string> &given_) const
+    {
+      static const char *single[] = {"coded","packed","lrform","bpp","rotation"};
+
+      if(opts_.generate_all && !opts_.find_smallest.empty())
+        error("find_smallest excludes generate_all");
+
+      for(const auto key : single)
+        {
+          if(!given_.count(key))
+            continue;
+          if(opts_.generate_all)
+            error("generate_all excludes {}",key);
+          if(!opts_.find_smallest.empty())
+            error("find_smallest excludes {}",key);
+        }
+    }
+
+  private:
+    const fs::path     _filepath;
+    const fs::path     _basedir;
+    std::string        _where;
+    std::set<fs::path> _palettes;
+  };
+}
+
+void
+Manifest::load(const fs::path &filepath_,
+               EntryVec       &entries_)
+{
+  l::Loader loader(filepath_);
+
+  loader.load(entries_);
+}
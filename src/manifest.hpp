@@ -0,0 +1,52 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "options.hpp"
+
+#include <filesystem>
+#include <vector>
+
+
+/*
+  A manifest describes a batch of to-cel conversions, each entry with
+  its own Options::ToCEL settings:
+
+    {
+      "defaults": {"bpp": 8, "packed": true},
+      "entries":
+        [
+          {"filepath": "hero.png", "coded": true, "external_palette": "hero.cel"},
+          {"filepaths": ["ui/"], "rotation": 90, "output_path": "{filepath}.r90{ext}"},
+          {"filepath": "bg.png", "bpp": 16, "ccb_flags": {"bgnd": "unset"}}
+        ]
+    }
+
+  Field names are the ToCEL member names (the to-cel long options with
+  '_' for '-'); "defaults" is applied before each entry. A bare array
+  may be used when there are no defaults. Relative input, palette and
+  literal output paths are relative to the manifest's directory.
+*/
+namespace Manifest
+{
+  typedef std::vector<Options::ToCEL> EntryVec;
+
+  void load(const std::filesystem::path &filepath,
+            EntryVec                    &entries);
+}
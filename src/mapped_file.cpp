@@ -0,0 +1,263 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "mapped_file.hpp"
+
+#include "opera_fs.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  static std::atomic<bool> g_allow_mmap(true);
+}
+
+MappedFile::MappedFile()
+  : _data(nullptr),
+    _size(0),
+    _mapped(false)
+{
+}
+
+MappedFile::MappedFile(const fs::path &filepath_)
+  : MappedFile()
+{
+  open(filepath_);
+}
+
+MappedFile::MappedFile(MappedFile &&other_)
+  : MappedFile()
+{
+  *this = std::move(other_);
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+MappedFile&
+MappedFile::operator=(MappedFile &&other_)
+{
+  if(this == &other_)
+    return *this;
+
+  close();
+
+  _buf    = std::move(other_._buf);
+  _owner  = std::move(other_._owner);
+  _mapped = other_._mapped;
+  _size   = other_._size;
+  _data   = ((_mapped || _owner) ? other_._data : _buf.data());
+
+  other_._data   = nullptr;
+  other_._size   = 0;
+  other_._mapped = false;
+  other_._buf.clear();
+
+  return *this;
+}
+
+void
+MappedFile::open(const fs::path &filepath_)
+{
+  close();
+
+  if(OperaFS::open(filepath_,*this))
+    return;
+
+  open_file(filepath_);
+}
+
+void
+MappedFile::allow_mmap(const bool allow_)
+{
+  l::g_allow_mmap = allow_;
+}
+
+void
+MappedFile::view(std::shared_ptr<const void>  owner_,
+                 const uint8_t               *data_,
+                 const size_t                 size_)
+{
+  close();
+
+  _owner = std::move(owner_);
+  _data  = data_;
+  _size  = size_;
+}
+
+void
+MappedFile::assign(ByteVec &&buf_)
+{
+  close();
+
+  _buf  = std::move(buf_);
+  _data = _buf.data();
+  _size = _buf.size();
+}
+
+#ifndef _WIN32
+static
+void
+pread_all(const int       fd_,
+          const fs::path &filepath_,
+          ByteVec        &buf_)
+{
+  size_t off;
+  ssize_t rv;
+
+  off = 0;
+  while(off < buf_.size())
+    {
+      rv = ::pread(fd_,&buf_[off],buf_.size() - off,off);
+      if((rv == -1) && (errno == EINTR))
+        continue;
+      if(rv == -1)
+        throw std::system_error(errno,std::system_category(),"failed to read "+filepath_.string());
+      if(rv == 0)
+        break;
+      off += rv;
+    }
+
+  buf_.resize(off);
+}
+
+void
+MappedFile::open_file(const fs::path &filepath_)
+{
+  int fd;
+  int rv;
+  void *p;
+  struct stat st;
+
+  close();
+
+  fd = ::open(filepath_.c_str(),O_RDONLY|O_CLOEXEC);
+  if(fd == -1)
+    throw std::system_error(errno,std::system_category(),"failed to open "+filepath_.string());
+
+  rv = ::fstat(fd,&st);
+  if(rv == -1)
+    {
+      int err = errno;
+      ::close(fd);
+      throw std::system_error(err,std::system_category(),"failed to stat "+filepath_.string());
+    }
+
+  if(st.st_size == 0)
+    {
+      ::close(fd);
+      return;
+    }
+
+  p = MAP_FAILED;
+  if(S_ISREG(st.st_mode) && l::g_allow_mmap)
+    p = ::mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+
+  if(p != MAP_FAILED)
+    {
+      _data   = (const uint8_t*)p;
+      _size   = st.st_size;
+      _mapped = true;
+      ::close(fd);
+      return;
+    }
+
+  // mmap isn't available or allowed for this file. Fall back to a
+  // bulk read.
+  try
+    {
+      _buf.resize(st.st_size);
+      ::pread_all(fd,filepath_,_buf);
+    }
+  catch(...)
+    {
+      ::close(fd);
+      throw;
+    }
+
+  ::close(fd);
+
+  _data = _buf.data();
+  _size = _buf.size();
+}
+
+void
+MappedFile::close()
+{
+  if(_mapped)
+    ::munmap((void*)_data,_size);
+
+  _buf.clear();
+  _owner.reset();
+  _data   = nullptr;
+  _size   = 0;
+  _mapped = false;
+}
+#else
+void
+MappedFile::open_file(const fs::path &filepath_)
+{
+  std::ifstream is;
+  std::streamsize size;
+
+  close();
+
+  is.open(filepath_,std::ios::binary|std::ios::in);
+  if(!is)
+    throw std::system_error(errno,std::system_category(),"failed to open "+filepath_.string());
+
+  is.seekg(0,std::ios::end);
+  size = is.tellg();
+  is.seekg(0,std::ios::beg);
+  if(size <= 0)
+    return;
+
+  _buf.resize(size);
+  is.read((char*)_buf.data(),size);
+  _buf.resize(is.gcount());
+
+  _data = _buf.data();
+  _size = _buf.size();
+}
+
+void
+MappedFile::close()
+{
+  _buf.clear();
+  _owner.reset();
+  _data   = nullptr;
+  _size   = 0;
+  _mapped = false;
+}
+#endif
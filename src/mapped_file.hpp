@@ -0,0 +1,93 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "bytevec.hpp"
+#include "span.hpp"
+
+#include <filesystem>
+#include <memory>
+
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+  Read-only view of a file's contents. The file is mmap'ed when
+  possible and otherwise read in bulk with pread (or a plain read on
+  platforms without either). Either way the data is exposed as a
+  cspan so it can be handed straight to the identify, chunk, and
+  convert functions without being copied again. Paths naming a file
+  inside a 3DO disc image (see OperaFS) open as a view of the image.
+*/
+class MappedFile
+{
+public:
+  MappedFile();
+  MappedFile(const std::filesystem::path &filepath);
+  MappedFile(MappedFile &&other);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+public:
+  MappedFile& operator=(MappedFile &&other);
+
+public:
+  void open(const std::filesystem::path &filepath);
+  void close();
+
+public:
+  // Whether open() may mmap files. Processes which outlive their
+  // inputs (serve, watch) turn it off: a mapped file truncated or
+  // rewritten underneath them raises SIGBUS rather than an error.
+  static void allow_mmap(const bool allow);
+
+public:
+  // Exposes data_ owned by owner_, which is kept alive until close().
+  void view(std::shared_ptr<const void>  owner,
+            const uint8_t               *data,
+            const size_t                 size);
+  void assign(ByteVec &&buf);
+
+public:
+  const uint8_t *data() const { return _data; }
+  size_t         size() const { return _size; }
+  bool           empty() const { return (_size == 0); }
+  bool           mapped() const { return _mapped; }
+
+public:
+  const uint8_t *begin() const { return _data; }
+  const uint8_t *end() const { return _data + _size; }
+
+public:
+  cspan<uint8_t> span() const { return cspan<uint8_t>(_data,_size); }
+  operator cspan<uint8_t>() const { return span(); }
+
+private:
+  void open_file(const std::filesystem::path &filepath);
+
+private:
+  const uint8_t               *_data;
+  size_t                       _size;
+  bool                         _mapped;
+  ByteVec                      _buf;
+  std::shared_ptr<const void>  _owner;
+};
@@ -0,0 +1,421 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "opera_fs.hpp"
+
+#include "fmt.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  static const uint32_t BLOCK_SIZE_CD       = 2048;
+  static const uint32_t RAW_SECTOR_SIZE     = 2352;
+  static const uint32_t RAW_SECTOR_OFFSET   = 16;
+  static const uint32_t LABEL_SIZE          = 132;
+  static const uint32_t DIR_HEADER_SIZE     = 20;
+  static const uint32_t DIR_ENTRY_SIZE      = 68;
+  static const uint32_t DIR_MAX_DEPTH       = 64;
+  static const uint32_t ENTRY_LAST_IN_DIR   = 0x80000000;
+  static const uint32_t ENTRY_LAST_IN_BLOCK = 0x40000000;
+  static const uint32_t ENTRY_TYPE_MASK     = 0x000000FF;
+  static const uint32_t ENTRY_TYPE_DIR      = 0x07;
+
+  static const uint8_t RAW_SYNC[12] =
+    {0x00,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00};
+
+  static
+  uint32_t
+  be32(const uint8_t *p_)
+  {
+    return (((uint32_t)p_[0] << 24) |
+            ((uint32_t)p_[1] << 16) |
+            ((uint32_t)p_[2] <<  8) |
+            ((uint32_t)p_[3] <<  0));
+  }
+
+  static
+  bool
+  is_label(const uint8_t *p_)
+  {
+    if(p_[0] != 0x01)
+      return false;
+    for(int i = 1; i <= 5; i++)
+      {
+        if(p_[i] != 0x5A)
+          return false;
+      }
+
+    return true;
+  }
+
+  static
+  std::string
+  lower(std::string s_)
+  {
+    for(auto &c : s_)
+      c = std::tolower((unsigned char)c);
+
+    return s_;
+  }
+
+  // "", "/", "a/b/", "/a//b" -> "", "", "/a/b", "/a/b"
+  static
+  std::string
+  normalize(const std::string &inner_)
+  {
+    std::string rv;
+
+    for(const char c : inner_)
+      {
+        if((c == '/') && (rv.empty() || (rv.back() == '/')))
+          continue;
+        if(rv.empty())
+          rv += '/';
+        rv += c;
+      }
+    if(!rv.empty() && (rv.back() == '/'))
+      rv.pop_back();
+
+    return rv;
+  }
+
+  struct CacheEntry
+  {
+    fs::file_time_type              mtime;
+    uintmax_t                       size;
+    std::shared_ptr<const OperaFS>  opera;
+  };
+
+  static std::mutex                                  g_mutex;
+  static std::unordered_map<std::string,CacheEntry>  g_cache;
+}
+
+OperaFS::OperaFS(const fs::path &image_)
+  : _image(image_)
+{
+  const uint8_t *label;
+
+  _file.open(_image);
+
+  if((_file.size() >= (l::RAW_SECTOR_OFFSET + l::LABEL_SIZE)) &&
+     !std::memcmp(_file.data(),l::RAW_SYNC,sizeof(l::RAW_SYNC)))
+    {
+      _sector_size   = l::RAW_SECTOR_SIZE;
+      _sector_offset = l::RAW_SECTOR_OFFSET;
+    }
+  else
+    {
+      _sector_size   = 0;
+      _sector_offset = 0;
+    }
+
+  if(_file.size() < (_sector_offset + l::LABEL_SIZE))
+    throw fmt::exception("'{}' is not a 3DO disc image",_image);
+
+  label = (_file.data() + _sector_offset);
+  if(!l::is_label(label))
+    throw fmt::exception("'{}' is not a 3DO disc image",_image);
+
+  _block_size  = l::be32(label + 76);
+  _block_count = l::be32(label + 80);
+  if(_sector_size == 0)
+    _sector_size = _block_size;
+  if((_block_size == 0) ||
+     ((_sector_offset != 0) && (_block_size != l::BLOCK_SIZE_CD)))
+    throw fmt::exception("'{}' has an unsupported block size of {}",
+                         _image,
+                         _block_size);
+
+  read_dir("",
+           l::be32(label + 100),
+           l::be32(label + 88),
+           0);
+
+  for(size_t i = 0; i < _entries.size(); i++)
+    _index.emplace(l::lower(_entries[i].path),i);
+}
+
+const uint8_t*
+OperaFS::block(const uint32_t block_) const
+{
+  uint64_t offset;
+
+  offset = (((uint64_t)block_ * _sector_size) + _sector_offset);
+  if((offset + _block_size) > _file.size())
+    throw fmt::exception("'{}' is truncated or corrupt: block {} is past the end",
+                         _image,
+                         block_);
+
+  return (_file.data() + offset);
+}
+
+void
+OperaFS::read_dir(const std::string &dirpath_,
+                  const uint32_t     block_,
+                  const uint32_t     block_count_,
+                  const int          depth_)
+{
+  uint32_t idx;
+  uint32_t visited;
+
+  if(depth_ > (int)l::DIR_MAX_DEPTH)
+    throw fmt::exception("'{}' is corrupt: directories nested too deep",_image);
+
+  idx     = 0;
+  visited = 0;
+  while(idx < block_count_)
+    {
+      int32_t next;
+      uint32_t offset;
+      uint32_t end;
+      const uint8_t *p;
+
+      if(visited++ >= block_count_)
+        throw fmt::exception("'{}' is corrupt: directory block loop",_image);
+
+      p      = block(block_ + idx);
+      next   = (int32_t)l::be32(p + 0);
+      end    = std::min(l::be32(p + 12),_block_size);
+      offset = std::max(l::be32(p + 16),l::DIR_HEADER_SIZE);
+
+      while((offset + l::DIR_ENTRY_SIZE + 4) <= end)
+        {
+          Entry entry;
+          uint32_t flags;
+          uint32_t avatars;
+          uint32_t block_count;
+          const uint8_t *e = (p + offset);
+
+          flags       = l::be32(e + 0);
+          avatars     = (l::be32(e + 64) + 1);
+          block_count = l::be32(e + 20);
+          if(avatars > ((end - offset - l::DIR_ENTRY_SIZE) / 4))
+            throw fmt::exception("'{}' is corrupt: bad directory entry",_image);
+
+          entry.path.assign((const char*)(e + 32),
+                            strnlen((const char*)(e + 32),32));
+          entry.path      = dirpath_ + "/" + entry.path;
+          entry.directory = ((flags & l::ENTRY_TYPE_MASK) == l::ENTRY_TYPE_DIR);
+          entry.type      = l::be32(e + 8);
+          entry.size      = l::be32(e + 16);
+          entry.block     = l::be32(e + 68);
+
+          _entries.push_back(entry);
+          if(entry.directory)
+            read_dir(entry.path,entry.block,block_count,depth_ + 1);
+
+          offset += (l::DIR_ENTRY_SIZE + (avatars * 4));
+          if(flags & l::ENTRY_LAST_IN_DIR)
+            return;
+          if(flags & l::ENTRY_LAST_IN_BLOCK)
+            break;
+        }
+
+      if(next < 0)
+        break;
+      idx = next;
+    }
+}
+
+const OperaFS::Entry*
+OperaFS::find(const std::string &path_) const
+{
+  auto iter = _index.find(l::lower(l::normalize(path_)));
+  if(iter == _index.end())
+    return nullptr;
+
+  return &_entries[iter->second];
+}
+
+void
+OperaFS::read(const Entry &entry_,
+              MappedFile  &file_) const
+{
+  ByteVec buf;
+  uint32_t block;
+  uint32_t remaining;
+
+  if(entry_.size == 0)
+    return file_.assign(ByteVec());
+
+  if(_sector_offset == 0)
+    {
+      uint64_t offset;
+
+      offset = ((uint64_t)entry_.block * _block_size);
+      if((offset + entry_.size) > _file.size())
+        throw fmt::exception("'{}' is truncated: '{}' extends past the end",
+                             _image,
+                             entry_.path);
+
+      return file_.view(shared_from_this(),
+                        _file.data() + offset,
+                        entry_.size);
+    }
+
+  buf.reserve(entry_.size);
+  block     = entry_.block;
+  remaining = entry_.size;
+  while(remaining)
+    {
+      uint32_t count;
+      const uint8_t *p;
+
+      count = std::min(remaining,_block_size);
+      p     = this->block(block++);
+      buf.insert(buf.end(),p,p + count);
+      remaining -= count;
+    }
+
+  file_.assign(std::move(buf));
+}
+
+std::shared_ptr<const OperaFS>
+OperaFS::get(const fs::path &image_)
+{
+  l::CacheEntry entry;
+  std::error_code ec;
+
+  entry.mtime = fs::last_write_time(image_,ec);
+  if(!ec)
+    entry.size = fs::file_size(image_,ec);
+  if(ec)
+    throw std::system_error(ec,"failed to open " + image_.string());
+
+  std::lock_guard<std::mutex> lock(l::g_mutex);
+
+  auto iter = l::g_cache.find(image_.string());
+  if((iter != l::g_cache.end()) &&
+     (iter->second.mtime == entry.mtime) &&
+     (iter->second.size == entry.size))
+    return iter->second.opera;
+
+  entry.opera = std::make_shared<const OperaFS>(image_);
+  l::g_cache[image_.string()] = entry;
+
+  return entry.opera;
+}
+
+bool
+OperaFS::split(const fs::path &path_,
+               fs::path       &image_,
+               std::string    &inner_)
+{
+  std::error_code ec;
+  const std::string str = path_.string();
+
+  if(str.find(':') == std::string::npos)
+    return false;
+  if(fs::exists(path_,ec))
+    return false;
+
+  for(size_t pos = str.find(':'); pos != std::string::npos; pos = str.find(':',pos + 1))
+    {
+      fs::path image;
+
+      if(pos == 0)
+        continue;
+
+      image = str.substr(0,pos);
+      if(!fs::is_regular_file(image,ec))
+        continue;
+
+      image_ = image;
+      inner_ = l::normalize(str.substr(pos + 1));
+
+      return true;
+    }
+
+  return false;
+}
+
+fs::path
+OperaFS::join(const fs::path    &image_,
+              const std::string &inner_)
+{
+  return (image_.string() + ":" + inner_);
+}
+
+bool
+OperaFS::is_embedded(const fs::path &path_)
+{
+  fs::path image;
+  std::string inner;
+
+  return OperaFS::split(path_,image,inner);
+}
+
+bool
+OperaFS::exists(const fs::path &path_)
+{
+  fs::path image;
+  std::string inner;
+
+  if(!OperaFS::split(path_,image,inner))
+    return false;
+  if(inner.empty())
+    return true;
+
+  return (OperaFS::get(image)->find(inner) != nullptr);
+}
+
+fs::path
+OperaFS::extraction_path(const fs::path &path_)
+{
+  fs::path image;
+  std::string inner;
+
+  if(!OperaFS::split(path_,image,inner))
+    return path_;
+
+  return (image.string() + ".d" + inner);
+}
+
+bool
+OperaFS::open(const fs::path &path_,
+              MappedFile     &file_)
+{
+  fs::path image;
+  std::string inner;
+  const Entry *entry;
+  std::shared_ptr<const OperaFS> opera;
+
+  if(!OperaFS::split(path_,image,inner))
+    return false;
+
+  opera = OperaFS::get(image);
+  entry = opera->find(inner);
+  if(!entry)
+    throw std::system_error(ENOENT,std::system_category(),"failed to open " + path_.string());
+  if(entry->directory)
+    throw std::system_error(EISDIR,std::system_category(),"failed to open " + path_.string());
+
+  opera->read(*entry,file_);
+
+  return true;
+}
@@ -0,0 +1,103 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+  Read-only access to the Opera filesystem used on 3DO discs.
+
+  The image is mapped once and its directory tree read up front. Both
+  plain 2048 byte sector images (.iso) and raw 2352 byte MODE1 sector
+  images (.bin) are understood. Files in a plain image are handed out
+  as views of the mapping; in a raw image they are gathered from the
+  sectors into a buffer.
+
+  A file inside an image is named IMAGE:PATH, for example
+  game.iso:/Art/title.cel; IMAGE: or IMAGE:/ is the root. Such paths
+  work anywhere an input file does: MappedFile::open reads them and
+  Batch::get_filepaths expands directories within an image.
+*/
+class OperaFS : public std::enable_shared_from_this<OperaFS>
+{
+public:
+  struct Entry
+  {
+    std::string path;
+    bool        directory;
+    uint32_t    type;
+    uint32_t    block;
+    uint32_t    size;
+  };
+
+  typedef std::vector<Entry> EntryVec;
+
+public:
+  OperaFS(const std::filesystem::path &image);
+
+public:
+  const std::filesystem::path &image() const { return _image; }
+  const EntryVec &entries() const { return _entries; }
+  const Entry *find(const std::string &path) const;
+  void read(const Entry &entry,
+            MappedFile  &file) const;
+
+public:
+  // Opened images are kept for the life of the process.
+  static std::shared_ptr<const OperaFS> get(const std::filesystem::path &image);
+
+  static bool split(const std::filesystem::path &path,
+                    std::filesystem::path       &image,
+                    std::string                 &inner);
+  static std::filesystem::path join(const std::filesystem::path &image,
+                                    const std::string           &inner);
+  static bool is_embedded(const std::filesystem::path &path);
+  static bool exists(const std::filesystem::path &path);
+  // Where outputs for an embedded file go by default: IMAGE.d/PATH.
+  static std::filesystem::path extraction_path(const std::filesystem::path &path);
+  // Opens PATH into file_ if it names a file inside an image.
+  static bool open(const std::filesystem::path &path,
+                   MappedFile                  &file);
+
+private:
+  const uint8_t *block(const uint32_t block) const;
+  void read_dir(const std::string &dirpath,
+                const uint32_t     block,
+                const uint32_t     block_count,
+                const int          depth);
+
+private:
+  std::filesystem::path _image;
+  MappedFile            _file;
+  uint32_t              _block_size;
+  uint32_t              _block_count;
+  size_t                _sector_size;
+  size_t                _sector_offset;
+  EntryVec              _entries;
+
+  std::unordered_map<std::string,size_t> _index;
+};
@@ -19,6 +19,8 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
+#include <string>
 #include <vector>
 #include <cstdint>
 
@@ -73,10 +75,61 @@ public:
     Flag rep8    = Flag::DEFAULT;
   };
 
+  struct Batch
+  {
+    unsigned      jobs       = 1;
+    std::uint64_t max_memory = (256 * 1024 * 1024);
+  };
+
+  struct Cache
+  {
+    Path          dirpath;
+    std::uint64_t max_size = (1024 * 1024 * 1024);
+  };
+
+  // Which images of a multi-image input to convert. Everything when
+  // neither --index nor --range is given.
+  struct Select
+  {
+    std::vector<std::uint64_t> indexes;
+    bool                       range = false;
+    std::uint64_t              first = 0;
+    std::uint64_t              last  = UINT64_MAX;
+
+    bool
+    all() const
+    {
+      return (indexes.empty() && !range);
+    }
+
+    bool
+    selected(const std::uint64_t idx_) const
+    {
+      if(all())
+        return true;
+      if(range && (idx_ >= first) && (idx_ <= last))
+        return true;
+      for(const auto idx : indexes)
+        if(idx == idx_)
+          return true;
+      return false;
+    }
+
+    // For convert::select_frames(): empty when selecting everything.
+    std::function<bool(const std::uint64_t)>
+    filter() const
+    {
+      if(all())
+        return {};
+      return [this](const std::uint64_t idx_) { return selected(idx_); };
+    }
+  };
+
   struct Info
   {
     PathVec     filepaths;
     std::string format;
+    bool        brief = false;
   };
 
   struct ListChunks
@@ -84,6 +137,11 @@ public:
     PathVec filepaths;
   };
 
+  struct ListFiles
+  {
+    PathVec filepaths;
+  };
+
   struct DumpPacked
   {
     Path filepath;
@@ -91,16 +149,20 @@ public:
 
   struct ToCEL
   {
+    Batch       batch;
+    Cache       cache;
     CCBFlags    ccb_flags;
     Path        external_palette;
     Path        output_path;
     PathVec     filepaths;
     Pre0Flags   pre0_flags;
+    Select      select;
     bool        coded             = false;
     bool        generate_all      = false;
     bool        ignore_target_ext = false;
     bool        lrform            = false;
     bool        packed            = false;
+    bool        pack_optimal      = false;
     bool        write_plut        = true;
     int         rotation          = 0;
     std::string find_smallest;
@@ -108,8 +170,19 @@ public:
     std::uint8_t     bpp;
   };
 
+  struct Estimate
+  {
+    Path          external_palette;
+    PathVec       filepaths;
+    Select        select;
+    bool          pack_optimal = false;
+    bool          verify       = false;
+    std::uint32_t transparent;
+  };
+
   struct ToBanner
   {
+    Batch   batch;
     PathVec filepaths;
     Path    output_path;
     bool    ignore_target_ext = false;
@@ -117,6 +190,7 @@ public:
 
   struct ToIMAG
   {
+    Batch   batch;
     PathVec filepaths;
     Path    output_path;
     bool    ignore_target_ext = false;
@@ -124,6 +198,7 @@ public:
 
   struct ToLRFORM
   {
+    Batch   batch;
     PathVec filepaths;
     Path    output_path;
     bool    ignore_target_ext = false;
@@ -131,8 +206,10 @@ public:
 
   struct ToImage
   {
+    Batch   batch;
     PathVec filepaths;
     Path    output_path;
+    Select  select;
     bool    ignore_target_ext = false;
   };
 
@@ -144,14 +221,44 @@ public:
     uint32_t transparent;
   };
 
+  struct Manifest
+  {
+    Batch batch;
+    Cache cache;
+    Path  filepath;
+  };
+
+  struct Serve
+  {
+    Batch batch;
+    Path  socket;
+  };
+
+  struct Client
+  {
+    Path socket;
+  };
+
+  struct Watch
+  {
+    Batch    batch;
+    unsigned debounce = 200;
+  };
+
 public:
   Info       info;
   ListChunks list_chunks;
+  ListFiles  list_files;
   DumpPacked dump_packed;
   ToCEL      to_cel;
+  Estimate   estimate;
   ToBanner   to_banner;
   ToIMAG     to_imag;
   ToLRFORM   to_lrform;
   ToImage    to_image;
   ToNFSSHPM  to_nfs_shpm;
+  Manifest   manifest;
+  Serve      serve;
+  Client     client;
+  Watch      watch;
 };
@@ -0,0 +1,52 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "output_files.hpp"
+
+#include <mutex>
+
+
+namespace l
+{
+  static std::mutex                          g_mutex;
+  static std::vector<std::filesystem::path> *g_collect = nullptr;
+}
+
+void
+OutputFiles::add(const std::filesystem::path &filepath_)
+{
+  std::lock_guard<std::mutex> lock(l::g_mutex);
+
+  if(l::g_collect)
+    l::g_collect->emplace_back(filepath_);
+}
+
+OutputFiles::Collect::Collect(std::vector<std::filesystem::path> &filepaths_)
+{
+  std::lock_guard<std::mutex> lock(l::g_mutex);
+
+  _prev = l::g_collect;
+  l::g_collect = &filepaths_;
+}
+
+OutputFiles::Collect::~Collect()
+{
+  std::lock_guard<std::mutex> lock(l::g_mutex);
+
+  l::g_collect = _prev;
+}
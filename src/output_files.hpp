@@ -0,0 +1,48 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+
+/*
+  Every file a conversion writes is reported here. While a Collect is
+  alive the paths are appended to its vector; otherwise they are
+  dropped. Unlike Log::Capture this is process wide since batch
+  workers write from their own threads. `watch` uses it to tell its
+  own outputs apart from edits.
+*/
+namespace OutputFiles
+{
+  void add(const std::filesystem::path &filepath);
+
+  class Collect
+  {
+  public:
+    Collect(std::vector<std::filesystem::path> &filepaths);
+    ~Collect();
+
+    Collect(const Collect&) = delete;
+    Collect& operator=(const Collect&) = delete;
+
+  private:
+    std::vector<std::filesystem::path> *_prev;
+  };
+}
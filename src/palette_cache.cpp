@@ -0,0 +1,100 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "palette_cache.hpp"
+
+#include "chunk_ids.hpp"
+#include "chunk_reader.hpp"
+#include "identify_file.hpp"
+#include "mapped_file.hpp"
+
+#include "fmt.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  struct Entry
+  {
+    fs::file_time_type                            mtime;
+    uintmax_t                                     size;
+    std::shared_ptr<const PaletteCache::Palette> palette;
+  };
+
+  static std::mutex                             g_mutex;
+  static std::unordered_map<std::string,Entry>  g_cache;
+
+  static
+  std::shared_ptr<const PaletteCache::Palette>
+  load(const fs::path &filepath_)
+  {
+    u32 filetype;
+    ChunkVec chunks;
+    MappedFile file;
+    std::shared_ptr<PaletteCache::Palette> palette;
+
+    file.open(filepath_);
+    filetype = IdentifyFile::identify(file);
+    if(!IdentifyFile::chunked_type(filetype))
+      throw fmt::exception("'{}' does not appear to be a 3DO formated file",filepath_);
+
+    ChunkReader::chunkify(file,chunks);
+    for(const auto &chunk : chunks)
+      {
+        if(chunk.id() != CHUNK_PLUT)
+          continue;
+
+        palette = std::make_shared<PaletteCache::Palette>();
+        palette->plut = chunk;
+
+        return palette;
+      }
+
+    throw fmt::exception("No CEL PLUT found in '{}'",filepath_);
+  }
+}
+
+std::shared_ptr<const PaletteCache::Palette>
+PaletteCache::get(const fs::path &filepath_)
+{
+  l::Entry entry;
+  std::error_code ec;
+
+  entry.mtime = fs::last_write_time(filepath_,ec);
+  if(!ec)
+    entry.size = fs::file_size(filepath_,ec);
+  if(ec)
+    return l::load(filepath_);
+
+  std::lock_guard<std::mutex> lock(l::g_mutex);
+
+  auto iter = l::g_cache.find(filepath_.string());
+  if((iter != l::g_cache.end()) &&
+     (iter->second.mtime == entry.mtime) &&
+     (iter->second.size == entry.size))
+    return iter->second.palette;
+
+  entry.palette = l::load(filepath_);
+  l::g_cache[filepath_.string()] = entry;
+
+  return entry.palette;
+}
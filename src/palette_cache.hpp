@@ -0,0 +1,41 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "plut.hpp"
+
+#include <filesystem>
+#include <memory>
+
+
+/*
+  Parsed --external-palette files. Every coded encoder asks for the
+  palette once per attempt and find-smallest makes dozens of attempts
+  per image so the file is read, identified and chunkified once per
+  path and modification time and shared between threads.
+*/
+namespace PaletteCache
+{
+  struct Palette
+  {
+    PLUT plut;
+  };
+
+  std::shared_ptr<const Palette> get(const std::filesystem::path &filepath);
+}
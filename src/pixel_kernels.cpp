@@ -0,0 +1,736 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "pixel_kernels.hpp"
+
+#include "coded_lut.hpp"
+#include "pixel_writer.hpp"
+
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_KERNELS_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define PIXEL_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+
+namespace l
+{
+  static
+  inline
+  u16
+  u16be(const u8 *p_)
+  {
+    return ((p_[0] << 8) | (p_[1] << 0));
+  }
+
+  static
+  const
+  std::array<RGBA8888,256>&
+  rgb332_table(const bool rep8_)
+  {
+    static const auto build = [](const bool rep8)
+    {
+      std::array<RGBA8888,256> t;
+
+      for(u32 i = 0; i < t.size(); i++)
+        t[i] = (rep8 ?
+                PixelWriter::rgba_rep8_332(i) :
+                PixelWriter::rgba_332(i));
+
+      return t;
+    };
+    static const std::array<RGBA8888,256> plain = build(false);
+    static const std::array<RGBA8888,256> rep8  = build(true);
+
+    return (rep8_ ? rep8 : plain);
+  }
+
+  static
+  void
+  rgb0555_c(const u8     *src_,
+            RGBA8888     *dst_,
+            const size_t  n_)
+  {
+    const RGBA8888 *t = CodedLUT::rgb0555();
+
+    for(size_t i = 0; i < n_; i++)
+      dst_[i] = t[l::u16be(&src_[i * 2]) & 0x7FFF];
+  }
+
+  static
+  void
+  rgb332_c(const u8     *src_,
+           RGBA8888     *dst_,
+           const size_t  n_,
+           const bool    rep8_)
+  {
+    const std::array<RGBA8888,256> &t = l::rgb332_table(rep8_);
+
+    for(size_t i = 0; i < n_; i++)
+      dst_[i] = t[src_[i]];
+  }
+
+  static
+  void
+  lrform_c(const u8     *src_,
+           RGBA8888     *even_,
+           RGBA8888     *odd_,
+           const size_t  n_)
+  {
+    const RGBA8888 *t = CodedLUT::rgb0555();
+
+    for(size_t i = 0; i < n_; i++)
+      {
+        even_[i] = t[l::u16be(&src_[(i * 4) + 0]) & 0x7FFF];
+        odd_[i]  = t[l::u16be(&src_[(i * 4) + 2]) & 0x7FFF];
+      }
+  }
+}
+
+#if defined(PIXEL_KERNELS_X86)
+// Each kernel works on 16bit lanes: r, g and b are widened to 8 bits
+// in place then interleaved as (r | g << 8) and (b | 0xFF00) pairs
+// which in little endian memory order is an RGBA8888 pixel.
+namespace sse2
+{
+  __attribute__((target("sse2")))
+  static
+  inline
+  void
+  store_rgb(__m128i   r_,
+            __m128i   g_,
+            __m128i   b_,
+            RGBA8888 *dst_)
+  {
+    __m128i rg;
+    __m128i ba;
+
+    rg = _mm_or_si128(r_,_mm_slli_epi16(g_,8));
+    ba = _mm_or_si128(b_,_mm_set1_epi16((short)0xFF00));
+
+    _mm_storeu_si128((__m128i*)&dst_[0],_mm_unpacklo_epi16(rg,ba));
+    _mm_storeu_si128((__m128i*)&dst_[4],_mm_unpackhi_epi16(rg,ba));
+  }
+
+  // v_ holds 8 host order RGB0555 values
+  __attribute__((target("sse2")))
+  static
+  inline
+  void
+  store_0555(__m128i   v_,
+             RGBA8888 *dst_)
+  {
+    const __m128i m5 = _mm_set1_epi16(0x1F);
+    __m128i r;
+    __m128i g;
+    __m128i b;
+
+    r = _mm_and_si128(_mm_srli_epi16(v_,10),m5);
+    g = _mm_and_si128(_mm_srli_epi16(v_,5),m5);
+    b = _mm_and_si128(v_,m5);
+
+    r = _mm_or_si128(_mm_slli_epi16(r,3),_mm_srli_epi16(r,2));
+    g = _mm_or_si128(_mm_slli_epi16(g,3),_mm_srli_epi16(g,2));
+    b = _mm_or_si128(_mm_slli_epi16(b,3),_mm_srli_epi16(b,2));
+
+    store_rgb(r,g,b,dst_);
+  }
+
+  __attribute__((target("sse2")))
+  static
+  inline
+  __m128i
+  bswap16(__m128i v_)
+  {
+    return _mm_or_si128(_mm_slli_epi16(v_,8),_mm_srli_epi16(v_,8));
+  }
+
+  // v_ holds 8 RGB332 values zero extended to 16 bits
+  __attribute__((target("sse2")))
+  static
+  inline
+  void
+  store_332(__m128i     v_,
+            const bool  rep8_,
+            RGBA8888   *dst_)
+  {
+    __m128i r;
+    __m128i g;
+    __m128i b;
+
+    if(rep8_)
+      {
+        const __m128i e0 = _mm_set1_epi16(0xE0);
+        const __m128i b7 = _mm_set1_epi16(0x80);
+        const __m128i b6 = _mm_set1_epi16(0x40);
+
+        r = _mm_and_si128(v_,e0);
+        r = _mm_or_si128(r,_mm_srli_epi16(_mm_and_si128(r,b7),3));
+        r = _mm_or_si128(r,_mm_srli_epi16(_mm_and_si128(r,b6),3));
+        g = _mm_and_si128(_mm_slli_epi16(v_,3),e0);
+        g = _mm_or_si128(g,_mm_srli_epi16(_mm_and_si128(g,b7),3));
+        g = _mm_or_si128(g,_mm_srli_epi16(_mm_and_si128(g,b6),3));
+        b = _mm_and_si128(_mm_slli_epi16(v_,6),e0);
+        b = _mm_or_si128(b,_mm_srli_epi16(_mm_and_si128(b,b7),2));
+        b = _mm_or_si128(b,_mm_srli_epi16(_mm_and_si128(b,b7),4));
+        b = _mm_or_si128(b,_mm_srli_epi16(_mm_and_si128(b,b6),2));
+      }
+    else
+      {
+        const __m128i m3 = _mm_set1_epi16(0x07);
+        const __m128i m2 = _mm_set1_epi16(0x03);
+
+        r = _mm_and_si128(_mm_srli_epi16(v_,5),m3);
+        g = _mm_and_si128(_mm_srli_epi16(v_,2),m3);
+        b = _mm_and_si128(v_,m2);
+        r = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r,5),_mm_slli_epi16(r,2)),
+                         _mm_srli_epi16(r,1));
+        g = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(g,5),_mm_slli_epi16(g,2)),
+                         _mm_srli_epi16(g,1));
+        b = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(b,6),_mm_slli_epi16(b,4)),
+                         _mm_or_si128(_mm_slli_epi16(b,2),b));
+      }
+
+    store_rgb(r,g,b,dst_);
+  }
+
+  __attribute__((target("sse2")))
+  static
+  void
+  rgb0555(const u8     *src_,
+          RGBA8888     *dst_,
+          const size_t  n_)
+  {
+    size_t i;
+
+    for(i = 0; (i + 8) <= n_; i += 8)
+      store_0555(bswap16(_mm_loadu_si128((const __m128i*)&src_[i * 2])),
+                 &dst_[i]);
+
+    l::rgb0555_c(&src_[i * 2],&dst_[i],n_ - i);
+  }
+
+  __attribute__((target("sse2")))
+  static
+  void
+  rgb332(const u8     *src_,
+         RGBA8888     *dst_,
+         const size_t  n_,
+         const bool    rep8_)
+  {
+    size_t i;
+    const __m128i zero = _mm_setzero_si128();
+
+    for(i = 0; (i + 16) <= n_; i += 16)
+      {
+        __m128i v;
+
+        v = _mm_loadu_si128((const __m128i*)&src_[i]);
+        store_332(_mm_unpacklo_epi8(v,zero),rep8_,&dst_[i + 0]);
+        store_332(_mm_unpackhi_epi8(v,zero),rep8_,&dst_[i + 8]);
+      }
+
+    l::rgb332_c(&src_[i],&dst_[i],n_ - i,rep8_);
+  }
+
+  __attribute__((target("sse2")))
+  static
+  void
+  lrform(const u8     *src_,
+         RGBA8888     *even_,
+         RGBA8888     *odd_,
+         const size_t  n_)
+  {
+    size_t i;
+    const __m128i m15 = _mm_set1_epi32(0x7FFF);
+
+    // Masking off the ignored high bit keeps packs_epi32 from
+    // saturating.
+    for(i = 0; (i + 8) <= n_; i += 8)
+      {
+        __m128i a;
+        __m128i b;
+
+        a = bswap16(_mm_loadu_si128((const __m128i*)&src_[(i * 4) +  0]));
+        b = bswap16(_mm_loadu_si128((const __m128i*)&src_[(i * 4) + 16]));
+
+        store_0555(_mm_packs_epi32(_mm_and_si128(a,m15),
+                                   _mm_and_si128(b,m15)),
+                   &even_[i]);
+        store_0555(_mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a,16),m15),
+                                   _mm_and_si128(_mm_srli_epi32(b,16),m15)),
+                   &odd_[i]);
+      }
+
+    l::lrform_c(&src_[i * 4],&even_[i],&odd_[i],n_ - i);
+  }
+}
+
+namespace avx2
+{
+  __attribute__((target("avx2")))
+  static
+  inline
+  void
+  store_rgb(__m256i   r_,
+            __m256i   g_,
+            __m256i   b_,
+            RGBA8888 *dst_)
+  {
+    __m256i rg;
+    __m256i ba;
+    __m256i lo;
+    __m256i hi;
+
+    rg = _mm256_or_si256(r_,_mm256_slli_epi16(g_,8));
+    ba = _mm256_or_si256(b_,_mm256_set1_epi16((short)0xFF00));
+    lo = _mm256_unpacklo_epi16(rg,ba);
+    hi = _mm256_unpackhi_epi16(rg,ba);
+
+    // unpack works within 128bit lanes
+    _mm256_storeu_si256((__m256i*)&dst_[0],_mm256_permute2x128_si256(lo,hi,0x20));
+    _mm256_storeu_si256((__m256i*)&dst_[8],_mm256_permute2x128_si256(lo,hi,0x31));
+  }
+
+  __attribute__((target("avx2")))
+  static
+  inline
+  void
+  store_0555(__m256i   v_,
+             RGBA8888 *dst_)
+  {
+    const __m256i m5 = _mm256_set1_epi16(0x1F);
+    __m256i r;
+    __m256i g;
+    __m256i b;
+
+    r = _mm256_and_si256(_mm256_srli_epi16(v_,10),m5);
+    g = _mm256_and_si256(_mm256_srli_epi16(v_,5),m5);
+    b = _mm256_and_si256(v_,m5);
+
+    r = _mm256_or_si256(_mm256_slli_epi16(r,3),_mm256_srli_epi16(r,2));
+    g = _mm256_or_si256(_mm256_slli_epi16(g,3),_mm256_srli_epi16(g,2));
+    b = _mm256_or_si256(_mm256_slli_epi16(b,3),_mm256_srli_epi16(b,2));
+
+    store_rgb(r,g,b,dst_);
+  }
+
+  __attribute__((target("avx2")))
+  static
+  inline
+  __m256i
+  bswap16(__m256i v_)
+  {
+    return _mm256_or_si256(_mm256_slli_epi16(v_,8),_mm256_srli_epi16(v_,8));
+  }
+
+  __attribute__((target("avx2")))
+  static
+  inline
+  void
+  store_332(__m256i     v_,
+            const bool  rep8_,
+            RGBA8888   *dst_)
+  {
+    __m256i r;
+    __m256i g;
+    __m256i b;
+
+    if(rep8_)
+      {
+        const __m256i e0 = _mm256_set1_epi16(0xE0);
+        const __m256i b7 = _mm256_set1_epi16(0x80);
+        const __m256i b6 = _mm256_set1_epi16(0x40);
+
+        r = _mm256_and_si256(v_,e0);
+        r = _mm256_or_si256(r,_mm256_srli_epi16(_mm256_and_si256(r,b7),3));
+        r = _mm256_or_si256(r,_mm256_srli_epi16(_mm256_and_si256(r,b6),3));
+        g = _mm256_and_si256(_mm256_slli_epi16(v_,3),e0);
+        g = _mm256_or_si256(g,_mm256_srli_epi16(_mm256_and_si256(g,b7),3));
+        g = _mm256_or_si256(g,_mm256_srli_epi16(_mm256_and_si256(g,b6),3));
+        b = _mm256_and_si256(_mm256_slli_epi16(v_,6),e0);
+        b = _mm256_or_si256(b,_mm256_srli_epi16(_mm256_and_si256(b,b7),2));
+        b = _mm256_or_si256(b,_mm256_srli_epi16(_mm256_and_si256(b,b7),4));
+        b = _mm256_or_si256(b,_mm256_srli_epi16(_mm256_and_si256(b,b6),2));
+      }
+    else
+      {
+        const __m256i m3 = _mm256_set1_epi16(0x07);
+        const __m256i m2 = _mm256_set1_epi16(0x03);
+
+        r = _mm256_and_si256(_mm256_srli_epi16(v_,5),m3);
+        g = _mm256_and_si256(_mm256_srli_epi16(v_,2),m3);
+        b = _mm256_and_si256(v_,m2);
+        r = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(r,5),_mm256_slli_epi16(r,2)),
+                            _mm256_srli_epi16(r,1));
+        g = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(g,5),_mm256_slli_epi16(g,2)),
+                            _mm256_srli_epi16(g,1));
+        b = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(b,6),_mm256_slli_epi16(b,4)),
+                            _mm256_or_si256(_mm256_slli_epi16(b,2),b));
+      }
+
+    store_rgb(r,g,b,dst_);
+  }
+
+  __attribute__((target("avx2")))
+  static
+  void
+  rgb0555(const u8     *src_,
+          RGBA8888     *dst_,
+          const size_t  n_)
+  {
+    size_t i;
+
+    for(i = 0; (i + 16) <= n_; i += 16)
+      store_0555(bswap16(_mm256_loadu_si256((const __m256i*)&src_[i * 2])),
+                 &dst_[i]);
+
+    l::rgb0555_c(&src_[i * 2],&dst_[i],n_ - i);
+  }
+
+  __attribute__((target("avx2")))
+  static
+  void
+  rgb332(const u8     *src_,
+         RGBA8888     *dst_,
+         const size_t  n_,
+         const bool    rep8_)
+  {
+    size_t i;
+
+    for(i = 0; (i + 16) <= n_; i += 16)
+      {
+        __m128i v;
+
+        v = _mm_loadu_si128((const __m128i*)&src_[i]);
+        store_332(_mm256_cvtepu8_epi16(v),rep8_,&dst_[i]);
+      }
+
+    l::rgb332_c(&src_[i],&dst_[i],n_ - i,rep8_);
+  }
+
+  __attribute__((target("avx2")))
+  static
+  void
+  lrform(const u8     *src_,
+         RGBA8888     *even_,
+         RGBA8888     *odd_,
+         const size_t  n_)
+  {
+    size_t i;
+    const __m256i m15 = _mm256_set1_epi32(0x7FFF);
+
+    for(i = 0; (i + 16) <= n_; i += 16)
+      {
+        __m256i a;
+        __m256i b;
+        __m256i e;
+        __m256i o;
+
+        a = bswap16(_mm256_loadu_si256((const __m256i*)&src_[(i * 4) +  0]));
+        b = bswap16(_mm256_loadu_si256((const __m256i*)&src_[(i * 4) + 32]));
+
+        // packs works within 128bit lanes: restore pixel order after
+        e = _mm256_packs_epi32(_mm256_and_si256(a,m15),
+                               _mm256_and_si256(b,m15));
+        o = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a,16),m15),
+                               _mm256_and_si256(_mm256_srli_epi32(b,16),m15));
+        store_0555(_mm256_permute4x64_epi64(e,0xD8),&even_[i]);
+        store_0555(_mm256_permute4x64_epi64(o,0xD8),&odd_[i]);
+      }
+
+    l::lrform_c(&src_[i * 4],&even_[i],&odd_[i],n_ - i);
+  }
+}
+#endif
+
+#if defined(PIXEL_KERNELS_NEON)
+namespace neon
+{
+  static
+  inline
+  void
+  store_rgb(uint16x8_t  r_,
+            uint16x8_t  g_,
+            uint16x8_t  b_,
+            RGBA8888   *dst_)
+  {
+    uint8x8x4_t rgba;
+
+    rgba.val[0] = vmovn_u16(r_);
+    rgba.val[1] = vmovn_u16(g_);
+    rgba.val[2] = vmovn_u16(b_);
+    rgba.val[3] = vdup_n_u8(0xFF);
+
+    vst4_u8((u8*)dst_,rgba);
+  }
+
+  static
+  inline
+  void
+  store_0555(uint16x8_t  v_,
+             RGBA8888   *dst_)
+  {
+    const uint16x8_t m5 = vdupq_n_u16(0x1F);
+    uint16x8_t r;
+    uint16x8_t g;
+    uint16x8_t b;
+
+    r = vandq_u16(vshrq_n_u16(v_,10),m5);
+    g = vandq_u16(vshrq_n_u16(v_,5),m5);
+    b = vandq_u16(v_,m5);
+
+    r = vorrq_u16(vshlq_n_u16(r,3),vshrq_n_u16(r,2));
+    g = vorrq_u16(vshlq_n_u16(g,3),vshrq_n_u16(g,2));
+    b = vorrq_u16(vshlq_n_u16(b,3),vshrq_n_u16(b,2));
+
+    store_rgb(r,g,b,dst_);
+  }
+
+  static
+  inline
+  uint16x8_t
+  load_u16be(const u8 *src_)
+  {
+    return vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src_)));
+  }
+
+  static
+  inline
+  void
+  store_332(uint16x8_t  v_,
+            const bool  rep8_,
+            RGBA8888   *dst_)
+  {
+    uint16x8_t r;
+    uint16x8_t g;
+    uint16x8_t b;
+
+    if(rep8_)
+      {
+        const uint16x8_t e0 = vdupq_n_u16(0xE0);
+        const uint16x8_t b7 = vdupq_n_u16(0x80);
+        const uint16x8_t b6 = vdupq_n_u16(0x40);
+
+        r = vandq_u16(v_,e0);
+        r = vorrq_u16(r,vshrq_n_u16(vandq_u16(r,b7),3));
+        r = vorrq_u16(r,vshrq_n_u16(vandq_u16(r,b6),3));
+        g = vandq_u16(vshlq_n_u16(v_,3),e0);
+        g = vorrq_u16(g,vshrq_n_u16(vandq_u16(g,b7),3));
+        g = vorrq_u16(g,vshrq_n_u16(vandq_u16(g,b6),3));
+        b = vandq_u16(vshlq_n_u16(v_,6),e0);
+        b = vorrq_u16(b,vshrq_n_u16(vandq_u16(b,b7),2));
+        b = vorrq_u16(b,vshrq_n_u16(vandq_u16(b,b7),4));
+        b = vorrq_u16(b,vshrq_n_u16(vandq_u16(b,b6),2));
+      }
+    else
+      {
+        const uint16x8_t m3 = vdupq_n_u16(0x07);
+        const uint16x8_t m2 = vdupq_n_u16(0x03);
+
+        r = vandq_u16(vshrq_n_u16(v_,5),m3);
+        g = vandq_u16(vshrq_n_u16(v_,2),m3);
+        b = vandq_u16(v_,m2);
+        r = vorrq_u16(vorrq_u16(vshlq_n_u16(r,5),vshlq_n_u16(r,2)),vshrq_n_u16(r,1));
+        g = vorrq_u16(vorrq_u16(vshlq_n_u16(g,5),vshlq_n_u16(g,2)),vshrq_n_u16(g,1));
+        b = vorrq_u16(vorrq_u16(vshlq_n_u16(b,6),vshlq_n_u16(b,4)),
+                      vorrq_u16(vshlq_n_u16(b,2),b));
+      }
+
+    store_rgb(r,g,b,dst_);
+  }
+
+  static
+  void
+  rgb0555(const u8     *src_,
+          RGBA8888     *dst_,
+          const size_t  n_)
+  {
+    size_t i;
+
+    for(i = 0; (i + 8) <= n_; i += 8)
+      store_0555(load_u16be(&src_[i * 2]),&dst_[i]);
+
+    l::rgb0555_c(&src_[i * 2],&dst_[i],n_ - i);
+  }
+
+  static
+  void
+  rgb332(const u8     *src_,
+         RGBA8888     *dst_,
+         const size_t  n_,
+         const bool    rep8_)
+  {
+    size_t i;
+
+    for(i = 0; (i + 8) <= n_; i += 8)
+      store_332(vmovl_u8(vld1_u8(&src_[i])),rep8_,&dst_[i]);
+
+    l::rgb332_c(&src_[i],&dst_[i],n_ - i,rep8_);
+  }
+
+  static
+  void
+  lrform(const u8     *src_,
+         RGBA8888     *even_,
+         RGBA8888     *odd_,
+         const size_t  n_)
+  {
+    size_t i;
+
+    for(i = 0; (i + 8) <= n_; i += 8)
+      {
+        uint8x16x2_t v;
+        uint16x8x2_t eo;
+
+        // vld2 on 16bit lanes splits even and odd row pixels
+        eo = vld2q_u16((const u16*)&src_[i * 4]);
+        v.val[0] = vrev16q_u8(vreinterpretq_u8_u16(eo.val[0]));
+        v.val[1] = vrev16q_u8(vreinterpretq_u8_u16(eo.val[1]));
+
+        store_0555(vreinterpretq_u16_u8(v.val[0]),&even_[i]);
+        store_0555(vreinterpretq_u16_u8(v.val[1]),&odd_[i]);
+      }
+
+    l::lrform_c(&src_[i * 4],&even_[i],&odd_[i],n_ - i);
+  }
+}
+#endif
+
+namespace l
+{
+  enum class ISA
+    {
+      C,
+      SSE2,
+      AVX2,
+      NEON
+    };
+
+  static
+  ISA
+  detect()
+  {
+#if defined(PIXEL_KERNELS_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+      return ISA::AVX2;
+    if(__builtin_cpu_supports("sse2"))
+      return ISA::SSE2;
+#elif defined(PIXEL_KERNELS_NEON)
+    return ISA::NEON;
+#endif
+
+    return ISA::C;
+  }
+
+  static
+  ISA
+  isa()
+  {
+    static const ISA isa = l::detect();
+
+    return isa;
+  }
+}
+
+void
+PixelKernels::rgb0555_to_rgba8888(const u8     *src_,
+                                  RGBA8888     *dst_,
+                                  const size_t  n_)
+{
+  switch(l::isa())
+    {
+#if defined(PIXEL_KERNELS_X86)
+    case l::ISA::AVX2:
+      return avx2::rgb0555(src_,dst_,n_);
+    case l::ISA::SSE2:
+      return sse2::rgb0555(src_,dst_,n_);
+#elif defined(PIXEL_KERNELS_NEON)
+    case l::ISA::NEON:
+      return neon::rgb0555(src_,dst_,n_);
+#endif
+    default:
+      return l::rgb0555_c(src_,dst_,n_);
+    }
+}
+
+static
+void
+rgb332_to_rgba8888(const u8     *src_,
+                   RGBA8888     *dst_,
+                   const size_t  n_,
+                   const bool    rep8_)
+{
+  switch(l::isa())
+    {
+#if defined(PIXEL_KERNELS_X86)
+    case l::ISA::AVX2:
+      return avx2::rgb332(src_,dst_,n_,rep8_);
+    case l::ISA::SSE2:
+      return sse2::rgb332(src_,dst_,n_,rep8_);
+#elif defined(PIXEL_KERNELS_NEON)
+    case l::ISA::NEON:
+      return neon::rgb332(src_,dst_,n_,rep8_);
+#endif
+    default:
+      return l::rgb332_c(src_,dst_,n_,rep8_);
+    }
+}
+
+void
+PixelKernels::rgb332_to_rgba8888(const u8     *src_,
+                                 RGBA8888     *dst_,
+                                 const size_t  n_)
+{
+  ::rgb332_to_rgba8888(src_,dst_,n_,false);
+}
+
+void
+PixelKernels::rep8_rgb332_to_rgba8888(const u8     *src_,
+                                      RGBA8888     *dst_,
+                                      const size_t  n_)
+{
+  ::rgb332_to_rgba8888(src_,dst_,n_,true);
+}
+
+void
+PixelKernels::lrform_to_rgba8888(const u8     *src_,
+                                 RGBA8888     *even_,
+                                 RGBA8888     *odd_,
+                                 const size_t  n_)
+{
+  switch(l::isa())
+    {
+#if defined(PIXEL_KERNELS_X86)
+    case l::ISA::AVX2:
+      return avx2::lrform(src_,even_,odd_,n_);
+    case l::ISA::SSE2:
+      return sse2::lrform(src_,even_,odd_,n_);
+#elif defined(PIXEL_KERNELS_NEON)
+    case l::ISA::NEON:
+      return neon::lrform(src_,even_,odd_,n_);
+#endif
+    default:
+      return l::lrform_c(src_,even_,odd_,n_);
+    }
+}
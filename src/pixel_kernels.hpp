@@ -0,0 +1,45 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "rgba8888.hpp"
+#include "types_ints.h"
+
+#include <cstddef>
+
+
+// Bulk conversions of uncoded 3DO pixels to RGBA8888. The widest
+// implementation the CPU supports (AVX2 or SSE2 on x86, NEON on
+// aarch64, portable C++ otherwise) is picked on first use.
+namespace PixelKernels
+{
+  // n big endian RGB0555 pixels. The high bit is ignored.
+  void rgb0555_to_rgba8888(const u8 *src, RGBA8888 *dst, const size_t n);
+
+  // n RGB332 pixels, expanded plainly or as the REP8 CCB flag does.
+  void rgb332_to_rgba8888(const u8 *src, RGBA8888 *dst, const size_t n);
+  void rep8_rgb332_to_rgba8888(const u8 *src, RGBA8888 *dst, const size_t n);
+
+  // n LRFORM 32bit words. Each holds the big endian RGB0555 pixel of
+  // an even row followed by the one below it in the odd row.
+  void lrform_to_rgba8888(const u8  *src,
+                          RGBA8888  *even,
+                          RGBA8888  *odd,
+                          const size_t n);
+}
@@ -2,17 +2,18 @@
 
 #include "bitmap.hpp"
 #include "byteswap.hpp"
-#include "ccb_flags.hpp"
-#include "fmt.hpp"
-#include "plut.hpp"
+#include "coded_lut.hpp"
 #include "rgba8888.hpp"
 
 #include "scale.hpp"
 #include "types_ints.h"
 
 #include <cstdint>
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 
+// Writes uncoded pixels. Coded pixels go through PixelWriterCoded.
 class PixelWriter
 {
 private:
@@ -24,11 +25,7 @@ private:
 
 private:
   u8   _bpp;
-  bool _coded;
   bool _rep8;
-  u8   _pluta;
-  PLUT _plut;
-  u32  _pixc;
 
 public:
   size_t
@@ -54,32 +51,8 @@ public:
     _n    = sizeof(RGBA8888);
     _idx  = 0;
 
-    _bpp   = bpp_;
-    _coded = false;
-    _rep8  = rep8_;
-    _pluta = 0;
-    _pixc  = PPMP_OPAQUE;
-  }
-
-  void
-  reset(Bitmap     &b_,
-        const PLUT &plut_,
-        const u8    pluta_,
-        const u8    bpp_,
-        const u32   pixc_ = PPMP_OPAQUE)
-  {
-    _data = (u8*)b_.d.get();
-    _w    = b_.w;
-    _h    = b_.h;
-    _n    = sizeof(RGBA8888);
-    _idx  = 0;
-
-    _bpp   = bpp_;
-    _coded = true;
-    _rep8  = false;
-    _pluta = pluta_;
-    _plut  = plut_;
-    _pixc  = pixc_;
+    _bpp  = bpp_;
+    _rep8 = rep8_;
   }
 
   void
@@ -119,18 +92,6 @@ public:
   {
     switch(_bpp)
       {
-      case 1:
-        write_1bpp(p_);
-        break;
-      case 2:
-        write_2bpp(p_);
-        break;
-      case 4:
-        write_4bpp(p_);
-        break;
-      case 6:
-        write_6bpp(p_);
-        break;
       case 8:
         write_8bpp(p_);
         break;
@@ -143,9 +104,47 @@ public:
   void
   write(const u32 p_,
         const u32 n_)
+  {
+    fill(p_,n_);
+  }
+
+  RGBA8888
+  rgba(const u32 p_) const
+  {
+    switch(_bpp)
+      {
+      case 8:
+        return (_rep8 ? rgba_rep8_332(p_) : rgba_332(p_));
+      case 16:
+        return CodedLUT::rgb0555()[p_ & 0x7FFF];
+      }
+
+    return RGBA8888(0,0,0,0);
+  }
+
+  // n_ copies of pixel p_.
+  void
+  fill(const u32 p_,
+       const u32 n_)
+  {
+    std::fill_n((RGBA8888*)&_data[_idx],n_,rgba(p_));
+    _idx += (n_ * _n);
+  }
+
+  // n_ transparent pixels.
+  void
+  zero(const u32 n_)
+  {
+    memset(&_data[_idx],0,(n_ * _n));
+    _idx += (n_ * _n);
+  }
+
+  void
+  literal(const u32 *p_,
+          const u32  n_)
   {
     for(u32 i = 0; i < n_; i++)
-      write(p_);
+      write(p_[i]);
   }
 
   void
@@ -171,35 +170,14 @@ public:
   void
   write_transparent(const u32 n_)
   {
-    for(u32 i = 0; i < n_; i++)
-      write_rgba(0,0,0,0);
+    zero(n_);
   }
 
   void
   write_0555(const u16 rgb_)
   {
-    u8 r,g,b;
-
-    r = ((rgb_ >> 10) & 0x1F);
-    r = scale_u5_to_u8(r);
-    g = ((rgb_ >>  5) & 0x1F);
-    g = scale_u5_to_u8(g);
-    b = ((rgb_ >>  0) & 0x1F);
-    b = scale_u5_to_u8(b);
-
-    write_rgb(r,g,b);
-  }
-
-  void
-  write_coded_16bpp(const u16 rgb_)
-  {
-    u16 rgb;
-    u32 amv;
-
-    amv = ((rgb_ & 0x3FE) >> 5);
-    rgb = (_plut.at(rgb_ & 0x1F) & 0x7FFF);
-
-    write_uncoded_16bpp(rgb);
+    memcpy(&_data[_idx],&CodedLUT::rgb0555()[rgb_ & 0x7FFF],sizeof(RGBA8888));
+    _idx += sizeof(RGBA8888);
   }
 
   void
@@ -211,10 +189,7 @@ public:
   void
   write_16bpp(const u16 rgb_)
   {
-    if(_coded)
-      write_coded_16bpp(rgb_);
-    else
-      write_uncoded_16bpp(rgb_);
+    write_uncoded_16bpp(rgb_);
   }
 
   void
@@ -230,8 +205,9 @@ public:
     write_0555(b);
   }
 
-  void
-  write_332(const u8 rgb_)
+  static
+  RGBA8888
+  rgba_332(const u8 rgb_)
   {
     u8 r,g,b;
 
@@ -242,11 +218,12 @@ public:
     b = ((rgb_ >> 0) & 0x3);
     b = scale_u2_to_u8(b);
 
-    write_rgb(r,g,b);
+    return RGBA8888(r,g,b,0xFF);
   }
 
-  void
-  write_rep8_332(const u8 rgb_)
+  static
+  RGBA8888
+  rgba_rep8_332(const u8 rgb_)
   {
     u8 r,g,b;
 
@@ -263,64 +240,37 @@ public:
     b |= ((b & 0x80) >> 4);
     b |= ((b & 0x40) >> 2);
 
-    write_rgb(r,g,b);
-  }
-
-  void
-  write_uncoded_8bpp(u8 rgb_)
-  {
-    if(_rep8)
-      write_rep8_332(rgb_);
-    else
-      write_332(rgb_);
-  }
-
-  void
-  write_8bpp(u32 p_)
-  {
-    if(_coded)
-      abort();
-    else
-      write_uncoded_8bpp(p_);
+    return RGBA8888(r,g,b,0xFF);
   }
 
   void
-  write_6bpp(u32 p_)
+  write_332(const u8 rgb_)
   {
-    u16 p;
-
-    p = _plut.at(p_ & 0x1F);
+    const RGBA8888 c = rgba_332(rgb_);
 
-    write_uncoded_16bpp(p);
+    write_rgba(c.r,c.g,c.b,c.a);
   }
 
   void
-  write_4bpp(u32 p_)
+  write_rep8_332(const u8 rgb_)
   {
-    u16 p;
-
-    p = _plut.at((p_ & 0x0F) | (_pluta & 0x10));
+    const RGBA8888 c = rgba_rep8_332(rgb_);
 
-    write_uncoded_16bpp(p);
+    write_rgba(c.r,c.g,c.b,c.a);
   }
 
   void
-  write_2bpp(u32 p_)
+  write_uncoded_8bpp(u8 rgb_)
   {
-    u16 p;
-
-    p = _plut.at((p_ & 0x03) | (_pluta & 0x1C));
-
-    write_uncoded_16bpp(p);
+    if(_rep8)
+      write_rep8_332(rgb_);
+    else
+      write_332(rgb_);
   }
 
   void
-  write_1bpp(u32 p_)
+  write_8bpp(u32 p_)
   {
-    u16 p;
-
-    p = _plut.at((p_ & 0x01) | (_pluta & 0x1E));
-
-    write_uncoded_16bpp(p);
+    write_uncoded_8bpp(p_);
   }
 };
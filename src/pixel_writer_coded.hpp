@@ -0,0 +1,91 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "coded_lut.hpp"
+#include "pixel_writer_rgba8888.hpp"
+#include "plut.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+
+// Writes coded pixels of a fixed bpp through a CodedLUT so each pixel
+// is a mask and a table load.
+template<u8 BPP>
+class PixelWriterCoded : public PixelWriterRGBA8888
+{
+private:
+  RGBA8888 *_data;
+  std::shared_ptr<const CodedLUT> _lut;
+
+public:
+  void
+  init(Bitmap     &b_,
+       const PLUT &plut_,
+       const u8    pluta_,
+       const u32   pdv_)
+  {
+    PixelWriterRGBA8888::init(b_);
+    _data = &b_.idx(0);
+    _lut  = CodedLUT::get(plut_,BPP,pluta_,pdv_);
+  }
+
+public:
+  void
+  write(const u32 p_)
+  {
+    _data[_idx++] = _lut->lookup(p_);
+  }
+
+  void
+  write_transparent(const u32 count_)
+  {
+    zero(count_);
+  }
+
+  // count_ copies of pixel p_.
+  void
+  fill(const u32 p_,
+       const u32 count_)
+  {
+    std::fill_n(&_data[_idx],count_,_lut->lookup(p_));
+    _idx += count_;
+  }
+
+  // count_ transparent pixels.
+  void
+  zero(const u32 count_)
+  {
+    memset((void*)&_data[_idx],0,(count_ * sizeof(RGBA8888)));
+    _idx += count_;
+  }
+
+  void
+  literal(const u32 *p_,
+          const u32  count_)
+  {
+    const CodedLUT &lut = *_lut;
+
+    for(u32 i = 0; i < count_; i++)
+      _data[_idx + i] = lut.lookup(p_[i]);
+    _idx += count_;
+  }
+};
@@ -24,6 +24,7 @@
 #include "pixel_converter.hpp"
 #include "color_distance.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include <stdint.h>
@@ -70,11 +71,13 @@ PLUT::operator=(const Chunk &chunk_)
   for(uint32_t i = 0; i < count; i++)
     push_back(br.u16be());
 
+  reindex();
+
   return *this;
 }
 
 static
-int
+u64
 closest(const PLUT     &plut_,
         const uint16_t  color_)
 {
@@ -100,7 +103,7 @@ closest(const PLUT     &plut_,
       closest_idx = i;
     }
 
-  return plut_[closest_idx];
+  return closest_idx;
 }
 
 int
@@ -108,10 +111,35 @@ PLUT::lookup(const uint16_t  color_,
              bool const      allow_closest_,
              bool           *closest_) const
 {
-  for(uint64_t i = 0; i < size(); i++)
+  u64 i;
+  bool cache;
+
+  i     = NO_INDEX;
+  cache = false;
+  if(_index && !(color_ & 0x8000))
     {
-      if(operator[](i) == color_)
+      i = _index->table[color_].load(std::memory_order_relaxed);
+      if((i < size()) && (operator[](i) == color_))
         return i;
+
+      cache = (_index->colors == *this);
+    }
+
+  if(cache && (i != NO_INDEX))
+    {
+      i &= ~CLOSEST;
+    }
+  else
+    {
+      for(i = 0; i < size(); i++)
+        {
+          if(operator[](i) == color_)
+            return i;
+        }
+
+      i = ::closest(*this,color_);
+      if(cache)
+        _index->table[color_].store(CLOSEST | i,std::memory_order_relaxed);
     }
 
   if(allow_closest_ == false)
@@ -126,12 +154,20 @@ PLUT::lookup(const uint16_t  color_,
   if(closest_ != nullptr)
     *closest_ = true;
 
-  return ::closest(*this,color_);
+  return operator[](i);
 }
 
 bool
 PLUT::has_color(std::uint16_t const c_) const
 {
+  if(_index && !(c_ & 0x8000))
+    {
+      u64 i = _index->table[c_].load(std::memory_order_relaxed);
+
+      if((i < size()) && (operator[](i) == c_))
+        return true;
+    }
+
   for(const auto c : *this)
     {
       if(c == c_)
@@ -141,12 +177,31 @@ PLUT::has_color(std::uint16_t const c_) const
   return false;
 }
 
+void
+PLUT::reindex()
+{
+  std::shared_ptr<Index> index;
+
+  index = std::make_shared<Index>();
+  for(uint64_t i = std::min<uint64_t>(size(),CLOSEST); i-- > 0;)
+    {
+      if(operator[](i) & 0x8000)
+        continue;
+      index->table[operator[](i)].store(i,std::memory_order_relaxed);
+    }
+  index->colors = *this;
+
+  _index = index;
+}
+
 void
 PLUT::build(const Bitmap &bitmap_)
 {
   uint16_t color;
+  std::shared_ptr<Index> index;
 
   clear();
+  index = std::make_shared<Index>();
   for(uint64_t y = 0; y < bitmap_.h; y++)
     {
       for(uint64_t x = 0; x < bitmap_.w; x++)
@@ -158,9 +213,10 @@ PLUT::build(const Bitmap &bitmap_)
 
           color = RGBA8888Converter::to_rgb0555(p);
 
-          if(has_color(color))
+          if(index->table[color].load(std::memory_order_relaxed) != NO_INDEX)
             continue;
 
+          index->table[color].store(size(),std::memory_order_relaxed);
           push_back(color);
 
           if(size() > max_size())
@@ -172,5 +228,11 @@ PLUT::build(const Bitmap &bitmap_)
   // which case add black (the 'transparent' value if NOBLK flag is
   // set to 1).
   if(empty())
-    push_back(0);
+    {
+      index->table[0].store(0,std::memory_order_relaxed);
+      push_back(0);
+    }
+
+  index->colors = *this;
+  _index = index;
 }
@@ -3,7 +3,10 @@
 #include "bitmap.hpp"
 #include "chunk.hpp"
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 
@@ -24,4 +27,33 @@ public:
 
 public:
   void build(Bitmap const &bitmap);
+
+private:
+  void reindex();
+
+private:
+  // RGB0555 color to what lookup() returns for it, shared so copying
+  // a PLUT stays cheap. build() and loading from a chunk set up the
+  // colors in the PLUT; those which aren't get the closest entry
+  // recorded the first time they're looked up so encoding against a
+  // fixed palette is a single index per pixel. Exact entries are
+  // checked against the PLUT before use and closest ones only used
+  // while it still holds the colors the index was built for so one
+  // edited directly falls back to scanning.
+  struct Index
+  {
+    Index()
+    {
+      for(auto &i : table)
+        i.store(NO_INDEX,std::memory_order_relaxed);
+    }
+
+    std::vector<uint16_t>                    colors;
+    std::array<std::atomic<uint16_t>,0x8000> table;
+  };
+
+  static constexpr uint16_t NO_INDEX = 0xFFFF;
+  static constexpr uint16_t CLOSEST  = 0x8000;
+
+  std::shared_ptr<Index> _index;
 };
@@ -18,9 +18,10 @@
 
 #include "read_file.hpp"
 
+#include "mapped_file.hpp"
+
 #include <cstdint>
 #include <exception>
-#include <fstream>
 #include <iterator>
 
 namespace fs = std::filesystem;
@@ -30,23 +31,20 @@ void
 ReadFile::read(std::istream &is_,
                ByteVec      &data_)
 {
-  is_.unsetf(std::ios::skipws);
   data_.insert(data_.begin(),
-               std::istream_iterator<uint8_t>(is_),
-               std::istream_iterator<uint8_t>());
+               std::istreambuf_iterator<char>(is_),
+               std::istreambuf_iterator<char>());
 }
 
 void
 ReadFile::read(const fs::path &filepath_,
                ByteVec        &data_)
 {
-  std::ifstream is;
-
-  is.open(filepath_,std::ios::binary|std::ios::in);
-  if(!is)
-    throw std::system_error(errno,std::system_category(),"failed to open "+filepath_.string());
+  MappedFile file;
 
-  ReadFile::read(is,data_);
+  file.open(filepath_);
 
-  is.close();
+  data_.insert(data_.begin(),
+               file.begin(),
+               file.end());
 }
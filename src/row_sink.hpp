@@ -0,0 +1,42 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#pragma once
+
+#include "rgba8888.hpp"
+
+#include <functional>
+
+
+/*
+  Pixels handed over a row at a time, top to bottom, from a decoder
+  to an encoder so that neither has to hold the whole image. Each row
+  is the image's width of pixels and is only valid for the duration
+  of the call.
+*/
+class RowSink
+{
+public:
+  virtual ~RowSink() = default;
+
+public:
+  virtual void row(const RGBA8888 *pixels) = 0;
+};
+
+// Feeds every row of an image, in order, to the sink. May be run
+// more than once.
+typedef std::function<void(RowSink&)> RowSource;
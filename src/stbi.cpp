@@ -61,6 +61,7 @@ stbi_delete(void *p_)
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "output_files.hpp"
 #include "stbi.hpp"
 #include "stb_image_write.h"
 
@@ -105,71 +106,87 @@ stbi_write(const Bitmap      &b_,
            const fs::path    &filepath_,
            const std::string  format_)
 {
+  int rv;
   std::string filepath;
 
   filepath = filepath_.string();
 
   if(format_ == "bmp")
-    return stbi_write_bmp(filepath.c_str(),b_.w,b_.h,4,b_.d.get());
-  if(format_ == "png")
-    return stbi_write_png(filepath.c_str(),b_.w,b_.h,4,b_.d.get(),(b_.w * 4));
-  if(format_ == "jpg")
-    return stbi_write_jpg(filepath.c_str(),b_.w,b_.h,4,b_.d.get(),100);
-
-  throw std::runtime_error("unknown stb_image format");
+    rv = stbi_write_bmp(filepath.c_str(),b_.w,b_.h,4,b_.d.get());
+  else if(format_ == "png")
+    rv = stbi_write_png(filepath.c_str(),b_.w,b_.h,4,b_.d.get(),(b_.w * 4));
+  else if(format_ == "jpg")
+    rv = stbi_write_jpg(filepath.c_str(),b_.w,b_.h,4,b_.d.get(),100);
+  else
+    throw std::runtime_error("unknown stb_image format");
+
+  if(rv)
+    OutputFiles::add(filepath_);
+
+  return rv;
 }
 
 uint32_t
 stbi_identify(cPDAT data_)
 {
   int x,y,comp;
+
+  return stbi_identify(data_,&x,&y,&comp);
+}
+
+uint32_t
+stbi_identify(cPDAT  data_,
+              int   *x,
+              int   *y,
+              int   *comp)
+{
   stbi__context s;
   const uint8_t *buf     = data_.data();
   const size_t   buf_len = data_.size();
 
   stbi__start_mem(&s,buf,buf_len);
 #ifndef STBI_NO_JPEG
-  if(stbi__jpeg_info(&s,&x,&y,&comp))
+  if(stbi__jpeg_info(&s,x,y,comp))
     return STBI_FILE_TYPE_JPG;
 #endif
 
 #ifndef STBI_NO_PNG
-  if(stbi__png_info(&s,&x,&y,&comp))
+  if(stbi__png_info(&s,x,y,comp))
     return STBI_FILE_TYPE_PNG;
 #endif
 
 #ifndef STBI_NO_GIF
-  if(stbi__gif_info(&s,&x,&y,&comp))
+  if(stbi__gif_info(&s,x,y,comp))
     return STBI_FILE_TYPE_GIF;
 #endif
 
 #ifndef STBI_NO_BMP
-  if(stbi__bmp_info(&s,&x,&y,&comp))
+  if(stbi__bmp_info(&s,x,y,comp))
     return STBI_FILE_TYPE_BMP;
 #endif
 
 #ifndef STBI_NO_PSD
-  if(stbi__psd_info(&s,&x,&y,&comp))
+  if(stbi__psd_info(&s,x,y,comp))
     return STBI_FILE_TYPE_PSD;
 #endif
 
 #ifndef STBI_NO_PIC
-  if(stbi__pic_info(&s,&x,&y,&comp))
+  if(stbi__pic_info(&s,x,y,comp))
     return STBI_FILE_TYPE_PIC;
 #endif
 
 #ifndef STBI_NO_PNM
-  if(stbi__pnm_info(&s,&x,&y,&comp))
+  if(stbi__pnm_info(&s,x,y,comp))
     return STBI_FILE_TYPE_PNM;
 #endif
 
 #ifndef STBI_NO_HDR
-  if(stbi__hdr_info(&s,&x,&y,&comp))
+  if(stbi__hdr_info(&s,x,y,comp))
     return STBI_FILE_TYPE_HDR;
 #endif
 
 #ifndef STBI_NO_TGA
-  if (stbi__tga_info(&s,&x,&y,&comp))
+  if (stbi__tga_info(&s,x,y,comp))
     return STBI_FILE_TYPE_TGA;
 #endif
 
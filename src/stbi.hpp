@@ -29,3 +29,7 @@ int      stbi_write(const Bitmap                &bitmap,
                     const std::filesystem::path &filepath,
                     const std::string            format);
 uint32_t stbi_identify(cPDAT data);
+uint32_t stbi_identify(cPDAT  data,
+                       int   *x,
+                       int   *y,
+                       int   *comp);
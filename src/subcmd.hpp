@@ -20,18 +20,42 @@
 
 #include "options.hpp"
 
+#include <functional>
+#include <string>
+#include <vector>
+
 namespace SubCmd
 {
+  typedef std::vector<std::string> ArgVec;
+
+  // Parses and runs a 3it command line in-process, as main() would,
+  // with Options::Batch defaults taken from the caller. Output is
+  // returned rather than written to stdout/stderr.
+  typedef std::function<int(const ArgVec         &args,
+                            const Options::Batch &batch,
+                            std::string          &out,
+                            std::string          &err)> Runner;
+
   void version();
   void docs();
   void info(const Options::Info &opts);
   void list_chunks(const Options::ListChunks &opts);
+  void list_files(const Options::ListFiles &opts);
   void dump_packed_instructions(const Options::DumpPacked &opts);
   void to_cel(const Options::ToCEL &opts);
+  void manifest(const Options::Manifest &opts);
+  void estimate(const Options::Estimate &opts);
   void to_banner(const Options::ToBanner &opts);
   void to_imag(const Options::ToIMAG &opts);
   void to_lrform(const Options::ToLRFORM &opts);
   void to_stb_image(const Options::ToImage &opts,
                     const std::string      &type);
   void to_nfs_shpm(const Options::ToNFSSHPM &opts);
+  void serve(const Options::Serve &opts,
+             const Runner         &runner);
+  void client(const Options::Client &opts,
+              const ArgVec          &args);
+  void watch(const Options::Watch &opts,
+             const ArgVec         &args,
+             const Runner         &runner);
 }
@@ -0,0 +1,83 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "subcmd.hpp"
+
+#include "json.hpp"
+#include "options.hpp"
+#include "unix_socket.hpp"
+
+#include "CLI11.hpp"
+#include "fmt.hpp"
+
+#include <filesystem>
+
+#include <cstdio>
+
+namespace fs = std::filesystem;
+
+
+namespace SubCmd
+{
+  void
+  client(const Options::Client &opts_,
+         const ArgVec          &args_)
+  {
+    int status;
+    std::string out;
+    std::string err;
+    std::string line;
+    UnixSocket socket;
+    JSON::Value job = JSON::Value::object();
+    JSON::Value reply;
+    JSON::Value::Array args;
+
+    for(const auto &arg : args_)
+      args.emplace_back(arg);
+
+    job["cwd"]  = fs::current_path().string();
+    job["args"] = args;
+
+    // Not reaching the daemon, or losing it mid-job, means no output
+    // was produced so it must fail the command like any other error
+    // rather than be printed and forgotten.
+    try
+      {
+        socket.connect(opts_.socket);
+        socket.write_line(job.dump());
+        if(!socket.read_line(line))
+          throw std::runtime_error("daemon closed the connection");
+
+        reply  = JSON::parse(line);
+        status = reply["status"].as_int();
+        out    = reply["stdout"].as_string();
+        err    = reply["stderr"].as_string();
+      }
+    catch(const std::exception &e_)
+      {
+        fmt::print(stderr,"{}\n",e_.what());
+        throw CLI::RuntimeError(1);
+      }
+
+    std::fwrite(out.data(),1,out.size(),stdout);
+    std::fwrite(err.data(),1,err.size(),stderr);
+
+    if(status)
+      throw CLI::RuntimeError(status);
+  }
+}
@@ -17,6 +17,7 @@
 */
 
 #include "fmt.hpp"
+#include "log.hpp"
 
 
 namespace SubCmd
@@ -24,7 +25,7 @@ namespace SubCmd
   void
   docs()
   {
-    fmt::print("https://3dodev.com\n"
+    Log::print("https://3dodev.com\n"
                "https://3dodev.com/documentation/file_formats\n"
                "https://3dodev.com/documentation/development/opera/pf25/ppgfldr/ggsfldr/gpgfldr/3gpg\n"
                "https://3dodev.com/documentation/development/opera/pf25/ppgfldr/ggsfldr/gpgfldr/5gpg\n"
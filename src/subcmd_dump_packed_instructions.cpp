@@ -23,9 +23,10 @@
 #include "chunk_reader.hpp"
 #include "fmt.hpp"
 #include "identify_file.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
 #include "options.hpp"
 #include "packed.hpp"
-#include "read_file.hpp"
 
 #include <filesystem>
 
@@ -66,6 +67,7 @@ namespace l
     u32 width;
     u32 line_size;
     u32 start_offset;
+    u32 pixels[1 << DATA_PACKET_PIXEL_COUNT_SIZE];
 
     pixels_read = 0;
     bpp = ccc_.bpp();
@@ -88,13 +90,11 @@ namespace l
               size += (count * bpp);
               line_size += size;
 
-              fmt::print("literal: count={}; size={}; colors=",count,size);
+              Log::print("literal: count={}; size={}; colors=",count,size);
+              bs_.read_n(bpp,pixels,count);
               for(size_t i = 0; i < count; i++)
-                {
-                  pixel = bs_.read(bpp);
-                  fmt::print("{:x},",pixel);
-                }
-              fmt::print("\n");
+                Log::print("{:x},",pixels[i]);
+              Log::print("\n");
             }
             break;
           case PACK_TRANSPARENT:
@@ -103,7 +103,7 @@ namespace l
               pixels_read += count;
               size += DATA_PACKET_PIXEL_COUNT_SIZE;
               line_size += size;
-              fmt::println("transparent: count={}; size={};",count,size);
+              Log::print("transparent: count={}; size={};\n",count,size);
             }
             break;
           case PACK_PACKED:
@@ -114,22 +114,22 @@ namespace l
               size += DATA_PACKET_PIXEL_COUNT_SIZE;
               size += bpp;
               line_size += size;
-              fmt::println("packed: count={}; color={}; size={};",count,pixel,size);
+              Log::print("packed: count={}; color={}; size={};\n",count,pixel,size);
             }
             break;
           case PACK_EOL:
             line_size += size;
-            fmt::println("eol: size={};",
+            Log::print("eol: size={};\n",
                        DATA_PACKET_DATA_TYPE_SIZE);
             break;
           }
       } while(type != PACK_EOL && pixels_read < width);
 
-    fmt::println("end: row={}; pixels={}; line_size={}; leftover={};\n",
-                 row_,
-                 pixels_read,
-                 line_size,
-                 bs_.bits_to_32bit_boundary());
+    Log::print("end: row={}; pixels={}; line_size={}; leftover={};\n\n",
+               row_,
+               pixels_read,
+               line_size,
+               bs_.bits_to_32bit_boundary());
   }
 
   void
@@ -138,16 +138,16 @@ namespace l
     u32 type;
     u32 offset;
     u32 row_offset;
-    ByteVec data;
+    MappedFile data;
     ChunkVec chunks;
     CelControlChunk ccc;
 
-    ReadFile::read(filepath_,data);
+    data.open(filepath_);
 
     type = IdentifyFile::identify(data);
     if(!IdentifyFile::chunked_type(type))
       {
-        fmt::print("ERROR - not a recognized 3DO chunked file: {}\n",filepath_);
+        Log::print("ERROR - not a recognized 3DO chunked file: {}\n",filepath_);
         return;
       }
 
@@ -179,23 +179,23 @@ namespace l
             bs.seek(offset * BITS_PER_BYTE);
             row_offset = bs.read(offset_width) + 2;
             next_offset = offset + (row_offset * BYTES_PER_WORD);
-            fmt::println("start: row={}; data_range=[{},{}); bpp={};",
-                         row,
-                         offset,
-                         next_offset,
-                         ccc.bpp());
+            Log::print("start: row={}; data_range=[{},{}); bpp={};\n",
+                       row,
+                       offset,
+                       next_offset,
+                       ccc.bpp());
 
 
-            fmt::print("data: ");
+            Log::print("data: ");
             bs.seek(offset * BITS_PER_BYTE);
             for(u64 i = offset; i < next_offset; i+=4)
               {
                 u32 x = bs.read(BITS_PER_BYTE * 4);
-                fmt::print("{:08X} ",x);
+                Log::print("{:08X} ",x);
               }
-            fmt::println("\noffset: len={}+2; size={};",
-                         row_offset-2,
-                         offset_width);
+            Log::print("\noffset: len={}+2; size={};\n",
+                       row_offset-2,
+                       offset_width);
 
             bs.seek((offset * BITS_PER_BYTE) + offset_width);
             unpack_row(row,bs,ccc);
@@ -0,0 +1,307 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "subcmd.hpp"
+
+#include "batch.hpp"
+#include "bitmap.hpp"
+#include "cel_search.hpp"
+#include "convert.hpp"
+#include "frame.hpp"
+#include "json.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
+#include "options.hpp"
+
+#include "fmt.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  // Errors of every type with --verify, as a percentage of the
+  // actual CEL file's size.
+  struct Accuracy
+  {
+    uint64_t images   = 0;
+    uint64_t types    = 0;
+    uint64_t matches  = 0;
+    double   sum_pct  = 0;
+    double   max_pct  = 0;
+  };
+
+  static
+  std::string
+  type_str(const CelType &celtype_)
+  {
+    return fmt::format("{}_{}_{}bpp",
+                       (celtype_.coded ? "coded" : "uncoded"),
+                       (celtype_.packed ? "packed" : "unpacked"),
+                       celtype_.bpp);
+  }
+
+  static
+  JSON::Value
+  sizes_json(const CelSearch::Sizes &sizes_)
+  {
+    JSON::Value rv;
+
+    rv = JSON::Value::object();
+    rv["ccb"]   = sizes_.ccb;
+    rv["pdat"]  = sizes_.pdat;
+    rv["plut"]  = sizes_.plut;
+    rv["total"] = sizes_.total();
+
+    return rv;
+  }
+
+  // First of sizes_ with the smallest total.
+  static
+  std::string
+  smallest(const CelSearch::SizesVec &sizes_)
+  {
+    const CelSearch::Sizes *best;
+
+    best = nullptr;
+    for(const auto &sizes : sizes_)
+      {
+        if(!best || (sizes.total() < best->total()))
+          best = &sizes;
+      }
+
+    return (best ? l::type_str(best->celtype) : "");
+  }
+
+  static
+  void
+  prepare_bitmap(const Options::Estimate &opts_,
+                 Bitmap                  &bitmap_)
+  {
+    if(!opts_.external_palette.empty())
+      bitmap_.set("external-palette",opts_.external_palette.string());
+    if(opts_.pack_optimal)
+      bitmap_.set("pack-optimal","true");
+
+    bitmap_.replace_color(opts_.transparent,0x00000000);
+  }
+
+  static
+  JSON::Value
+  estimate(const Options::Estimate &opts_,
+           Bitmap                  &bitmap_,
+           Accuracy                &accuracy_)
+  {
+    JSON::Value rv;
+    JSON::Value types;
+    CelSearch::SizesVec actuals;
+    CelSearch::SizesVec estimates;
+    CelSearch::ResultVec results;
+
+    l::prepare_bitmap(opts_,bitmap_);
+
+    CelSearch::estimate(bitmap_,estimates);
+    if(opts_.verify)
+      CelSearch::all(bitmap_,results);
+
+    types = JSON::Value(JSON::Value::Array());
+    for(size_t i = 0, j = 0; i < estimates.size(); i++)
+      {
+        JSON::Value type;
+        const CelSearch::Sizes &estimate = estimates[i];
+
+        type = JSON::Value::object();
+        type["type"]     = l::type_str(estimate.celtype);
+        type["bpp"]      = estimate.celtype.bpp;
+        type["coded"]    = (bool)estimate.celtype.coded;
+        type["packed"]   = (bool)estimate.celtype.packed;
+        type["estimate"] = l::sizes_json(estimate);
+
+        // all() skips types it failed to encode
+        if((j < results.size()) &&
+           (results[j].celtype.bpp    == estimate.celtype.bpp) &&
+           (results[j].celtype.coded  == estimate.celtype.coded) &&
+           (results[j].celtype.packed == estimate.celtype.packed))
+          {
+            double pct;
+            const CelSearch::Sizes actual = CelSearch::sizes(results[j++]);
+
+            pct = ((100.0 * std::abs((double)estimate.total() - (double)actual.total())) /
+                   (double)actual.total());
+
+            type["actual"] = l::sizes_json(actual);
+            type["error"]  = ((int64_t)estimate.total() - (int64_t)actual.total());
+            accuracy_.types++;
+            accuracy_.sum_pct += pct;
+            accuracy_.max_pct  = std::max(accuracy_.max_pct,pct);
+            actuals.emplace_back(actual);
+          }
+
+        types.push_back(type);
+      }
+
+    rv = JSON::Value::object();
+    rv["w"]      = bitmap_.w;
+    rv["h"]      = bitmap_.h;
+    rv["colors"] = bitmap_.color_count();
+    rv["types"]  = types;
+    rv["smallest"] = JSON::Value::object();
+    rv["smallest"]["estimate"] = l::smallest(estimates);
+    if(opts_.verify)
+      {
+        rv["smallest"]["actual"] = l::smallest(actuals);
+        accuracy_.images++;
+        if(l::smallest(actuals) == l::smallest(estimates))
+          accuracy_.matches++;
+      }
+
+    return rv;
+  }
+
+  static
+  JSON::Value
+  failure(const fs::path &filepath_,
+          const char     *what_)
+  {
+    JSON::Value rv;
+
+    rv = JSON::Value::object();
+    rv["filepath"] = filepath_.string();
+    rv["error"]    = what_;
+
+    return rv;
+  }
+
+  // One entry per selected image of the file or one describing why
+  // it couldn't be read.
+  static
+  void
+  estimate(const fs::path           &filepath_,
+           const Options::Estimate  &opts_,
+           JSON::Value::Array       &images_,
+           Accuracy                 &accuracy_)
+  {
+    FrameVec frames;
+    MappedFile file;
+
+    try
+      {
+        file.open(filepath_);
+        if(file.empty())
+          throw fmt::exception("file empty");
+
+        convert::to_frames(file,frames);
+        if(frames.empty())
+          throw fmt::exception("failed to convert");
+      }
+    catch(const std::runtime_error &e_)
+      {
+        images_.emplace_back(l::failure(filepath_,e_.what()));
+        return;
+      }
+
+    for(const size_t i : convert::select_frames(frames,opts_.select.filter()))
+      {
+        Bitmap bitmap;
+        JSON::Value image;
+        JSON::Value sizes;
+
+        try
+          {
+            convert::frame_to_bitmap(frames,i,bitmap);
+            if(!bitmap)
+              continue;
+
+            sizes = l::estimate(opts_,bitmap,accuracy_);
+          }
+        catch(const std::runtime_error &e_)
+          {
+            images_.emplace_back(l::failure(filepath_,e_.what()));
+            images_.back()["index"] = frames[i].number;
+            continue;
+          }
+
+        image = JSON::Value::object();
+        image["filepath"] = filepath_.string();
+        image["index"]    = frames[i].number;
+        for(const auto &member : sizes.as_object())
+          image[member.first] = member.second;
+        images_.emplace_back(image);
+      }
+  }
+}
+
+namespace SubCmd
+{
+  // Anything the decoders would print is kept off stdout, which is
+  // only the JSON, and attached to the file's entries instead.
+  void
+  estimate(const Options::Estimate &opts_)
+  {
+    JSON::Value rv;
+    JSON::Value images;
+    l::Accuracy accuracy;
+    Options::PathVec filepaths;
+
+    filepaths = Batch::get_filepaths(opts_.filepaths);
+
+    images = JSON::Value(JSON::Value::Array());
+    for(const auto &filepath : filepaths)
+      {
+        std::string log;
+        JSON::Value::Array entries;
+
+        {
+          Log::Capture capture(log);
+
+          l::estimate(filepath,opts_,entries,accuracy);
+        }
+
+        for(auto &entry : entries)
+          {
+            if(!log.empty())
+              entry["log"] = log;
+            images.push_back(entry);
+          }
+      }
+
+    rv = JSON::Value::object();
+    rv["images"] = images;
+    if(opts_.verify)
+      {
+        JSON::Value summary;
+
+        summary = JSON::Value::object();
+        summary["types"]    = accuracy.types;
+        summary["mean_pct"] = (accuracy.types ? (accuracy.sum_pct / accuracy.types) : 0.0);
+        summary["max_pct"]  = accuracy.max_pct;
+        summary["smallest_matches"] = accuracy.matches;
+        summary["images"]   = accuracy.images;
+        rv["accuracy"] = summary;
+      }
+
+    Log::print("{}\n",rv.dump());
+  }
+}
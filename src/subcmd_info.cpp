@@ -24,10 +24,11 @@
 #include "chunk_reader.hpp"
 #include "fmt.hpp"
 #include "identify_file.hpp"
+#include "log.hpp"
 #include "image_control_chunk.hpp"
+#include "mapped_file.hpp"
 #include "options.hpp"
 #include "plut.hpp"
-#include "read_file.hpp"
 #include "video_image.hpp"
 
 #include <filesystem>
@@ -46,7 +47,7 @@ namespace l
 
     vi = (VideoImage*)data_.data();
 
-    fmt::print("  - version: {}\n"
+    Log::print("  - version: {}\n"
                "  - pattern: {:.7}\n"
                "  - size: {}\n"
                "  - height: {}\n"
@@ -78,7 +79,7 @@ namespace l
           {
           case CHUNK_CCB:
             ccc = chunk;
-            fmt::print(" - id: {}\n"
+            Log::print(" - id: {}\n"
                        "  - flags: 0x{:08X}\n"
                        "    - skip: {}\n"
                        "    - last: {}\n"
@@ -224,13 +225,13 @@ namespace l
 
             plut = chunk;
 
-            fmt::print(" - id: {}\n"
+            Log::print(" - id: {}\n"
                        "  - plut:\n",
                        chunk.idstr());
             for(std::size_t i = 0; i < plut.size(); i++)
               {
                 const uint8_t *c = (const uint8_t*)&plut[i];
-                fmt::print("   - {:02x}: {:02x}{:02x}\n"
+                Log::print("   - {:02x}: {:02x}{:02x}\n"
                            ,
                            i,
                            c[0],
@@ -258,7 +259,7 @@ namespace l
           }
       }
 
-    fmt::print("  - id: {}\n"
+    Log::print("  - id: {}\n"
                "  - w: {}\n"
                "  - h: {}\n"
                "  - bytesperrow: {}\n"
@@ -294,12 +295,12 @@ namespace l
   void
   info(const fs::path &filepath_)
   {
-    uint32_t type;
-    ByteVec  data;
+    uint32_t   type;
+    MappedFile data;
 
-    fmt::print("{}:\n",filepath_);
+    Log::print("{}:\n",filepath_);
 
-    ReadFile::read(filepath_,data);
+    data.open(filepath_);
 
     type = IdentifyFile::identify(data);
     switch(type)
@@ -320,21 +321,49 @@ namespace l
       case FILE_ID_PNG:
       case FILE_ID_JPG:
       case FILE_ID_GIF:
-        fmt::print(" - not yet implemented\n");
+        Log::print(" - not yet implemented\n");
         break;
       default:
-        fmt::print(" - unknown file type\n");
+        Log::print(" - unknown file type\n");
         break;
       }
   }
 }
 
+namespace l
+{
+  static
+  void
+  info_brief(const fs::path &filepath_)
+  {
+    std::string s;
+    IdentifyFile::Info info;
+
+    info = IdentifyFile::probe(filepath_);
+
+    s = fmt::format("{}: {}",filepath_,IdentifyFile::type_str(info.type));
+    if(info.w && info.h)
+      s += fmt::format(" {}x{}",info.w,info.h);
+    if(info.bpp)
+      s += fmt::format(" {}bpp",info.bpp);
+    if(info.count)
+      s += fmt::format(" {} image{}",info.count,((info.count == 1) ? "" : "s"));
+
+    Log::print("{}\n",s);
+  }
+}
+
 namespace SubCmd
 {
   void
   info(const Options::Info &opts_)
   {
     for(const auto &filepath : opts_.filepaths)
-      l::info(filepath);
+      {
+        if(opts_.brief)
+          l::info_brief(filepath);
+        else
+          l::info(filepath);
+      }
   }
 }
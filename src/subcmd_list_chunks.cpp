@@ -19,8 +19,9 @@
 #include "chunk_reader.hpp"
 #include "fmt.hpp"
 #include "identify_file.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
 #include "options.hpp"
-#include "read_file.hpp"
 
 #include <filesystem>
 
@@ -32,19 +33,19 @@ namespace l
   void
   list_chunks(const fs::path &filepath_)
   {
-    uint32_t type;
-    uint32_t offset;
-    ByteVec  data;
-    ChunkVec chunks;
+    uint32_t   type;
+    uint32_t   offset;
+    MappedFile data;
+    ChunkVec   chunks;
 
-    fmt::print("{}:\n",filepath_);
+    Log::print("{}:\n",filepath_);
 
-    ReadFile::read(filepath_,data);
+    data.open(filepath_);
 
     type = IdentifyFile::identify(data);
     if(!IdentifyFile::chunked_type(type))
       {
-        fmt::print("ERROR - not a recognized 3DO chunked file: {}\n",filepath_);
+        Log::print("ERROR - not a recognized 3DO chunked file: {}\n",filepath_);
         return;
       }
 
@@ -54,7 +55,7 @@ namespace l
     for(uint32_t i = 0; i < chunks.size(); i++)
       {
         const auto &chunk = chunks[i];
-        fmt::print(" - chunk:\n"
+        Log::print(" - chunk:\n"
                    "   - num: {}\n"
                    "   - id: {}\n"
                    "   - size: {}\n"
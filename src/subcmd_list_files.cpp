@@ -0,0 +1,86 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "subcmd.hpp"
+
+#include "log.hpp"
+#include "opera_fs.hpp"
+#include "options.hpp"
+
+#include "fmt.hpp"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+
+namespace l
+{
+  static
+  void
+  list_files(const fs::path &filepath_)
+  {
+    fs::path image;
+    std::string inner;
+    std::string prefix;
+    std::shared_ptr<const OperaFS> opera;
+
+    Log::print("{}:\n",filepath_);
+
+    if(!OperaFS::split(filepath_,image,inner))
+      image = filepath_;
+
+    opera = OperaFS::get(image);
+    if(!inner.empty())
+      {
+        const OperaFS::Entry *entry;
+
+        entry = opera->find(inner);
+        if(!entry)
+          throw fmt::exception("'{}' not found in '{}'",inner,image);
+        if(!entry->directory)
+          {
+            Log::print(" - {} ({} bytes)\n",OperaFS::join(image,entry->path),entry->size);
+            return;
+          }
+        prefix = entry->path;
+      }
+
+    prefix += '/';
+    for(const auto &entry : opera->entries())
+      {
+        if(entry.path.compare(0,prefix.size(),prefix) != 0)
+          continue;
+
+        if(entry.directory)
+          Log::print(" - {}/\n",OperaFS::join(image,entry.path));
+        else
+          Log::print(" - {} ({} bytes)\n",OperaFS::join(image,entry.path),entry.size);
+      }
+  }
+}
+
+namespace SubCmd
+{
+  void
+  list_files(const Options::ListFiles &opts_)
+  {
+    for(const auto &filepath : opts_.filepaths)
+      l::list_files(filepath);
+  }
+}
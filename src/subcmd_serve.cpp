@@ -0,0 +1,275 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "subcmd.hpp"
+
+#include "json.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
+#include "options.hpp"
+#include "unix_socket.hpp"
+
+#include "fmt.hpp"
+
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include <csignal>
+
+namespace fs = std::filesystem;
+
+
+/*
+  Each connection carries newline-delimited JSON jobs and receives one
+  JSON line back per job:
+
+    {"cwd":"/src/art","args":["to-cel","--bpp","8","hero.png"]}
+    {"cwd":"/src/art","command":"to-cel","bpp":8,"filepaths":["hero.png"]}
+
+    {"status":0,"stdout":"hero.png:\n - hero.png.cel\n","stderr":""}
+
+  The second form mirrors the Options structs: every member other
+  than command, cwd and filepaths becomes a --long-option (underscores
+  read as dashes), arrays repeat the option, and nested objects such
+  as ccb_flags/pre0_flags expand with their "ccb-"/"pre0-" prefix.
+
+  Jobs are parsed with the regular command line parser so they are
+  validated exactly like a direct invocation. Relative paths resolve
+  against the job's cwd which, being process wide, means jobs run one
+  at a time; each job still fans out over the daemon's --jobs workers.
+*/
+namespace l
+{
+  static std::mutex g_job_mutex;
+
+  static
+  void
+  append_option(const std::string &name_,
+                const JSON::Value &val_,
+                SubCmd::ArgVec    &args_)
+  {
+    std::string key;
+
+    key = name_;
+    for(auto &c : key)
+      {
+        if(c == '_')
+          c = '-';
+      }
+
+    switch(val_.type())
+      {
+      case JSON::Value::Type::NUL:
+        break;
+      case JSON::Value::Type::ARRAY:
+        for(const auto &item : val_.as_array())
+          args_.emplace_back("--" + key + "=" + item.to_arg());
+        break;
+      case JSON::Value::Type::OBJECT:
+        {
+          std::string prefix;
+          const std::string suffix = "-flags";
+
+          if((key.size() > suffix.size()) &&
+             (key.compare(key.size() - suffix.size(),suffix.size(),suffix) == 0))
+            prefix = key.substr(0,key.size() - suffix.size()) + "-";
+
+          for(const auto &member : val_.as_object())
+            l::append_option(prefix + member.first,member.second,args_);
+        }
+        break;
+      default:
+        args_.emplace_back("--" + key + "=" + val_.to_arg());
+        break;
+      }
+  }
+
+  static
+  SubCmd::ArgVec
+  job_to_args(const JSON::Value &job_)
+  {
+    SubCmd::ArgVec args;
+    const JSON::Value *val;
+
+    val = job_.find("args");
+    if(val)
+      {
+        for(const auto &arg : val->as_array())
+          args.emplace_back(arg.as_string());
+        return args;
+      }
+
+    val = job_.find("command");
+    if(!val)
+      throw std::runtime_error("job has neither 'args' nor 'command'");
+
+    args.emplace_back(val->as_string());
+    for(const auto &member : job_.as_object())
+      {
+        if((member.first == "command")   ||
+           (member.first == "cwd")       ||
+           (member.first == "filepath")  ||
+           (member.first == "filepaths"))
+          continue;
+
+        l::append_option(member.first,member.second,args);
+      }
+
+    args.emplace_back("--");
+    for(const auto *key : {"filepath","filepaths"})
+      {
+        val = job_.find(key);
+        if(!val)
+          continue;
+        if(val->is_array())
+          {
+            for(const auto &filepath : val->as_array())
+              args.emplace_back(filepath.as_string());
+          }
+        else
+          {
+            args.emplace_back(val->as_string());
+          }
+      }
+
+    return args;
+  }
+
+  static
+  JSON::Value
+  run_job(const std::string      &line_,
+          const Options::Serve   &opts_,
+          const SubCmd::Runner   &runner_)
+  {
+    int status;
+    fs::path cwd;
+    std::string out;
+    std::string err;
+    JSON::Value job;
+    SubCmd::ArgVec args;
+    JSON::Value rv = JSON::Value::object();
+    std::unique_lock<std::mutex> lk(l::g_job_mutex,std::defer_lock);
+
+    try
+      {
+        const JSON::Value *val;
+
+        job  = JSON::parse(line_);
+        args = l::job_to_args(job);
+        if(args.empty())
+          throw std::runtime_error("empty job");
+        if((args[0] == "serve") || (args[0] == "client"))
+          throw fmt::exception("'{}' can not be run by the daemon",args[0]);
+
+        lk.lock();
+        val = job.find("cwd");
+        if(val)
+          {
+            cwd = fs::current_path();
+            fs::current_path(val->as_string());
+          }
+
+        status = runner_(args,opts_.batch,out,err);
+      }
+    catch(const std::system_error &e_)
+      {
+        status = 1;
+        err += fmt::format("{} ({})\n",e_.what(),e_.code().message());
+      }
+    catch(const std::runtime_error &e_)
+      {
+        status = 1;
+        err += fmt::format("{}\n",e_.what());
+      }
+
+    if(!cwd.empty())
+      {
+        std::error_code ec;
+
+        fs::current_path(cwd,ec);
+      }
+    if(lk.owns_lock())
+      lk.unlock();
+
+    rv["status"] = status;
+    rv["stdout"] = out;
+    rv["stderr"] = err;
+
+    return rv;
+  }
+
+  static
+  void
+  handle_connection(UnixSocket            socket_,
+                    const Options::Serve &opts_,
+                    const SubCmd::Runner &runner_)
+  {
+    std::string line;
+
+    try
+      {
+        while(socket_.read_line(line))
+          {
+            if(line.empty())
+              continue;
+
+            socket_.write_line(l::run_job(line,opts_,runner_).dump());
+          }
+      }
+    catch(const std::system_error &e_)
+      {
+        fmt::print(stderr,"{} ({})\n",e_.what(),e_.code().message());
+      }
+    catch(const std::exception &e_)
+      {
+        fmt::print(stderr,"{}\n",e_.what());
+      }
+  }
+}
+
+namespace SubCmd
+{
+  void
+  serve(const Options::Serve &opts_,
+        const Runner         &runner_)
+  {
+    UnixSocket server;
+
+#ifdef SIGPIPE
+    std::signal(SIGPIPE,SIG_IGN);
+#endif
+    MappedFile::allow_mmap(false);
+
+    server.listen(opts_.socket);
+    Log::print("listening on {}\n",opts_.socket);
+    std::fflush(stdout);
+
+    while(true)
+      {
+        UnixSocket conn;
+
+        conn = server.accept();
+
+        std::thread(l::handle_connection,
+                    std::move(conn),
+                    std::cref(opts_),
+                    std::cref(runner_)).detach();
+      }
+  }
+}
@@ -16,12 +16,14 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "batch.hpp"
 #include "bitmap.hpp"
 #include "byteswap.hpp"
 #include "bytevec.hpp"
 #include "convert.hpp"
+#include "frame.hpp"
+#include "log.hpp"
 #include "options.hpp"
-#include "read_file.hpp"
 #include "stbi.hpp"
 #include "template.hpp"
 #include "video_image.hpp"
@@ -62,49 +64,69 @@ namespace l
     return filepath;
   }
 
+  // Rows are converted and written as they are decoded so, for
+  // frames which can stream, no whole image is ever held. Those which
+  // can't are decoded a window at a time on the thread pool.
   static
   void
   to_banner(const fs::path          &filepath_,
+            const MappedFile        &file_,
             const Options::ToBanner &opts_)
   {
-    BitmapVec bitmaps;
-
-    convert::to_bitmap(filepath_,bitmaps);
-    if(bitmaps.empty())
+    size_t converted;
+    FrameVec frames;
+
+    if(file_.empty())
+      throw fmt::exception("file empty: {}",filepath_);
+
+    convert::to_frames(file_,frames);
+
+    converted = 0;
+    convert::for_each_frame(frames,
+                            convert::select_frames(frames,{}),
+                            [&](const size_t i_) { return !frames[i_].rows; },
+                            [&](const size_t i_, Bitmap &bitmap_)
+                            {
+                              RowSource rows;
+                              fs::path filepath;
+
+                              if(frames[i_].rows)
+                                convert::frame_to_rows(frames,i_,bitmap_,rows);
+                              else if(bitmap_)
+                                rows = convert::bitmap_rows(bitmap_);
+                              else
+                                return;
+                              converted++;
+
+                              if(bitmap_.h & 0x1)
+                                {
+                                  bitmap_.h--;
+                                  Log::print(" - WARNING - banners need to be an even number of vertical lines"
+                                             ": truncating from {} to {} lines\n",
+                                             bitmap_.h + 1,
+                                             bitmap_.h);
+                                }
+
+                              if(((bitmap_.w != 320) && (bitmap_.h != 240)) ||
+                                 ((bitmap_.w != 352) && (bitmap_.h != 288)))
+                                {
+                                  Log::print(" - WARNING - non-fullscreen banners are not supported by 3DO OS\n");
+                                }
+
+                              if((bitmap_.w == 0) || (bitmap_.h == 0))
+                                return;
+
+                              filepath = l::generate_filepath(filepath_,
+                                                              opts_.output_path,
+                                                              bitmap_);
+
+                              WriteFile::banner(filepath,bitmap_.w,bitmap_.h,rows);
+
+                              Log::print(" - {}\n",filepath);
+                            });
+
+    if(converted == 0)
       throw fmt::exception("failed to convert");
-
-    for(auto &bitmap : bitmaps)
-      {
-        ByteVec pdat;
-        fs::path filepath;
-
-        if(bitmap.h & 0x1)
-          {
-            bitmap.h--;
-            fmt::print(" - WARNING - banners need to be an even number of vertical lines"
-                       ": truncating from {} to {} lines\n",
-                       bitmap.h + 1,
-                       bitmap.h);
-          }
-
-        if(((bitmap.w != 320) && (bitmap.h != 240)) ||
-           ((bitmap.w != 352) && (bitmap.h != 288)))
-          {
-            fmt::print(" - WARNING - non-fullscreen banners are not supported by 3DO OS\n");
-          }
-        convert::bitmap_to_uncoded_unpacked_lrform_16bpp(bitmap,pdat);
-
-        if(pdat.empty())
-          continue;
-
-        filepath = l::generate_filepath(filepath_,
-                                        opts_.output_path,
-                                        bitmap);
-
-        WriteFile::banner(filepath,bitmap.w,bitmap.h,pdat);
-
-        fmt::print(" - {}\n",filepath);
-      }
   }
 
   static
@@ -122,42 +144,30 @@ namespace l
 
   static
   void
-  handle_file(const fs::path          &filepath_,
+  handle_file(Batch::Input            &input_,
               const Options::ToBanner &opts_)
   {
-    fmt::print("{}:\n",filepath_);
+    const fs::path &filepath = input_.filepath();
 
-    if(l::same_extension(filepath_,opts_))
+    Log::print("{}:\n",filepath);
+
+    if(l::same_extension(filepath,opts_))
       {
-        fmt::print(" - WARNING - skipping file with target extension\n");
+        Log::print(" - WARNING - skipping file with target extension\n");
         return;
       }
 
     try
       {
-        l::to_banner(filepath_,opts_);
+        l::to_banner(filepath,input_.file(),opts_);
       }
     catch(const std::system_error &e_)
       {
-        fmt::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
+        Log::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
       }
     catch(const std::runtime_error &e_)
       {
-        fmt::print(" - ERROR - {}\n",e_.what());
-      }
-  }
-
-  static
-  void
-  handle_dir(const fs::path          &dirpath_,
-             const Options::ToBanner &opts_)
-  {
-    for(const fs::directory_entry &de : fs::recursive_directory_iterator(dirpath_))
-      {
-        if(!de.is_regular_file())
-          continue;
-
-        l::handle_file(de.path(),opts_);
+        Log::print(" - ERROR - {}\n",e_.what());
       }
   }
 }
@@ -167,14 +177,19 @@ namespace SubCmd
   void
   to_banner(const Options::ToBanner &opts_)
   {
-    for(const auto &filepath : opts_.filepaths)
-      {
-        fs::directory_entry de(filepath);
-
-        if(de.is_regular_file())
-          l::handle_file(de.path(),opts_);
-        else if(de.is_directory())
-          l::handle_dir(de.path(),opts_);
-      }
+    Options::PathVec filepaths;
+
+    filepaths = Batch::get_filepaths(opts_.filepaths);
+
+    Batch::run(filepaths,
+               opts_.batch,
+               [&](const Batch::Input &input_)
+               {
+                 return l::same_extension(input_.filepath(),opts_);
+               },
+               [&](Batch::Input &input_)
+               {
+                 l::handle_file(input_,opts_);
+               });
   }
 }
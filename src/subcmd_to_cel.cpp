@@ -17,18 +17,24 @@
 */
 
 #include "byteswap.hpp"
+#include "batch.hpp"
 #include "bytevec.hpp"
 #include "ccb_flags.hpp"
+#include "cel_cache.hpp"
 #include "cel_control_chunk.hpp"
 #include "cel_packer.hpp"
+#include "cel_search.hpp"
 #include "cel_types.hpp"
 #include "chunk_ids.hpp"
 #include "clamp.hpp"
 #include "convert.hpp"
 #include "fp12_20.hpp"
+#include "frame.hpp"
 #include "fp16_16.hpp"
+#include "hash.hpp"
+#include "log.hpp"
+#include "manifest.hpp"
 #include "options.hpp"
-#include "read_file.hpp"
 #include "stbi.hpp"
 #include "template.hpp"
 #include "write_cel.hpp"
@@ -37,6 +43,8 @@
 
 #include <filesystem>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 
 namespace fs = std::filesystem;
@@ -184,14 +192,11 @@ namespace l
   }
 
   static
-  fs::path
-  generate_filepath(const fs::path         src_filepath_,
-                    const fs::path         dst_filepath_,
-                    const Bitmap          &bitmap_,
-                    const CelControlChunk &ccc_)
+  CelCache::StrMap
+  template_extra(const Bitmap          &bitmap_,
+                 const CelControlChunk &ccc_)
   {
-    fs::path filepath;
-    std::unordered_map<std::string,std::string> extra =
+    return
       {
         {"coded",(ccc_.coded() ? "coded" : "uncoded")},
         {"packed",(ccc_.packed() ? "packed" : "unpacked")},
@@ -207,168 +212,100 @@ namespace l
         {"index",bitmap_.get("index","0")},
         {"_index",bitmap_.has("index") ? "_" + bitmap_.get("index") : ""}
       };
-
-    filepath = resolve_path_template(src_filepath_,
-                                     dst_filepath_,
-                                     ".cel",
-                                     extra);
-
-    return filepath;
   }
 
   static
   void
-  write_file(const fs::path        &filepath_,
-             const Options::ToCEL  &opts_,
-             const CelControlChunk &ccc_,
-             const ByteVec         &pdat_,
-             const PLUT            &plut_)
+  write_file(const fs::path          &src_filepath_,
+             const Options::ToCEL    &opts_,
+             const CelCache::StrMap  &extra_,
+             const CelControlChunk   &ccc_,
+             const ByteVec           &pdat_,
+             const PLUT              &plut_,
+             CelCache::Recorder      *recorder_)
   {
     PLUT plut;
+    fs::path filepath;
 
     if(opts_.write_plut == true)
       plut = plut_;
 
-    WriteFile::cel(filepath_,ccc_,pdat_,plut);
-    fmt::print(" - {}\n",filepath_);
+    filepath = resolve_path_template(src_filepath_,
+                                     opts_.output_path,
+                                     ".cel",
+                                     extra_);
+
+    WriteFile::cel(filepath,ccc_,pdat_,plut);
+    if(recorder_)
+      recorder_->output(extra_,ccc_,pdat_,plut);
+    Log::print(" - {}\n",filepath);
+    if(recorder_)
+      recorder_->mark();
   }
 
   static
   void
-  find_smallest_regular(Bitmap  &bitmap_,
-                        CelType &celtype_,
-                        PLUT    &plut_,
-                        ByteVec &pdat_)
+  write_cel(const fs::path       &filepath_,
+            const Options::ToCEL &opts_,
+            const Bitmap         &bitmap_,
+            const CelType        &celtype_,
+            const ByteVec        &pdat_,
+            const PLUT           &plut_,
+            CelCache::Recorder   *recorder_)
   {
-    CelType tmp_celtype;
-    PLUT    tmp_plut;
-    ByteVec tmp_pdat;
-    Bitmap  tmp_bitmap;
-    PLUT    best_plut;
-    ByteVec best_pdat;
-    CelType best_celtype;
-    Bitmap  best_bitmap;
-    std::array<bool,2>    packeds   = {false, true};
-    std::array<bool,2>    codeds    = {false, true};
-    std::array<uint8_t,6> bpps      = {1,2,4,6,8,16};
-
-    best_celtype = tmp_celtype = celtype_;
-    best_plut    = tmp_plut    = plut_;
-    best_pdat    = tmp_pdat    = pdat_;
-    best_bitmap  = tmp_bitmap  = bitmap_;
-
-    for(const auto bpp : bpps)
-      {
-        for(const auto packed : packeds)
-          {
-            for(const auto coded : codeds)
-              {
-                tmp_celtype.bpp    = bpp;
-                tmp_celtype.lrform = false;
-                tmp_celtype.packed = packed;
-                tmp_celtype.coded  = coded;
-                try
-                  {
-                    convert::bitmap_to_cel(bitmap_,tmp_celtype,tmp_pdat,tmp_plut);
-                  }
-                catch(...)
-                  {
-                    continue;
-                  }
-
-                if(!best_pdat.empty() && (tmp_pdat.size() >= best_pdat.size()))
-                  continue;
-
-                best_celtype = tmp_celtype;
-                best_pdat    = tmp_pdat;
-                best_plut    = tmp_plut;
-                best_bitmap  = bitmap_;
-              }
-          }
-      }
+    CelControlChunk ccc;
+
+    l::populate_ccc(celtype_,bitmap_.w,bitmap_.h,ccc);
 
-    celtype_ = best_celtype;
-    plut_    = best_plut;
-    pdat_    = best_pdat;
-    bitmap_  = best_bitmap;
+    l::modify_ccb_flags(opts_.ccb_flags,ccc);
+    l::modify_pre0_flags(opts_.pre0_flags,ccc);
+
+    l::write_file(filepath_,
+                  opts_,
+                  l::template_extra(bitmap_,ccc),
+                  ccc,
+                  pdat_,
+                  plut_,
+                  recorder_);
   }
 
+  // Leaves celtype_ and the empty pdat_ alone if no type fits.
   static
   void
-  find_smallest_rotation(Bitmap  &bitmap_,
-                         CelType &celtype_,
-                         PLUT    &plut_,
-                         ByteVec &pdat_)
+  find_smallest(const Options::ToCEL &opts_,
+                Bitmap               &bitmap_,
+                CelType              &celtype_,
+                PLUT                 &plut_,
+                ByteVec              &pdat_)
   {
-    CelType tmp_celtype;
-    PLUT    tmp_plut;
-    ByteVec tmp_pdat;
-    Bitmap  tmp_bitmap;
-    PLUT    best_plut;
-    ByteVec best_pdat;
-    CelType best_celtype;
-    Bitmap  best_bitmap;
-    std::array<int,4>     rotations = {0,90,180,270};
-    std::array<bool,2>    packeds   = {false, true};
-    std::array<bool,2>    codeds    = {false, true};
-    std::array<uint8_t,6> bpps      = {1,2,4,6,8,16};
-
-    best_celtype = tmp_celtype = celtype_;
-    best_plut    = tmp_plut    = plut_;
-    best_pdat    = tmp_pdat    = pdat_;
-    best_bitmap  = tmp_bitmap  = bitmap_;
-    for(auto rotation : rotations)
-      {
-        bitmap_.rotate_to(rotation);
+    std::vector<int> rotations;
+    CelSearch::Result result;
 
-        for(const auto bpp : bpps)
-          {
-            for(const auto packed : packeds)
-              {
-                for(const auto coded : codeds)
-                  {
-                    tmp_celtype.bpp    = bpp;
-                    tmp_celtype.lrform = false;
-                    tmp_celtype.packed = packed;
-                    tmp_celtype.coded  = coded;
-                    try
-                      {
-                        convert::bitmap_to_cel(bitmap_,tmp_celtype,tmp_pdat,tmp_plut);
-                      }
-                    catch(...)
-                      {
-                        continue;
-                      }
-
-                    if(!best_pdat.empty() && (tmp_pdat.size() >= best_pdat.size()))
-                      continue;
-
-                    best_celtype = tmp_celtype;
-                    best_pdat    = tmp_pdat;
-                    best_plut    = tmp_plut;
-                    best_bitmap  = bitmap_;
-                  }
-              }
-          }
-      }
+    if(opts_.find_smallest == "regular")
+      rotations = {opts_.rotation};
+    else if(opts_.find_smallest == "rotation")
+      rotations = {0,90,180,270};
+    else
+      throw std::runtime_error("Unknown request");
 
-    celtype_ = best_celtype;
-    plut_    = best_plut;
-    pdat_    = best_pdat;
-    bitmap_  = best_bitmap;
+    if(!CelSearch::smallest(bitmap_,rotations,result))
+      return;
+
+    celtype_ = result.celtype;
+    plut_    = std::move(result.plut);
+    pdat_    = std::move(result.pdat);
   }
 
   static
   void
   convert(const fs::path       &filepath_,
           const Options::ToCEL &opts_,
-          Bitmap               &bitmap_)
+          Bitmap               &bitmap_,
+          CelCache::Recorder   *recorder_)
   {
     PLUT plut;
     ByteVec pdat;
     CelType celtype;
-    CelControlChunk ccc;
-    fs::path filepath;
 
     celtype.bpp    = opts_.bpp;
     celtype.coded  = opts_.coded;
@@ -377,112 +314,380 @@ namespace l
 
     if(opts_.find_smallest.empty())
       convert::bitmap_to_cel(bitmap_,celtype,pdat,plut);
-    else if(opts_.find_smallest == "regular")
-      l::find_smallest_regular(bitmap_,celtype,plut,pdat);
-    else if(opts_.find_smallest == "rotation")
-      l::find_smallest_rotation(bitmap_,celtype,plut,pdat);
     else
-      throw std::runtime_error("Unknown request");
+      l::find_smallest(opts_,bitmap_,celtype,plut,pdat);
 
     if(pdat.empty())
       return;
 
-    l::populate_ccc(celtype,bitmap_.w,bitmap_.h,ccc);
-
-    l::modify_ccb_flags(opts_.ccb_flags,ccc);
-    l::modify_pre0_flags(opts_.pre0_flags,ccc);
-
-    filepath = l::generate_filepath(filepath_,
-                                    opts_.output_path,
-                                    bitmap_,
-                                    ccc);
+    l::write_cel(filepath_,opts_,bitmap_,celtype,pdat,plut,recorder_);
+  }
 
-    l::write_file(filepath,opts_,ccc,pdat,plut);
+  static
+  Options::Path
+  output_template(const Options::ToCEL &opts_)
+  {
+    if(opts_.generate_all)
+      return "{filepath}_{coded}_{packed}_{bpp}bpp{_index}{ext}";
+    return opts_.output_path;
   }
 
+  // Types the image can't be stored as are skipped.
   static
   void
   generate_all_cel_types(const fs::path       &filepath_,
                          const Options::ToCEL &opts_,
-                         const BitmapVec      &bitmaps_)
+                         Bitmap               &bitmap_,
+                         CelCache::Recorder   *recorder_)
   {
     Options::ToCEL opts;
-    std::string filepath_template;
-
-    std::array<bool,2>    packeds   = {false, true};
-    std::array<bool,2>    codeds    = {false, true};
-    std::array<uint8_t,6> bpps      = {1,2,4,6,8,16};
+    CelSearch::ResultVec results;
 
     opts = opts_;
-    filepath_template = "{filepath}_{coded}_{packed}_{bpp}bpp{_index}{ext}";
-    opts.output_path = filepath_template;
-    for(auto bitmap : bitmaps_)
+    opts.output_path = l::output_template(opts_);
+
+    CelSearch::all(bitmap_,results);
+    for(const auto &result : results)
       {
-        for(const auto bpp : bpps)
+        try
           {
-            for(const auto packed : packeds)
-              {
-                for(const auto coded : codeds)
-                  {
-                    opts.bpp    = bpp;
-                    opts.coded  = coded;
-                    opts.lrform = false;
-                    opts.packed = packed;
-
-                    try
-                      {
-                        l::convert(filepath_,opts,bitmap);
-                      }
-                    catch(const std::runtime_error &e_)
-                      {
-
-                      }
-                  }
-              }
+            l::write_cel(filepath_,
+                         opts,
+                         bitmap_,
+                         result.celtype,
+                         result.pdat,
+                         result.plut,
+                         recorder_);
           }
+        catch(const std::runtime_error &e_)
+          {
+
+          }
+      }
+  }
+
+  static
+  void
+  prepare_bitmap(const Options::ToCEL &opts_,
+                 Bitmap               &bitmap_)
+  {
+    bitmap_.rotate_to(opts_.rotation);
+
+    if(opts_.lrform && (bitmap_.h & 0x1))
+      {
+        bitmap_.h--;
+        Log::print(" - WARNING - LRFORM needs to be an even number of vertical lines"
+                   ": truncating from {} to {} lines\n",
+                   bitmap_.h + 1,
+                   bitmap_.h);
+      }
+
+    if(!opts_.external_palette.empty())
+      bitmap_.set("external-palette",opts_.external_palette.string());
+    if(opts_.pack_optimal)
+      bitmap_.set("pack-optimal","true");
+
+    bitmap_.replace_color(opts_.transparent,0x00000000);
+  }
+
+  // Replaces the transparent color on the way through as
+  // prepare_bitmap() does.
+  class TransparentRows : public RowSink
+  {
+  public:
+    TransparentRows(const uint32_t  color_,
+                    const uint64_t  w_,
+                    RowSink        &sink_)
+      : _color(color_),
+        _row(w_),
+        _sink(sink_)
+    {
+    }
+
+  public:
+    void
+    row(const RGBA8888 *pixels_)
+    {
+      for(size_t x = 0; x < _row.size(); x++)
+        _row[x] = ((pixels_[x] == _color) ? RGBA8888(0x00000000) : pixels_[x]);
+
+      _sink.row(_row.data());
+    }
+
+  private:
+    const RGBA8888         _color;
+    std::vector<RGBA8888>  _row;
+    RowSink               &_sink;
+  };
+
+  // Uncoded unpacked CELs are encoded a row at a time as the frame is
+  // decoded when nothing needs the whole image: no rotation, type
+  // search, PLUT or cache recording.
+  static
+  bool
+  streams(const Options::ToCEL        &opts_,
+          const Frame                 &frame_,
+          const CelCache::Recorder    *recorder_,
+          PDATRowWriter::Format       &format_)
+  {
+    if(!frame_.rows || recorder_)
+      return false;
+    if(opts_.generate_all || !opts_.find_smallest.empty() || opts_.rotation)
+      return false;
+    if(opts_.coded || opts_.packed)
+      return false;
+
+    if(opts_.lrform && (opts_.bpp == 16))
+      format_ = PDATRowWriter::Format::LRFORM_16BPP;
+    else if(!opts_.lrform && (opts_.bpp == 16))
+      format_ = PDATRowWriter::Format::LINEAR_16BPP;
+    else if(!opts_.lrform && (opts_.bpp == 8))
+      format_ = PDATRowWriter::Format::LINEAR_8BPP;
+    else
+      return false;
+
+    return true;
+  }
+
+  // False if the frame can't be streamed or turns out to hold no
+  // image, in which case nothing was written.
+  static
+  bool
+  stream_cel(const fs::path       &filepath_,
+             const Options::ToCEL &opts_,
+             const FrameVec       &frames_,
+             const size_t          idx_,
+             CelCache::Recorder   *recorder_)
+  {
+    Bitmap info;
+    RowSource rows;
+    fs::path filepath;
+    CelType celtype;
+    CelControlChunk ccc;
+    CelCache::StrMap extra;
+    PDATRowWriter::Format format;
+
+    if(!l::streams(opts_,frames_[idx_],recorder_,format))
+      return false;
+
+    if(!convert::frame_to_rows(frames_,idx_,info,rows))
+      return false;
+
+    if(opts_.lrform && (info.h & 0x1))
+      {
+        info.h--;
+        Log::print(" - WARNING - LRFORM needs to be an even number of vertical lines"
+                   ": truncating from {} to {} lines\n",
+                   info.h + 1,
+                   info.h);
       }
+
+    if(info.h == 0)
+      return true;
+
+    celtype.bpp    = opts_.bpp;
+    celtype.coded  = opts_.coded;
+    celtype.lrform = opts_.lrform;
+    celtype.packed = opts_.packed;
+
+    l::populate_ccc(celtype,info.w,info.h,ccc);
+
+    l::modify_ccb_flags(opts_.ccb_flags,ccc);
+    l::modify_pre0_flags(opts_.pre0_flags,ccc);
+
+    extra    = l::template_extra(info,ccc);
+    filepath = resolve_path_template(filepath_,
+                                     opts_.output_path,
+                                     ".cel",
+                                     extra);
+
+    WriteFile::cel(filepath,
+                   ccc,
+                   format,
+                   [&](RowSink &sink_)
+                   {
+                     l::TransparentRows transparent(opts_.transparent,info.w,sink_);
+
+                     rows(transparent);
+                   });
+    Log::print(" - {}\n",filepath);
+
+    return true;
   }
 
+  // Selected frames are decoded a window at a time on the thread
+  // pool and converted in order so only that many images are ever
+  // held in memory.
   static
   void
   to_cel(const fs::path       &filepath_,
-         const Options::ToCEL &opts_)
+         const MappedFile     &file_,
+         const Options::ToCEL &opts_,
+         CelCache::Recorder   *recorder_)
   {
-    ByteVec data;
-    BitmapVec bitmaps;
+    size_t converted;
+    FrameVec frames;
 
-    ReadFile::read(filepath_,data);
-    if(data.empty())
+    if(file_.empty())
       throw fmt::exception("file empty");
 
-    convert::to_bitmap(data,bitmaps);
-    if(bitmaps.empty())
+    convert::to_frames(file_,frames);
+    if(frames.empty())
       throw fmt::exception("failed to convert");
 
-    for(auto &bitmap : bitmaps)
+    converted = 0;
+    convert::for_each_frame(frames,
+                            convert::select_frames(frames,opts_.select.filter()),
+                            [&](const size_t i_)
+                            {
+                              PDATRowWriter::Format format;
+
+                              return !l::streams(opts_,frames[i_],recorder_,format);
+                            },
+                            [&](const size_t i_, Bitmap &bitmap_)
+                            {
+                              if(l::stream_cel(filepath_,opts_,frames,i_,recorder_))
+                                {
+                                  converted++;
+                                  return;
+                                }
+
+                              if(!bitmap_)
+                                return;
+
+                              l::prepare_bitmap(opts_,bitmap_);
+                              if(opts_.generate_all)
+                                l::generate_all_cel_types(filepath_,opts_,bitmap_,recorder_);
+                              else
+                                l::convert(filepath_,opts_,bitmap_,recorder_);
+                              converted++;
+                            });
+
+    if(converted == 0)
+      {
+        if(!opts_.select.all())
+          throw fmt::exception("no images selected of {}",
+                               convert::frame_images(frames));
+        throw fmt::exception("failed to convert");
+      }
+  }
+
+  // Everything which affects the bytes written other than the input
+  // file itself. Paths are left out so moved or renamed inputs and
+  // new output templates still hit.
+  static
+  std::string
+  cache_opts(const Options::ToCEL &opts_)
+  {
+    std::string rv;
+    const Options::Flag *flags;
+
+    rv = fmt::format("bpp={} coded={} packed={} pack_optimal={} lrform={}"
+                     " rotation={} transparent={:08x} write_plut={}"
+                     " generate_all={} find_smallest={} ccb=",
+                     opts_.bpp,
+                     opts_.coded,
+                     opts_.packed,
+                     opts_.pack_optimal,
+                     opts_.lrform,
+                     opts_.rotation,
+                     opts_.transparent,
+                     opts_.write_plut,
+                     opts_.generate_all,
+                     opts_.find_smallest);
+
+    flags = (const Options::Flag*)&opts_.ccb_flags;
+    for(size_t i = 0; i < (sizeof(opts_.ccb_flags) / sizeof(*flags)); i++)
+      rv += fmt::to_string((int)flags[i]);
+    rv += " pre0=";
+    flags = (const Options::Flag*)&opts_.pre0_flags;
+    for(size_t i = 0; i < (sizeof(opts_.pre0_flags) / sizeof(*flags)); i++)
+      rv += fmt::to_string((int)flags[i]);
+
+    if(!opts_.select.all())
+      {
+        rv += " index=";
+        for(const auto idx : opts_.select.indexes)
+          rv += fmt::format("{},",idx);
+        if(opts_.select.range)
+          rv += fmt::format(" range={}-{}",opts_.select.first,opts_.select.last);
+      }
+
+    if(!opts_.external_palette.empty())
       {
-        bitmap.rotate_to(opts_.rotation);
+        MappedFile palette;
 
-        if(opts_.lrform && (bitmap.h & 0x1))
+        try
           {
-            bitmap.h--;
-            fmt::print(" - WARNING - LRFORM needs to be an even number of vertical lines"
-                       ": truncating from {} to {} lines\n",
-                       bitmap.h + 1,
-                       bitmap.h);
+            palette.open(opts_.external_palette);
+            rv += fmt::format(" palette={:016x}",
+                              Hash::xxh64(palette.data(),palette.size()));
           }
+        catch(const std::exception &e_)
+          {
+            rv += " palette=?";
+          }
+      }
 
-        if(!opts_.external_palette.empty())
-          bitmap.set("external-palette",opts_.external_palette.string());
+    return rv;
+  }
+
+  static
+  void
+  replay(const fs::path        &filepath_,
+         const Options::ToCEL  &opts_,
+         const CelCache::Entry &entry_)
+  {
+    Options::ToCEL opts;
 
-        bitmap.replace_color(opts_.transparent,0x00000000);
+    opts = opts_;
+    opts.output_path = l::output_template(opts_);
+    for(const auto &output : entry_.outputs)
+      {
+        Log::write(output.log);
+        l::write_file(filepath_,
+                      opts,
+                      output.extra,
+                      output.ccc,
+                      output.pdat,
+                      output.plut,
+                      nullptr);
       }
+    Log::write(entry_.log);
+  }
 
-    if(opts_.generate_all)
-      return generate_all_cel_types(filepath_,opts_,bitmaps);
+  static
+  void
+  to_cel_cached(const fs::path       &filepath_,
+                const MappedFile     &file_,
+                const Options::ToCEL &opts_,
+                CelCache             &cache_,
+                const std::string    &cache_opts_)
+  {
+    std::string log;
+    CelCache::Key key;
+    CelCache::Entry entry;
+
+    key = cache_.key(file_,cache_opts_);
+    if(cache_.lookup(key,cache_opts_,entry))
+      return l::replay(filepath_,opts_,entry);
+
+    CelCache::Recorder recorder(log);
+    try
+      {
+        Log::Capture capture(log);
+
+        l::to_cel(filepath_,file_,opts_,&recorder);
+      }
+    catch(...)
+      {
+        Log::write(log);
+        throw;
+      }
 
-    for(auto &bitmap : bitmaps)
-      l::convert(filepath_,opts_,bitmap);
+    Log::write(log);
+    recorder.finish();
+    cache_.store(key,cache_opts_,recorder.entry);
   }
 
   static
@@ -500,55 +705,61 @@ namespace l
 
   static
   void
-  handle_file(const fs::path       &filepath_,
-              const Options::ToCEL &opts_)
+  handle_file(Batch::Input         &input_,
+              const Options::ToCEL &opts_,
+              CelCache             *cache_,
+              const std::string    &cache_opts_)
   {
-    fmt::print("{}:\n",filepath_);
+    const fs::path &filepath = input_.filepath();
+
+    Log::print("{}:\n",filepath);
 
-    if(l::same_extension(filepath_,opts_))
+    if(l::same_extension(filepath,opts_))
       {
-        fmt::print(" - INFO - skipping file with target extension\n");
+        Log::print(" - INFO - skipping file with target extension\n");
         return;
       }
 
     try
       {
-        l::to_cel(filepath_,opts_);
+        if(cache_)
+          l::to_cel_cached(filepath,input_.file(),opts_,*cache_,cache_opts_);
+        else
+          l::to_cel(filepath,input_.file(),opts_,nullptr);
       }
     catch(const std::system_error &e_)
       {
-        fmt::print(" - ERROR - {} - {} ({})\n",filepath_,e_.what(),e_.code().message());
+        Log::print(" - ERROR - {} - {} ({})\n",filepath,e_.what(),e_.code().message());
       }
     catch(const std::runtime_error &e_)
       {
-        fmt::print(" - ERROR - {} - {}\n",filepath_,e_.what());
+        Log::print(" - ERROR - {} - {}\n",filepath,e_.what());
       }
   }
 
-  std::vector<fs::path>
-  get_filepaths(const Options::PathVec &filepaths_)
+  static
+  std::unique_ptr<CelCache>
+  open_cache(const Options::Cache &opts_)
   {
-    std::vector<fs::path> rv;
-
-    for(const auto &filepath : filepaths_)
-      {
-        fs::directory_entry de(filepath);
+    if(opts_.dirpath.empty())
+      return {};
 
-        if(de.is_regular_file())
-          rv.emplace_back(de.path());
-        else if(de.is_directory())
-          {
-            auto diriter = fs::recursive_directory_iterator(filepath);
+    return std::make_unique<CelCache>(opts_.dirpath,opts_.max_size);
+  }
 
-            for(const fs::directory_entry &de : diriter)
-              {
-                if(de.is_regular_file())
-                  rv.emplace_back(de.path());
-              }
-          }
-      }
+  static
+  void
+  close_cache(CelCache *cache_)
+  {
+    if(!cache_)
+      return;
 
-    return rv;
+    cache_->evict();
+    Log::print("cache: {} hits, {} misses, {} stored, {} evicted\n",
+               cache_->hits(),
+               cache_->misses(),
+               cache_->stores(),
+               cache_->evictions());
   }
 }
 
@@ -557,11 +768,74 @@ namespace SubCmd
   void
   to_cel(const Options::ToCEL &opts_)
   {
+    std::string cache_opts;
+    Options::PathVec filepaths;
+    std::unique_ptr<CelCache> cache;
+
+    filepaths = Batch::get_filepaths(opts_.filepaths);
+    cache     = l::open_cache(opts_.cache);
+    if(cache)
+      cache_opts = l::cache_opts(opts_);
+
+    Batch::run(filepaths,
+               opts_.batch,
+               [&](const Batch::Input &input_)
+               {
+                 return l::same_extension(input_.filepath(),opts_);
+               },
+               [&](Batch::Input &input_)
+               {
+                 l::handle_file(input_,opts_,cache.get(),cache_opts);
+               });
+
+    l::close_cache(cache.get());
+  }
+
+  void
+  manifest(const Options::Manifest &opts_)
+  {
+    Manifest::EntryVec entries;
     Options::PathVec filepaths;
+    std::vector<size_t> owners;
+    std::vector<std::string> cache_opts;
+    std::unique_ptr<CelCache> cache;
 
-    filepaths = l::get_filepaths(opts_.filepaths);
+    Manifest::load(opts_.filepath,entries);
+
+    cache = l::open_cache(opts_.cache);
+    if(cache)
+      {
+        for(const auto &entry : entries)
+          cache_opts.emplace_back(l::cache_opts(entry));
+      }
+    else
+      {
+        cache_opts.resize(entries.size());
+      }
+
+    for(size_t i = 0; i < entries.size(); i++)
+      {
+        Options::PathVec tmp;
+
+        tmp = Batch::get_filepaths(entries[i].filepaths);
+        filepaths.insert(filepaths.end(),tmp.begin(),tmp.end());
+        owners.insert(owners.end(),tmp.size(),i);
+      }
 
-    for(const auto &filepath : filepaths)
-      l::handle_file(filepath,opts_);
+    Batch::run(filepaths,
+               opts_.batch,
+               [&](const Batch::Input &input_)
+               {
+                 return l::same_extension(input_.filepath(),
+                                          entries[owners[input_.idx()]]);
+               },
+               [&](Batch::Input &input_)
+               {
+                 size_t i = owners[input_.idx()];
+
+                 l::handle_file(input_,entries[i],cache.get(),cache_opts[i]);
+               });
+
+    l::close_cache(cache.get());
   }
 }
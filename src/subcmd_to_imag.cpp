@@ -16,14 +16,15 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "batch.hpp"
 #include "bitmap.hpp"
 #include "byteswap.hpp"
 #include "bytevec.hpp"
 #include "convert.hpp"
 #include "convert_bitmap_to_imag.hpp"
 #include "filerw.hpp"
+#include "log.hpp"
 #include "options.hpp"
-#include "read_file.hpp"
 #include "stbi.hpp"
 #include "template.hpp"
 #include "video_image.hpp"
@@ -64,11 +65,12 @@ namespace l
   static
   void
   to_imag(const fs::path        &input_filepath_,
+          const MappedFile      &file_,
           const Options::ToIMAG &opts_)
   {
     BitmapVec bitmaps;
 
-    convert::to_bitmap(input_filepath_,bitmaps);
+    convert::to_bitmap(input_filepath_,file_,bitmaps);
     if(bitmaps.empty())
       throw fmt::exception("failed to convert");
 
@@ -85,16 +87,16 @@ namespace l
         rv = f.open_write_trunc(output_filepath);
         if(rv < 0)
           {
-            fmt::print(" - {}: {}\n",output_filepath,strerror(-rv));
+            Log::print(" - {}: {}\n",output_filepath,strerror(-rv));
             continue;
           }
 
         convert::bitmap_to_imag(bitmap,f);
 
         if((bitmap.w != 320) || (bitmap.h != 240))
-          fmt::print(" - WARNING: 3DO SDK's LoadImage() really only supports 320x240.\n");
+          Log::print(" - WARNING: 3DO SDK's LoadImage() really only supports 320x240.\n");
 
-        fmt::print(" - {}\n",output_filepath);
+        Log::print(" - {}\n",output_filepath);
       }
   }
 
@@ -113,42 +115,30 @@ namespace l
 
   static
   void
-  handle_file(const fs::path        &filepath_,
+  handle_file(Batch::Input          &input_,
               const Options::ToIMAG &opts_)
   {
-    fmt::print("{}:\n",filepath_);
+    const fs::path &filepath = input_.filepath();
 
-    if(l::same_extension(filepath_,opts_))
+    Log::print("{}:\n",filepath);
+
+    if(l::same_extension(filepath,opts_))
       {
-        fmt::print(" - WARNING - skipping file with target extension\n");
+        Log::print(" - WARNING - skipping file with target extension\n");
         return;
       }
 
     try
       {
-        l::to_imag(filepath_,opts_);
+        l::to_imag(filepath,input_.file(),opts_);
       }
     catch(const std::system_error &e_)
       {
-        fmt::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
+        Log::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
       }
     catch(const std::runtime_error &e_)
       {
-        fmt::print(" - ERROR - {}\n",e_.what());
-      }
-  }
-
-  static
-  void
-  handle_dir(const fs::path        &dirpath_,
-             const Options::ToIMAG &opts_)
-  {
-    for(const fs::directory_entry &de : fs::recursive_directory_iterator(dirpath_))
-      {
-        if(!de.is_regular_file())
-          continue;
-
-        l::handle_file(de.path(),opts_);
+        Log::print(" - ERROR - {}\n",e_.what());
       }
   }
 }
@@ -158,14 +148,19 @@ namespace SubCmd
   void
   to_imag(const Options::ToIMAG &opts_)
   {
-    for(auto const &filepath : opts_.filepaths)
-      {
-        fs::directory_entry de(filepath);
-
-        if(de.is_regular_file())
-          l::handle_file(de.path(),opts_);
-        else if(de.is_directory())
-          l::handle_dir(de.path(),opts_);
-      }
+    Options::PathVec filepaths;
+
+    filepaths = Batch::get_filepaths(opts_.filepaths);
+
+    Batch::run(filepaths,
+               opts_.batch,
+               [&](const Batch::Input &input_)
+               {
+                 return l::same_extension(input_.filepath(),opts_);
+               },
+               [&](Batch::Input &input_)
+               {
+                 l::handle_file(input_,opts_);
+               });
   }
 }
@@ -16,14 +16,16 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "batch.hpp"
 #include "bitmap.hpp"
 #include "byteswap.hpp"
 #include "bytevec.hpp"
 #include "convert.hpp"
-#include "filerw.hpp"
+#include "frame.hpp"
+#include "log.hpp"
 #include "options.hpp"
-#include "read_file.hpp"
 #include "template.hpp"
+#include "write_pdat.hpp"
 
 #include "fmt.hpp"
 
@@ -60,52 +62,73 @@ namespace l
     return filepath;
   }
 
+  // Rows are converted and written as they are decoded so, for
+  // frames which can stream, no whole image is ever held. Those which
+  // can't are decoded a window at a time on the thread pool.
   static
   void
   to_lrform(const fs::path          &input_filepath_,
+            const MappedFile        &file_,
             const Options::ToLRFORM &opts_)
   {
-    BitmapVec bitmaps;
-
-    convert::to_bitmap(input_filepath_,bitmaps);
-    if(bitmaps.empty())
+    size_t converted;
+    FrameVec frames;
+
+    if(file_.empty())
+      throw fmt::exception("file empty: {}",input_filepath_);
+
+    convert::to_frames(file_,frames);
+
+    converted = 0;
+    convert::for_each_frame(frames,
+                            convert::select_frames(frames,{}),
+                            [&](const size_t i_) { return !frames[i_].rows; },
+                            [&](const size_t i_, Bitmap &bitmap_)
+                            {
+                              RowSource rows;
+                              fs::path output_filepath;
+
+                              if(frames[i_].rows)
+                                convert::frame_to_rows(frames,i_,bitmap_,rows);
+                              else if(bitmap_)
+                                rows = convert::bitmap_rows(bitmap_);
+                              else
+                                return;
+                              converted++;
+
+                              if(bitmap_.h & 0x1)
+                                {
+                                  bitmap_.h--;
+                                  Log::print(" - WARNING - banners need to be an even number of vertical lines"
+                                             ": truncating from {} to {} lines\n",
+                                             bitmap_.h + 1,
+                                             bitmap_.h);
+                                }
+
+                              output_filepath = l::generate_filepath(input_filepath_,
+                                                                     opts_.output_path,
+                                                                     bitmap_);
+
+                              try
+                                {
+                                  WriteFile::pdat(output_filepath,
+                                                  [](DataRW&) {},
+                                                  PDATRowWriter::Format::LRFORM_16BPP,
+                                                  bitmap_.w,
+                                                  bitmap_.h,
+                                                  rows);
+                                }
+                              catch(const std::system_error &e_)
+                                {
+                                  Log::print(" - {}: {}\n",output_filepath,e_.code().message());
+                                  return;
+                                }
+
+                              Log::print(" - {}\n",output_filepath);
+                            });
+
+    if(converted == 0)
       throw fmt::exception("failed to convert");
-
-    for(auto &bitmap : bitmaps)
-      {
-        int rv;
-        FileRW f;
-        ByteVec pdat;
-        fs::path output_filepath;
-
-        if(bitmap.h & 0x1)
-          {
-            bitmap.h--;
-            fmt::print(" - WARNING - banners need to be an even number of vertical lines"
-                       ": truncating from {} to {} lines\n",
-                       bitmap.h + 1,
-                       bitmap.h);
-          }
-
-        output_filepath = l::generate_filepath(input_filepath_,
-                                               opts_.output_path,
-                                               bitmap);
-
-        rv = f.open_write_trunc(output_filepath);
-        if(rv < 0)
-          {
-            fmt::print(" - {}: {}\n",output_filepath,strerror(-rv));
-            continue;
-          }
-
-        convert::bitmap_to_uncoded_unpacked_lrform_16bpp(bitmap,pdat);
-
-        f.w(pdat);
-
-        f.close();
-
-        fmt::print(" - {}\n",output_filepath);
-      }
   }
 
   static
@@ -123,42 +146,30 @@ namespace l
 
   static
   void
-  handle_file(const fs::path          &filepath_,
+  handle_file(Batch::Input            &input_,
               const Options::ToLRFORM &opts_)
   {
-    fmt::print("{}:\n",filepath_);
+    const fs::path &filepath = input_.filepath();
 
-    if(l::same_extension(filepath_,opts_))
+    Log::print("{}:\n",filepath);
+
+    if(l::same_extension(filepath,opts_))
       {
-        fmt::print(" - WARNING - skipping file with target extension\n");
+        Log::print(" - WARNING - skipping file with target extension\n");
         return;
       }
 
     try
       {
-        l::to_lrform(filepath_,opts_);
+        l::to_lrform(filepath,input_.file(),opts_);
       }
     catch(const std::system_error &e_)
       {
-        fmt::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
+        Log::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
       }
     catch(const std::runtime_error &e_)
       {
-        fmt::print(" - ERROR - {}\n",e_.what());
-      }
-  }
-
-  static
-  void
-  handle_dir(const fs::path          &dirpath_,
-             const Options::ToLRFORM &opts_)
-  {
-    for(const fs::directory_entry &de : fs::recursive_directory_iterator(dirpath_))
-      {
-        if(!de.is_regular_file())
-          continue;
-
-        l::handle_file(de.path(),opts_);
+        Log::print(" - ERROR - {}\n",e_.what());
       }
   }
 }
@@ -168,14 +179,19 @@ namespace SubCmd
   void
   to_lrform(const Options::ToLRFORM &opts_)
   {
-    for(auto const &filepath : opts_.filepaths)
-      {
-        fs::directory_entry de(filepath);
-
-        if(de.is_regular_file())
-          l::handle_file(de.path(),opts_);
-        else if(de.is_directory())
-          l::handle_dir(de.path(),opts_);
-      }
+    Options::PathVec filepaths;
+
+    filepaths = Batch::get_filepaths(opts_.filepaths);
+
+    Batch::run(filepaths,
+               opts_.batch,
+               [&](const Batch::Input &input_)
+               {
+                 return l::same_extension(input_.filepath(),opts_);
+               },
+               [&](Batch::Input &input_)
+               {
+                 l::handle_file(input_,opts_);
+               });
   }
 }
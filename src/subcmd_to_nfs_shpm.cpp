@@ -26,6 +26,7 @@
 #include "convert.hpp"
 #include "byteswap.hpp"
 #include "file.hpp"
+#include "log.hpp"
 
 #define BPP_16   0x6
 #define PACKED   0x80
@@ -125,8 +126,8 @@ SubCmd::to_nfs_shpm(const Options::ToNFSSHPM &opts_)
       output_path += ".3sh";
     }
 
-  fmt::print("{}:\n",output_path);
+  Log::print("{}:\n",output_path);
   l::write_file(bitmaps,pdats,opts_.packed,output_path);
   for(const auto &filepath : opts_.filepaths)
-    fmt::print(" - {}\n",filepath);
+    Log::print(" - {}\n",filepath);
 }
@@ -16,15 +16,18 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "batch.hpp"
 #include "bitmap.hpp"
 #include "bytevec.hpp"
 #include "convert.hpp"
+#include "frame.hpp"
 #include "identify_file.hpp"
+#include "log.hpp"
 #include "options.hpp"
-#include "read_file.hpp"
 #include "stbi.hpp"
 #include "template.hpp"
 #include "video_image.hpp"
+#include "write_png.hpp"
 
 #include "fmt.hpp"
 
@@ -60,37 +63,75 @@ namespace l
     return filepath;
   }
 
+  // Selected frames are decoded a window at a time on the thread
+  // pool and written in order so only that many images are ever held
+  // in memory. PNGs of frames which can stream don't even hold that:
+  // rows are encoded, on this thread, as they're decoded.
   void
   to_stb_image(const fs::path         &input_filepath_,
+               const MappedFile       &file_,
                const Options::ToImage &opts_,
                const std::string       type_)
   {
-    int rv;
-    ByteVec data;
-    BitmapVec bitmaps;
+    size_t converted;
+    FrameVec frames;
+    bool png;
 
-    ReadFile::read(input_filepath_,data);
-    if(data.empty())
+    if(file_.empty())
       throw fmt::exception("file empty");
 
-    convert::to_bitmap(data,bitmaps);
-    if(bitmaps.empty())
+    convert::to_frames(file_,frames);
+    if(frames.empty())
       throw fmt::exception("failed to convert");
 
-    for(auto &bitmap : bitmaps)
+    png = (type_ == "png");
+    converted = 0;
+    convert::for_each_frame(frames,
+                            convert::select_frames(frames,opts_.select.filter()),
+                            [&](const size_t i_)
+                            {
+                              return (!png || !frames[i_].rows);
+                            },
+                            [&](const size_t i_, Bitmap &bitmap_)
+                            {
+                              int rv;
+                              RowSource rows;
+                              fs::path output_filepath;
+
+                              if(png && frames[i_].rows)
+                                convert::frame_to_rows(frames,i_,bitmap_,rows);
+                              else if(!bitmap_)
+                                return;
+
+                              output_filepath = l::generate_filepath(input_filepath_,
+                                                                     opts_.output_path,
+                                                                     "." + type_,
+                                                                     bitmap_);
+
+                              if(png)
+                                {
+                                  if(!rows)
+                                    rows = convert::bitmap_rows(bitmap_);
+                                  WriteFile::png(output_filepath,bitmap_.w,bitmap_.h,rows);
+                                  Log::print(" - {}\n",output_filepath);
+                                  converted++;
+                                  return;
+                                }
+
+                              rv = stbi_write(bitmap_,output_filepath,type_);
+                              if(rv)
+                                Log::print(" - {}\n",output_filepath);
+                              else
+                                Log::print(" - ERROR - failed writing file {}",output_filepath);
+                              converted++;
+                            });
+
+    if(converted == 0)
       {
-        fs::path output_filepath;
-
-        output_filepath = l::generate_filepath(input_filepath_,
-                                               opts_.output_path,
-                                               "." + type_,
-                                               bitmap);
-
-        rv = stbi_write(bitmap,output_filepath,type_);
-        if(rv)
-          fmt::print(" - {}\n",output_filepath);
-        else
-          fmt::print(" - ERROR - failed writing file {}",output_filepath);
+        if(!opts_.select.all())
+          throw fmt::exception("no images selected of {}",
+                               convert::frame_images(frames));
+        throw fmt::exception("failed to convert");
       }
   }
 
@@ -114,44 +155,31 @@ namespace l
 
   static
   void
-  handle_file(const fs::path         &filepath_,
+  handle_file(Batch::Input           &input_,
               const Options::ToImage &opts_,
               const std::string      &type_)
   {
-    fmt::print("{}:\n",filepath_);
+    const fs::path &filepath = input_.filepath();
 
-    if(l::same_extension(filepath_,opts_,type_))
+    Log::print("{}:\n",filepath);
+
+    if(l::same_extension(filepath,opts_,type_))
       {
-        fmt::print(" - WARNING - skipping file with target extension\n");
+        Log::print(" - WARNING - skipping file with target extension\n");
         return;
       }
 
     try
       {
-        l::to_stb_image(filepath_,opts_,type_);
+        l::to_stb_image(filepath,input_.file(),opts_,type_);
       }
     catch(const std::system_error &e_)
       {
-        fmt::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
+        Log::print(" - ERROR - {} ({})\n",e_.what(),e_.code().message());
       }
     catch(const std::runtime_error &e_)
       {
-        fmt::print(" - ERROR - {}\n",e_.what());
-      }
-  }
-
-  static
-  void
-  handle_dir(const fs::path         &dirpath_,
-             const Options::ToImage &opts_,
-             const std::string      &type_)
-  {
-    for(const fs::directory_entry &de : fs::recursive_directory_iterator(dirpath_))
-      {
-        if(!de.is_regular_file())
-          continue;
-
-        l::handle_file(de.path(),opts_,type_);
+        Log::print(" - ERROR - {}\n",e_.what());
       }
   }
 }
@@ -162,14 +190,19 @@ namespace SubCmd
   to_stb_image(const Options::ToImage &opts_,
                const std::string      &type_)
   {
-    for(const auto &filepath : opts_.filepaths)
-      {
-        fs::directory_entry de(filepath);
-
-        if(de.is_regular_file())
-          l::handle_file(de.path(),opts_,type_);
-        else if(de.is_directory())
-          l::handle_dir(de.path(),opts_,type_);
-      }
+    Options::PathVec filepaths;
+
+    filepaths = Batch::get_filepaths(opts_.filepaths);
+
+    Batch::run(filepaths,
+               opts_.batch,
+               [&](const Batch::Input &input_)
+               {
+                 return l::same_extension(input_.filepath(),opts_,type_);
+               },
+               [&](Batch::Input &input_)
+               {
+                 l::handle_file(input_,opts_,type_);
+               });
   }
 }
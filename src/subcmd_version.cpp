@@ -17,6 +17,7 @@
 */
 
 #include "fmt.hpp"
+#include "log.hpp"
 
 #include "version.hpp"
 
@@ -25,7 +26,7 @@ namespace SubCmd
   void
   version()
   {
-    fmt::print("3it: 3DO Image Tool v{}.{}.{}\n\n"
+    Log::print("3it: 3DO Image Tool v{}.{}.{}\n\n"
                "https://github.com/trapexit/3it\n"
                "https://github.com/trapexit/support\n\n"
                "ISC License (ISC)\n\n"
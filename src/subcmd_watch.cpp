@@ -0,0 +1,384 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "subcmd.hpp"
+
+#include "mapped_file.hpp"
+#include "options.hpp"
+#include "output_files.hpp"
+
+#include "fmt.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include <system_error>
+#include <unordered_map>
+
+#include <cerrno>
+#include <cstdio>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+/*
+  3it watch [options] PATH... -- SUBCOMMAND [subcommand options]
+
+  Runs the subcommand once over every PATH and then again, with just
+  the files which changed as its inputs, each time something is
+  written or moved into a watched directory. Events are collected
+  until none arrive for --debounce milliseconds so an editor saving a
+  file in several steps triggers one conversion.
+
+  The subcommand is run in-process through the same parser and code
+  as a direct invocation. Files it writes are reported through
+  OutputFiles and their events ignored so outputs placed next to the
+  inputs don't feed back into the next run.
+*/
+#ifdef __linux__
+namespace l
+{
+  typedef std::set<fs::path> PathSet;
+
+  class Watcher
+  {
+  public:
+    Watcher()
+    {
+      _fd = ::inotify_init1(IN_CLOEXEC|IN_NONBLOCK);
+      if(_fd == -1)
+        throw std::system_error(errno,std::generic_category(),"inotify_init1");
+    }
+
+    ~Watcher()
+    {
+      ::close(_fd);
+    }
+
+  public:
+    void
+    add_path(const fs::path &path_)
+    {
+      if(fs::is_directory(path_))
+        return add_dir(path_,PathSet());
+
+      add_dir(path_.parent_path(),PathSet{path_.filename()});
+    }
+
+    // Waits up to timeout_ms_ (-1 = forever) for events and adds the
+    // files they name to changed_. Returns false on timeout.
+    bool
+    read(const int  timeout_ms_,
+         PathSet   &changed_)
+    {
+      int rv;
+      ssize_t len;
+      struct pollfd pfd;
+      alignas(struct inotify_event) char buf[16 * 1024];
+
+      pfd.fd     = _fd;
+      pfd.events = POLLIN;
+      rv = ::poll(&pfd,1,timeout_ms_);
+      if(rv == -1)
+        {
+          if(errno == EINTR)
+            return true;
+          throw std::system_error(errno,std::generic_category(),"poll");
+        }
+      if(rv == 0)
+        return false;
+
+      while(true)
+        {
+          len = ::read(_fd,buf,sizeof(buf));
+          if(len == -1)
+            {
+              if((errno == EAGAIN) || (errno == EINTR))
+                break;
+              throw std::system_error(errno,std::generic_category(),"inotify read");
+            }
+
+          for(char *p = buf; p < (buf + len);)
+            {
+              const struct inotify_event *ev = (const struct inotify_event*)p;
+
+              handle_event(*ev,changed_);
+              p += (sizeof(struct inotify_event) + ev->len);
+            }
+        }
+
+      return true;
+    }
+
+  private:
+    struct Dir
+    {
+      fs::path path;
+      PathSet  only;
+    };
+
+  private:
+    void
+    add_dir(const fs::path &dirpath_,
+            const PathSet  &only_)
+    {
+      int wd;
+      std::error_code ec;
+      const uint32_t mask = (IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE|IN_ONLYDIR);
+
+      wd = ::inotify_add_watch(_fd,dirpath_.c_str(),mask);
+      if(wd == -1)
+        throw std::system_error(errno,
+                                std::generic_category(),
+                                "failed to watch " + dirpath_.string());
+
+      auto iter = _dirs.find(wd);
+      if(iter == _dirs.end())
+        _dirs[wd] = Dir{dirpath_,only_};
+      else if(only_.empty())
+        iter->second.only.clear();
+      else if(!iter->second.only.empty())
+        iter->second.only.insert(only_.begin(),only_.end());
+
+      if(!only_.empty())
+        return;
+
+      for(const auto &de : fs::directory_iterator(dirpath_,ec))
+        {
+          if(de.is_directory(ec) && !de.is_symlink(ec))
+            add_dir(de.path(),PathSet());
+        }
+    }
+
+    void
+    add_new_dir(const fs::path &dirpath_,
+                PathSet        &changed_)
+    {
+      std::error_code ec;
+
+      add_dir(dirpath_,PathSet());
+      for(auto iter = fs::recursive_directory_iterator(dirpath_,ec);
+          iter != fs::recursive_directory_iterator();
+          iter.increment(ec))
+        {
+          if(ec)
+            break;
+          if(iter->is_regular_file(ec))
+            changed_.insert(iter->path());
+        }
+    }
+
+    void
+    handle_event(const struct inotify_event &ev_,
+                 PathSet                    &changed_)
+    {
+      fs::path path;
+
+      if(ev_.mask & IN_Q_OVERFLOW)
+        {
+          for(const auto &kv : _dirs)
+            changed_.insert(kv.second.path);
+          return;
+        }
+
+      auto iter = _dirs.find(ev_.wd);
+      if(iter == _dirs.end())
+        return;
+      if(ev_.mask & IN_IGNORED)
+        {
+          _dirs.erase(iter);
+          return;
+        }
+      if(ev_.len == 0)
+        return;
+
+      const Dir &dir = iter->second;
+      if(!dir.only.empty() && !dir.only.count(ev_.name))
+        return;
+
+      path = dir.path / ev_.name;
+      if(ev_.mask & IN_ISDIR)
+        {
+          if(ev_.mask & (IN_CREATE|IN_MOVED_TO))
+            add_new_dir(path,changed_);
+          return;
+        }
+      if(ev_.mask & (IN_CLOSE_WRITE|IN_MOVED_TO))
+        changed_.insert(path);
+    }
+
+  private:
+    int                          _fd;
+    std::unordered_map<int,Dir>  _dirs;
+  };
+
+  static
+  fs::path
+  normalize(const fs::path &path_)
+  {
+    fs::path path;
+
+    path = path_.lexically_normal();
+    if(!path.has_filename() && path.has_parent_path())
+      path = path.parent_path();
+
+    return path;
+  }
+
+  // Editor swap and backup files.
+  static
+  bool
+  ignored(const fs::path &path_)
+  {
+    const std::string filename = path_.filename().string();
+
+    if(filename.empty())
+      return true;
+    if((filename[0] == '.') && (filename != ".") && (filename != ".."))
+      return true;
+    if(filename.back() == '~')
+      return true;
+
+    return false;
+  }
+
+  static
+  void
+  run(const SubCmd::ArgVec   &cmd_,
+      const PathSet          &paths_,
+      const Options::Watch   &opts_,
+      const SubCmd::Runner   &runner_,
+      PathSet                &written_)
+  {
+    std::string out;
+    std::string err;
+    SubCmd::ArgVec args;
+    std::vector<fs::path> written;
+
+    args = cmd_;
+    for(const auto &path : paths_)
+      args.emplace_back(path.string());
+
+    {
+      OutputFiles::Collect collect(written);
+
+      runner_(args,opts_.batch,out,err);
+    }
+
+    std::fwrite(out.data(),1,out.size(),stdout);
+    std::fwrite(err.data(),1,err.size(),stderr);
+    std::fflush(stdout);
+    std::fflush(stderr);
+
+    for(const auto &path : written)
+      written_.insert(fs::absolute(l::normalize(path)));
+  }
+}
+
+namespace SubCmd
+{
+  void
+  watch(const Options::Watch &opts_,
+        const ArgVec         &args_,
+        const Runner         &runner_)
+  {
+    l::Watcher watcher;
+    l::PathSet roots;
+    l::PathSet written;
+    l::PathSet changed;
+    ArgVec cmd;
+    auto sep = std::find(args_.begin(),args_.end(),"--");
+
+    if(sep == args_.end())
+      throw std::runtime_error("watch: missing '--' before the subcommand");
+    if(sep == args_.begin())
+      throw std::runtime_error("watch: no paths to watch");
+    if((sep + 1) == args_.end())
+      throw std::runtime_error("watch: missing subcommand");
+
+    MappedFile::allow_mmap(false);
+
+    cmd.assign(sep + 1,args_.end());
+    for(auto iter = args_.begin(); iter != sep; ++iter)
+      {
+        fs::path path;
+
+        path = l::normalize(*iter);
+        watcher.add_path(path);
+        roots.insert(path);
+      }
+
+    l::run(cmd,roots,opts_,runner_,written);
+
+    while(true)
+      {
+        // Events for what the last run wrote are already queued.
+        while(watcher.read(0,changed))
+          ;
+        for(auto iter = changed.begin(); iter != changed.end();)
+          {
+            if(written.count(fs::absolute(l::normalize(*iter))))
+              iter = changed.erase(iter);
+            else
+              ++iter;
+          }
+        written.clear();
+
+        if(changed.empty())
+          watcher.read(-1,changed);
+        while(watcher.read(opts_.debounce,changed))
+          ;
+
+        for(auto iter = changed.begin(); iter != changed.end();)
+          {
+            std::error_code ec;
+
+            if(l::ignored(*iter) || !fs::exists(*iter,ec))
+              iter = changed.erase(iter);
+            else
+              ++iter;
+          }
+
+        if(changed.empty())
+          continue;
+
+        l::run(cmd,changed,opts_,runner_,written);
+        changed.clear();
+      }
+  }
+}
+#else
+namespace SubCmd
+{
+  void
+  watch(const Options::Watch &opts_,
+        const ArgVec         &args_,
+        const Runner         &runner_)
+  {
+    throw std::system_error(ENOTSUP,
+                            std::generic_category(),
+                            "watch requires inotify");
+  }
+}
+#endif
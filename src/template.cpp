@@ -18,37 +18,249 @@
 
 #include "template.hpp"
 
+#include "opera_fs.hpp"
+
 #include "fmt.hpp"
 
-std::filesystem::path
-resolve_path_template(const std::filesystem::path &src_filepath_,
-                      const std::filesystem::path &dst_filepath_,
-                      const std::string           &ext_,
-                      const std::unordered_map<std::string,std::string> &extra_)
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+
+/*
+  Output templates are the same handful of strings for every file in
+  a run so they are parsed once into literal and field segments and
+  cached. Anything beyond plain {name} fields (format specs,
+  positional args, malformed braces) is left to fmt, which also
+  produces the errors for it.
+*/
+namespace l
 {
-  std::string rv;
-  fmt::dynamic_format_arg_store<fmt::format_context> args;
+  struct Segment
+  {
+    std::string str;
+    bool        field;
+  };
+
+  typedef std::vector<Segment> Compiled;
+  typedef std::shared_ptr<const Compiled> CompiledPtr;
+
+  static
+  bool
+  is_ident(const std::string &s_)
+  {
+    if(s_.empty())
+      return false;
+    if(!std::isalpha((unsigned char)s_[0]) && (s_[0] != '_'))
+      return false;
+    for(const char c : s_)
+      {
+        if(!std::isalnum((unsigned char)c) && (c != '_'))
+          return false;
+      }
 
-  args.push_back(fmt::arg("ext",ext_));
-  args.push_back(fmt::arg("filepath",src_filepath_));
-  args.push_back(fmt::arg("dirpath",(src_filepath_.has_parent_path() ?
-                                     src_filepath_.parent_path() : ".")));
-  args.push_back(fmt::arg("filename",src_filepath_.stem()));
-  args.push_back(fmt::arg("origext",src_filepath_.extension()));
+    return true;
+  }
 
-  for(auto &kv : extra_)
-    args.push_back(fmt::arg(kv.first.c_str(),kv.second));
+  static
+  CompiledPtr
+  compile(const std::string &tmpl_)
+  {
+    std::string lit;
+    auto rv = std::make_shared<Compiled>();
+
+    for(size_t i = 0; i < tmpl_.size(); i++)
+      {
+        const char c = tmpl_[i];
+
+        if((c == '}') && ((i + 1) < tmpl_.size()) && (tmpl_[i+1] == '}'))
+          {
+            lit += '}';
+            i++;
+            continue;
+          }
+        if(c == '}')
+          return nullptr;
+        if(c != '{')
+          {
+            lit += c;
+            continue;
+          }
+        if(((i + 1) < tmpl_.size()) && (tmpl_[i+1] == '{'))
+          {
+            lit += '{';
+            i++;
+            continue;
+          }
+
+        size_t end;
+        std::string name;
+
+        end = tmpl_.find('}',i);
+        if(end == std::string::npos)
+          return nullptr;
+        name = tmpl_.substr(i + 1,end - i - 1);
+        if(!l::is_ident(name))
+          return nullptr;
+
+        if(!lit.empty())
+          rv->push_back({lit,false});
+        rv->push_back({name,true});
+        lit.clear();
+        i = end;
+      }
+
+    if(!lit.empty())
+      rv->push_back({lit,false});
+
+    return rv;
+  }
+
+  static
+  CompiledPtr
+  lookup(const std::string &tmpl_,
+         bool              &simple_)
+  {
+    static std::shared_mutex mutex;
+    static std::unordered_map<std::string,CompiledPtr> cache;
+    CompiledPtr rv;
 
-  try
     {
-      rv = fmt::vformat(dst_filepath_.string(),args);
+      std::shared_lock<std::shared_mutex> lk(mutex);
+      auto i = cache.find(tmpl_);
+
+      if(i != cache.end())
+        {
+          simple_ = (i->second != nullptr);
+          return i->second;
+        }
     }
-  catch(const std::runtime_error &e)
+
+    rv = l::compile(tmpl_);
+
     {
-      if(e.what() == std::string{"argument not found"})
-        throw std::runtime_error("invalid pattern in filepath template");
-      throw e;
+      std::unique_lock<std::shared_mutex> lk(mutex);
+
+      if(cache.size() >= 1024)
+        cache.clear();
+      cache.emplace(tmpl_,rv);
     }
 
+    simple_ = (rv != nullptr);
+
+    return rv;
+  }
+
+  static
+  fs::path
+  resolve_with_fmt(const fs::path    &src_filepath_,
+                   const fs::path    &dst_filepath_,
+                   const std::string &ext_,
+                   const std::unordered_map<std::string,std::string> &extra_)
+  {
+    std::string rv;
+    fmt::dynamic_format_arg_store<fmt::format_context> args;
+
+    args.push_back(fmt::arg("ext",ext_));
+    args.push_back(fmt::arg("filepath",src_filepath_));
+    args.push_back(fmt::arg("dirpath",(src_filepath_.has_parent_path() ?
+                                       src_filepath_.parent_path() : ".")));
+    args.push_back(fmt::arg("filename",src_filepath_.stem()));
+    args.push_back(fmt::arg("origext",src_filepath_.extension()));
+
+    for(auto &kv : extra_)
+      args.push_back(fmt::arg(kv.first.c_str(),kv.second));
+
+    try
+      {
+        rv = fmt::vformat(dst_filepath_.string(),args);
+      }
+    catch(const std::runtime_error &e)
+      {
+        if(e.what() == std::string{"argument not found"})
+          throw std::runtime_error("invalid pattern in filepath template");
+        throw e;
+      }
+
+    return rv;
+  }
+
+  static
+  fs::path
+  resolve(const fs::path    &src_filepath_,
+          const fs::path    &dst_filepath_,
+          const std::string &ext_,
+          const std::unordered_map<std::string,std::string> &extra_)
+  {
+    bool simple;
+    std::string rv;
+    l::CompiledPtr compiled;
+
+    compiled = l::lookup(dst_filepath_.string(),simple);
+    if(!simple)
+      return l::resolve_with_fmt(src_filepath_,dst_filepath_,ext_,extra_);
+
+    for(const auto &segment : *compiled)
+      {
+        if(!segment.field)
+          {
+            rv += segment.str;
+            continue;
+          }
+
+        const std::string &name = segment.str;
+
+        if(name == "ext")
+          rv += ext_;
+        else if(name == "filepath")
+          rv += src_filepath_.string();
+        else if(name == "dirpath")
+          rv += (src_filepath_.has_parent_path() ?
+                 src_filepath_.parent_path().string() : ".");
+        else if(name == "filename")
+          rv += src_filepath_.stem().string();
+        else if(name == "origext")
+          rv += src_filepath_.extension().string();
+        else
+          {
+            auto i = extra_.find(name);
+
+            if(i == extra_.end())
+              throw std::runtime_error("invalid pattern in filepath template");
+
+            rv += i->second;
+          }
+      }
+
+    return rv;
+  }
+}
+
+// Outputs can't be written next to a file inside a disc image so for
+// those {filepath} and {dirpath} refer to IMAGE.d/PATH instead and the
+// directories are created as needed.
+std::filesystem::path
+resolve_path_template(const std::filesystem::path &src_filepath_,
+                      const std::filesystem::path &dst_filepath_,
+                      const std::string           &ext_,
+                      const std::unordered_map<std::string,std::string> &extra_)
+{
+  fs::path rv;
+  std::error_code ec;
+
+  if(!OperaFS::is_embedded(src_filepath_))
+    return l::resolve(src_filepath_,dst_filepath_,ext_,extra_);
+
+  rv = l::resolve(OperaFS::extraction_path(src_filepath_),
+                  dst_filepath_,
+                  ext_,
+                  extra_);
+  if(rv.has_parent_path())
+    fs::create_directories(rv.parent_path(),ec);
+
   return rv;
 }
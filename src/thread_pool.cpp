@@ -0,0 +1,184 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "thread_pool.hpp"
+
+#include "log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace l
+{
+  struct Task
+  {
+    Task(const size_t            n_,
+         const ThreadPool::Func &fn_)
+      : n(n_),
+        fn(fn_),
+        next(0),
+        done(0),
+        error_idx(n_),
+        logs(n_)
+    {
+    }
+
+    void
+    run()
+    {
+      size_t i;
+
+      while((i = next++) < n)
+        {
+          try
+            {
+              Log::Capture capture(logs[i]);
+
+              fn(i);
+            }
+          catch(...)
+            {
+              std::lock_guard<std::mutex> lk(mutex);
+
+              if(i < error_idx)
+                {
+                  error_idx = i;
+                  error     = std::current_exception();
+                }
+            }
+
+          if(++done == n)
+            {
+              std::lock_guard<std::mutex> lk(mutex);
+              cv.notify_all();
+            }
+        }
+    }
+
+    const size_t             n;
+    const ThreadPool::Func  &fn;
+    std::atomic<size_t>      next;
+    std::atomic<size_t>      done;
+    std::mutex               mutex;
+    std::condition_variable  cv;
+    size_t                   error_idx;
+    std::exception_ptr       error;
+    std::vector<std::string> logs;
+  };
+}
+
+ThreadPool&
+ThreadPool::global()
+{
+  static ThreadPool pool(std::max(std::thread::hardware_concurrency(),1U) - 1);
+
+  return pool;
+}
+
+ThreadPool::ThreadPool(const unsigned threads_)
+  : _stop(false)
+{
+  for(unsigned i = 0; i < threads_; i++)
+    _threads.emplace_back(&ThreadPool::worker,this);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _stop = true;
+  }
+  _cv.notify_all();
+
+  for(auto &thread : _threads)
+    thread.join();
+}
+
+void
+ThreadPool::worker()
+{
+  std::function<void()> job;
+
+  while(true)
+    {
+      {
+        std::unique_lock<std::mutex> lk(_mutex);
+
+        _cv.wait(lk,[&]{ return (_stop || !_queue.empty()); });
+        if(_stop)
+          return;
+
+        job = std::move(_queue.front());
+        _queue.pop_front();
+      }
+
+      job();
+    }
+}
+
+void
+ThreadPool::for_each(const size_t  n_,
+                     const Func   &fn_)
+{
+  size_t helpers;
+  std::shared_ptr<l::Task> task;
+
+  if(n_ == 0)
+    return;
+
+  helpers = std::min<size_t>(n_ - 1,_threads.size());
+  if(helpers == 0)
+    {
+      for(size_t i = 0; i < n_; i++)
+        fn_(i);
+      return;
+    }
+
+  // Helpers which only get to a task after its items are claimed
+  // return without touching fn so it needn't outlive this call.
+  task = std::make_shared<l::Task>(n_,fn_);
+  {
+    std::lock_guard<std::mutex> lk(_mutex);
+
+    for(size_t i = 0; i < helpers; i++)
+      _queue.emplace_back([task]{ task->run(); });
+  }
+  _cv.notify_all();
+
+  task->run();
+
+  {
+    std::unique_lock<std::mutex> lk(task->mutex);
+
+    task->cv.wait(lk,[&]{ return (task->done == task->n); });
+  }
+
+  // Items log to their own buffer, whichever thread ran them, and
+  // are written here on the caller, to its capture if it has one,
+  // in the order and up to the error a serial loop would have.
+  for(size_t i = 0; i < std::min(task->error_idx + 1,n_); i++)
+    Log::write(task->logs[i]);
+
+  if(task->error)
+    std::rethrow_exception(task->error);
+}
@@ -0,0 +1,74 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+  Process wide pool of hardware_concurrency() - 1 workers started on
+  first use. for_each() runs fn(0..n-1) on whichever workers are idle
+  and on the calling thread, which claims items itself, so concurrent
+  callers (such as batch workers) never wait on one another and the
+  pool never oversubscribes the machine. With one CPU everything runs
+  on the caller.
+
+  The exception thrown by the lowest item is rethrown once every item
+  has finished which, for items covering ascending ranges of work
+  that stop at their first error, is the error a serial loop would
+  have raised. Likewise anything the items print through Log is
+  held per item and written by the caller, in item order, once they
+  have all finished.
+*/
+class ThreadPool
+{
+public:
+  typedef std::function<void(const size_t)> Func;
+
+public:
+  static ThreadPool &global();
+
+public:
+  ThreadPool(const unsigned threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+public:
+  unsigned size() const { return _threads.size(); }
+  void     for_each(const size_t  n,
+                    const Func   &fn);
+
+private:
+  void worker();
+
+private:
+  std::mutex                        _mutex;
+  std::condition_variable           _cv;
+  std::deque<std::function<void()>> _queue;
+  std::vector<std::thread>          _threads;
+  bool                              _stop;
+};
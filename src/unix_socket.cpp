@@ -0,0 +1,300 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "unix_socket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace fs = std::filesystem;
+
+
+#ifndef _WIN32
+namespace l
+{
+  [[noreturn]]
+  static
+  void
+  throw_errno(const char          *what_,
+              const fs::path      &path_)
+  {
+    throw std::system_error(errno,
+                            std::generic_category(),
+                            std::string(what_) + " " + path_.string());
+  }
+
+  static
+  sockaddr_un
+  make_addr(const fs::path &path_)
+  {
+    sockaddr_un addr;
+    const std::string &str = path_.native();
+
+    std::memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(str.size() >= sizeof(addr.sun_path))
+      throw std::system_error(ENAMETOOLONG,
+                              std::generic_category(),
+                              "socket path too long " + str);
+    std::memcpy(addr.sun_path,str.data(),str.size());
+
+    return addr;
+  }
+
+  static
+  int
+  new_socket(const fs::path &path_)
+  {
+    int fd;
+
+    fd = ::socket(AF_UNIX,SOCK_STREAM,0);
+    if(fd < 0)
+      l::throw_errno("failed to create socket",path_);
+
+    return fd;
+  }
+
+  static
+  bool
+  in_use(const fs::path &path_)
+  {
+    int fd;
+    int rv;
+    sockaddr_un addr;
+
+    addr = l::make_addr(path_);
+    fd   = ::socket(AF_UNIX,SOCK_STREAM,0);
+    if(fd < 0)
+      return false;
+
+    rv = ::connect(fd,(sockaddr*)&addr,sizeof(addr));
+    ::close(fd);
+
+    return (rv == 0);
+  }
+}
+#endif
+
+UnixSocket::UnixSocket()
+  : _fd(-1)
+{
+}
+
+UnixSocket::UnixSocket(UnixSocket &&other_)
+  : UnixSocket()
+{
+  *this = std::move(other_);
+}
+
+UnixSocket::~UnixSocket()
+{
+  close();
+}
+
+UnixSocket&
+UnixSocket::operator=(UnixSocket &&other_)
+{
+  if(this == &other_)
+    return *this;
+
+  close();
+  _fd  = other_._fd;
+  _buf = std::move(other_._buf);
+  other_._fd = -1;
+
+  return *this;
+}
+
+#ifndef _WIN32
+void
+UnixSocket::listen(const fs::path &path_)
+{
+  int rv;
+  struct stat st;
+  sockaddr_un addr;
+
+  close();
+
+  addr = l::make_addr(path_);
+
+  // Replace a stale socket left behind by a daemon that didn't exit
+  // cleanly but never one that is still answering.
+  rv = ::lstat(path_.c_str(),&st);
+  if((rv == 0) && S_ISSOCK(st.st_mode))
+    {
+      if(l::in_use(path_))
+        throw std::system_error(EADDRINUSE,
+                                std::generic_category(),
+                                "socket already in use " + path_.string());
+      ::unlink(path_.c_str());
+    }
+
+  _fd = l::new_socket(path_);
+
+  rv = ::bind(_fd,(sockaddr*)&addr,sizeof(addr));
+  if(rv < 0)
+    l::throw_errno("failed to bind",path_);
+
+  rv = ::listen(_fd,SOMAXCONN);
+  if(rv < 0)
+    l::throw_errno("failed to listen on",path_);
+}
+
+void
+UnixSocket::connect(const fs::path &path_)
+{
+  int rv;
+  sockaddr_un addr;
+
+  close();
+
+  addr = l::make_addr(path_);
+  _fd  = l::new_socket(path_);
+
+  rv = ::connect(_fd,(sockaddr*)&addr,sizeof(addr));
+  if(rv < 0)
+    l::throw_errno("failed to connect to",path_);
+}
+
+UnixSocket
+UnixSocket::accept()
+{
+  int fd;
+  UnixSocket rv;
+
+  do
+    {
+      fd = ::accept(_fd,nullptr,nullptr);
+    }
+  while((fd < 0) && (errno == EINTR));
+
+  if(fd < 0)
+    throw std::system_error(errno,std::generic_category(),"failed to accept");
+
+  rv._fd = fd;
+
+  return rv;
+}
+
+void
+UnixSocket::close()
+{
+  if(_fd >= 0)
+    ::close(_fd);
+  _fd = -1;
+  _buf.clear();
+}
+
+bool
+UnixSocket::read_line(std::string &line_)
+{
+  size_t pos;
+  ssize_t rv;
+  char buf[64 * 1024];
+
+  while(true)
+    {
+      pos = _buf.find('\n');
+      if(pos != std::string::npos)
+        {
+          line_.assign(_buf,0,pos);
+          _buf.erase(0,pos + 1);
+          return true;
+        }
+
+      rv = ::read(_fd,buf,sizeof(buf));
+      if((rv < 0) && (errno == EINTR))
+        continue;
+      if(rv < 0)
+        throw std::system_error(errno,std::generic_category(),"failed to read from socket");
+      if(rv == 0)
+        return false;
+
+      _buf.append(buf,rv);
+    }
+}
+
+void
+UnixSocket::write_line(const std::string &line_)
+{
+  size_t off;
+  ssize_t rv;
+  std::string msg;
+
+  msg = line_ + '\n';
+  off = 0;
+  while(off < msg.size())
+    {
+      rv = ::send(_fd,msg.data() + off,msg.size() - off,MSG_NOSIGNAL);
+      if((rv < 0) && (errno == EINTR))
+        continue;
+      if(rv < 0)
+        throw std::system_error(errno,std::generic_category(),"failed to write to socket");
+
+      off += rv;
+    }
+}
+#else
+void
+UnixSocket::listen(const fs::path &path_)
+{
+  throw std::system_error(ENOTSUP,std::generic_category(),"unix sockets are not supported on this platform");
+}
+
+void
+UnixSocket::connect(const fs::path &path_)
+{
+  throw std::system_error(ENOTSUP,std::generic_category(),"unix sockets are not supported on this platform");
+}
+
+UnixSocket
+UnixSocket::accept()
+{
+  throw std::system_error(ENOTSUP,std::generic_category(),"unix sockets are not supported on this platform");
+}
+
+void
+UnixSocket::close()
+{
+  _fd = -1;
+  _buf.clear();
+}
+
+bool
+UnixSocket::read_line(std::string &line_)
+{
+  return false;
+}
+
+void
+UnixSocket::write_line(const std::string &line_)
+{
+}
+#endif
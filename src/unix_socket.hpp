@@ -0,0 +1,56 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+
+/*
+  Stream socket on a filesystem path carrying newline-delimited
+  messages. Errors are thrown as std::system_error.
+*/
+class UnixSocket
+{
+public:
+  UnixSocket();
+  UnixSocket(UnixSocket &&other);
+  ~UnixSocket();
+
+  UnixSocket(const UnixSocket&) = delete;
+  UnixSocket& operator=(const UnixSocket&) = delete;
+
+public:
+  UnixSocket& operator=(UnixSocket &&other);
+
+public:
+  void listen(const std::filesystem::path &path);
+  void connect(const std::filesystem::path &path);
+  UnixSocket accept();
+  void close();
+
+public:
+  // Returns false on EOF before a complete line.
+  bool read_line(std::string &line);
+  void write_line(const std::string &line);
+
+private:
+  int         _fd;
+  std::string _buf;
+};
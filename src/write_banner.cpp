@@ -21,6 +21,7 @@
 #include "byteswap.hpp"
 #include "video_image.hpp"
 #include "filerw.hpp"
+#include "write_pdat.hpp"
 
 #include "fmt.hpp"
 
@@ -30,32 +31,43 @@
 namespace fs = std::filesystem;
 
 
+static
 void
-WriteFile::banner(const fs::path &filepath_,
-                  const int       width_,
-                  const int       height_,
-                  ByteVec        &pdat_)
+write_header(DataRW    &f_,
+             const int  width_,
+             const int  height_,
+             const u32  size_)
 {
-  FileRW f;
-
-  f.open_write_trunc(filepath_);
-  if(f.error())
-    throw std::system_error(errno,std::system_category(),"failed to open "+filepath_.string());
-
-  f.u8(0x01);                   // vi_Version
-  f.w("APPSCRN");               // vi_Pattern
-  f.u32be(pdat_.size());        // vi_Size
-  f.u16be(height_);             // vi_Height
-  f.u16be(width_);              // vi_Width
-  f.u8(16);                     // vi_Depth
-  f.u8(0);                      // vi_Type
-  f.u8(0);                      // vi_Reserved1
-  f.u8(0);                      // vi_Reserved2
-  f.u32be(0);                   // vi_Reserved3
-  f.w(pdat_);
-
-  if(f.error())
-    throw std::system_error(errno,std::system_category(),"failed to write "+filepath_.string());
-
-  f.close();
+  f_.u8(0x01);                  // vi_Version
+  f_.w("APPSCRN");              // vi_Pattern
+  f_.u32be(size_);              // vi_Size
+  f_.u16be(height_);            // vi_Height
+  f_.u16be(width_);             // vi_Width
+  f_.u8(16);                    // vi_Depth
+  f_.u8(0);                     // vi_Type
+  f_.u8(0);                     // vi_Reserved1
+  f_.u8(0);                     // vi_Reserved2
+  f_.u32be(0);                  // vi_Reserved3
+}
+
+void
+WriteFile::banner(const fs::path  &filepath_,
+                  const int        width_,
+                  const int        height_,
+                  const RowSource &rows_)
+{
+  WriteFile::pdat(filepath_,
+                  [&](DataRW &rw_)
+                  {
+                    ::write_header(rw_,
+                                   width_,
+                                   height_,
+                                   PDATRowWriter::size(PDATRowWriter::Format::LRFORM_16BPP,
+                                                       width_,
+                                                       height_));
+                  },
+                  PDATRowWriter::Format::LRFORM_16BPP,
+                  width_,
+                  height_,
+                  rows_);
 }
@@ -18,16 +18,18 @@
 
 #pragma once
 
-#include "bytevec.hpp"
+#include "row_sink.hpp"
 
 #include <filesystem>
 
 
 namespace WriteFile
 {
+  // The LRFORM PDAT is encoded from rows as they are decoded. h must
+  // be even; any further rows are dropped.
   void
   banner(const std::filesystem::path &path,
          const int                    w,
          const int                    h,
-         ByteVec                     &pdat);
+         const RowSource             &rows);
 }
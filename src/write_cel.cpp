@@ -23,11 +23,12 @@
 #include "chunk_ids.hpp"
 #include "chunk_sizes.hpp"
 #include "filerw.hpp"
+#include "write_pdat.hpp"
 
 
 static
 void
-write_ccc(FileRW                &f_,
+write_ccc(DataRW                &f_,
           const CelControlChunk &ccc_)
 {
   f_.u32be(CHUNK_CCB);
@@ -114,3 +115,25 @@ WriteFile::cel(const std::filesystem::path &filepath_,
 
   f.close();
 }
+
+void
+WriteFile::cel(const std::filesystem::path &filepath_,
+               const CelControlChunk       &ccc_,
+               const PDATRowWriter::Format  format_,
+               const RowSource             &rows_)
+{
+  WriteFile::pdat(filepath_,
+                  [&](DataRW &rw_)
+                  {
+                    write_ccc(rw_,ccc_);
+                    rw_.u32be(CHUNK_PDAT);
+                    rw_.u32be(CHUNK_HDR_SIZE +
+                              PDATRowWriter::size(format_,
+                                                  ccc_.ccb_Width,
+                                                  ccc_.ccb_Height));
+                  },
+                  format_,
+                  ccc_.ccb_Width,
+                  ccc_.ccb_Height,
+                  rows_);
+}
@@ -20,6 +20,8 @@
 
 #include "cel_control_chunk.hpp"
 #include "plut.hpp"
+#include "row_sink.hpp"
+#include "write_pdat.hpp"
 
 #include <filesystem>
 
@@ -31,4 +33,12 @@ namespace WriteFile
       const CelControlChunk       &ccc,
       const ByteVec               &pdat,
       const PLUT                  &plut);
+
+  // The PDAT encoded from rows as they are decoded. Only for uncoded
+  // unpacked CELs which have no PLUT.
+  void
+  cel(const std::filesystem::path &path,
+      const CelControlChunk       &ccc,
+      const PDATRowWriter::Format  format,
+      const RowSource             &rows);
 }
@@ -0,0 +1,179 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#include "write_pdat.hpp"
+
+#include "filerw.hpp"
+#include "pixel_converter.hpp"
+
+#include "fmt.hpp"
+
+#include <cstring>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+
+static
+u64
+round_up(const u64 number_,
+         const u64 multiple_)
+{
+  return (((number_ + multiple_ - 1) / multiple_) * multiple_);
+}
+
+// Bytes per row, or row pair for LRFORM, including the padding to a
+// 32bit boundary.
+static
+u64
+stride(const PDATRowWriter::Format format_,
+       const u64                   w_)
+{
+  switch(format_)
+    {
+    case PDATRowWriter::Format::LINEAR_8BPP:
+      return ::round_up(w_,4);
+    case PDATRowWriter::Format::LINEAR_16BPP:
+      return ::round_up(w_ * 2,4);
+    case PDATRowWriter::Format::LRFORM_16BPP:
+      return (w_ * 4);
+    }
+
+  return 0;
+}
+
+PDATRowWriter::PDATRowWriter(DataRW       &rw_,
+                             const Format  format_,
+                             const u64     w_,
+                             const u64     h_)
+  : _rw(rw_),
+    _format(format_),
+    _w(w_),
+    _h(h_),
+    _y(0),
+    _buf(::stride(format_,w_))
+{
+  if(_format == Format::LRFORM_16BPP)
+    _left.resize(_w);
+}
+
+u64
+PDATRowWriter::size(const Format format_,
+                    const u64    w_,
+                    const u64    h_)
+{
+  if(format_ == Format::LRFORM_16BPP)
+    return (::stride(format_,w_) * (h_ / 2));
+  return (::stride(format_,w_) * h_);
+}
+
+void
+PDATRowWriter::row(const RGBA8888 *pixels_)
+{
+  u8 *p = _buf.data();
+
+  if(_y >= _h)
+    return;
+
+  switch(_format)
+    {
+    case Format::LINEAR_8BPP:
+      for(u64 x = 0; x < _w; x++)
+        p[x] = RGBA8888Converter::to_rgb332(&pixels_[x]);
+      break;
+    case Format::LINEAR_16BPP:
+      for(u64 x = 0; x < _w; x++)
+        {
+          u16 rgb = RGBA8888Converter::to_rgb0555(&pixels_[x]);
+
+          p[(x * 2) + 0] = (rgb >> 8);
+          p[(x * 2) + 1] = (rgb >> 0);
+        }
+      break;
+    case Format::LRFORM_16BPP:
+      // Each 32bit word holds a pixel of an even row and the one
+      // below it so even rows wait for their partner.
+      if((_y & 1) == 0)
+        {
+          memcpy(_left.data(),pixels_,_w * sizeof(RGBA8888));
+          _y++;
+          return;
+        }
+
+      for(u64 x = 0; x < _w; x++)
+        {
+          u16 l = RGBA8888Converter::to_rgb0555(&_left[x]);
+          u16 r = RGBA8888Converter::to_rgb0555(&pixels_[x]);
+
+          p[(x * 4) + 0] = (l >> 8);
+          p[(x * 4) + 1] = (l >> 0);
+          p[(x * 4) + 2] = (r >> 8);
+          p[(x * 4) + 3] = (r >> 0);
+        }
+      break;
+    }
+
+  _rw.w(_buf);
+  _y++;
+}
+
+void
+PDATRowWriter::finish()
+{
+  if(_y < _h)
+    throw fmt::exception("expected {} rows but got {}",_h,_y);
+}
+
+void
+WriteFile::pdat(const fs::path                     &filepath_,
+                const std::function<void(DataRW&)> &header_,
+                const PDATRowWriter::Format         format_,
+                const u64                           w_,
+                const u64                           h_,
+                const RowSource                    &rows_)
+{
+  int rv;
+  FileRW f;
+
+  rv = f.open_write_trunc(filepath_);
+  if((rv < 0) || f.error())
+    throw std::system_error(-rv,
+                            std::system_category(),
+                            "failed to open "+filepath_.string());
+
+  try
+    {
+      PDATRowWriter writer(f,format_,w_,h_);
+
+      header_(f);
+      rows_(writer);
+      writer.finish();
+
+      if(f.error())
+        throw std::system_error(errno,std::system_category(),"failed to write "+filepath_.string());
+
+      f.close();
+    }
+  catch(...)
+    {
+      std::error_code ec;
+
+      f.close();
+      fs::remove(filepath_,ec);
+      throw;
+    }
+}
@@ -0,0 +1,83 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#pragma once
+
+#include "datarw.hpp"
+#include "rgba8888.hpp"
+#include "row_sink.hpp"
+#include "types_ints.h"
+
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+
+/*
+  The uncoded unpacked PDAT encoders, a row at a time. Each row is
+  converted and written as it arrives so streamed output never holds
+  the PDAT in memory; the bitmap_to_uncoded_unpacked_*() encoders
+  feed it a bitmap's rows. Rows past h are ignored which is how an
+  odd height is truncated for LRFORM.
+*/
+class PDATRowWriter : public RowSink
+{
+public:
+  enum class Format
+    {
+      LINEAR_8BPP,
+      LINEAR_16BPP,
+      LRFORM_16BPP
+    };
+
+public:
+  PDATRowWriter(DataRW       &rw,
+                const Format  format,
+                const u64     w,
+                const u64     h);
+
+public:
+  static u64 size(const Format format,
+                  const u64    w,
+                  const u64    h);
+
+public:
+  void row(const RGBA8888 *pixels);
+  void finish();
+
+private:
+  DataRW                &_rw;
+  const Format           _format;
+  const u64              _w;
+  const u64              _h;
+  u64                    _y;
+  std::vector<RGBA8888>  _left;
+  std::vector<u8>        _buf;
+};
+
+namespace WriteFile
+{
+  // Writes whatever header_ writes followed by the PDAT encoded from
+  // rows_. The file is removed if decoding or writing fails part way.
+  void
+  pdat(const std::filesystem::path          &path,
+       const std::function<void(DataRW&)>   &header,
+       const PDATRowWriter::Format           format,
+       const u64                             w,
+       const u64                             h,
+       const RowSource                      &rows);
+}
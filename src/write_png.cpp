@@ -0,0 +1,790 @@
+/*
+  ISC License
+
+  Copyright (c) 2025, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#include "write_png.hpp"
+
+#include "filerw.hpp"
+#include "stb_image_write.h"
+
+#include "fmt.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+
+/*
+  A streaming port of stb_image_write's PNG encoder. Rows are
+  filtered as stbiw__encode_png_line() would and fed to a port of
+  stbi_zlib_compress() which keeps only the 32K window it can match
+  against rather than the whole filtered image. Match selection,
+  including the hash chain trimming, is unchanged so the output is
+  identical. stb stores the data uncompressed when compression grows
+  it which is only known at the end so in that case the rows are
+  produced a second time.
+*/
+namespace l
+{
+  static
+  const std::array<u32,256>&
+  crc_table()
+  {
+    static const std::array<u32,256> table = []()
+    {
+      std::array<u32,256> t;
+
+      for(u32 n = 0; n < t.size(); n++)
+        {
+          u32 c = n;
+
+          for(int k = 0; k < 8; k++)
+            c = ((c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1));
+
+          t[n] = c;
+        }
+
+      return t;
+    }();
+
+    return table;
+  }
+
+  class CRC32
+  {
+  public:
+    void
+    update(const u8     *p_,
+           const size_t  n_)
+    {
+      const auto &table = l::crc_table();
+
+      for(size_t i = 0; i < n_; i++)
+        _crc = ((_crc >> 8) ^ table[(p_[i] ^ _crc) & 0xFF]);
+    }
+
+    u32 value() const { return ~_crc; }
+
+  private:
+    u32 _crc = ~0u;
+  };
+
+  class Adler32
+  {
+  public:
+    void
+    update(const u8     *p_,
+           const size_t  n_)
+    {
+      for(size_t i = 0; i < n_; i++)
+        {
+          _s1 += p_[i];
+          _s2 += _s1;
+          if(++_n == 5552)
+            {
+              _s1 %= 65521;
+              _s2 %= 65521;
+              _n   = 0;
+            }
+        }
+    }
+
+    u32 s1() const { return (_s1 % 65521); }
+    u32 s2() const { return (_s2 % 65521); }
+
+  private:
+    u32    _s1 = 1;
+    u32    _s2 = 0;
+    size_t _n  = 0;
+  };
+
+  // A PNG chunk written as it is produced. The length is patched in
+  // once known.
+  class Chunk
+  {
+  public:
+    Chunk(FileRW     &f_,
+          const char *tag_)
+      : _f(f_),
+        _tag(tag_)
+    {
+      restart();
+    }
+
+  public:
+    void
+    restart()
+    {
+      _crc  = CRC32();
+      _size = 0;
+      _buf.clear();
+
+      _start = _f.tell();
+      _f.u32be(0);
+      _f.w(_tag);
+      _crc.update((const uint8_t*)_tag,4);
+    }
+
+    void
+    rewind()
+    {
+      _f.seek(_start);
+      restart();
+    }
+
+    void
+    u8(const uint8_t v_)
+    {
+      _buf.push_back(v_);
+      if(_buf.size() >= (64 * 1024))
+        flush();
+    }
+
+    void
+    u32be(const u32 v_)
+    {
+      u8(v_ >> 24);
+      u8(v_ >> 16);
+      u8(v_ >>  8);
+      u8(v_ >>  0);
+    }
+
+    void
+    write(const uint8_t *p_,
+          const size_t   n_)
+    {
+      _buf.insert(_buf.end(),p_,p_ + n_);
+      if(_buf.size() >= (64 * 1024))
+        flush();
+    }
+
+    void
+    end()
+    {
+      u64 pos;
+
+      flush();
+
+      pos = _f.tell();
+      _f.seek(_start);
+      _f.u32be(_size);
+      _f.seek(pos);
+      _f.u32be(_crc.value());
+    }
+
+  private:
+    void
+    flush()
+    {
+      _crc.update(_buf.data(),_buf.size());
+      _f.w(_buf);
+      _size += _buf.size();
+      _buf.clear();
+    }
+
+  private:
+    FileRW     &_f;
+    const char *_tag;
+    u64         _start;
+    u64         _size;
+    CRC32       _crc;
+    std::vector<uint8_t>     _buf;
+  };
+
+  static
+  int
+  bitrev(int code_,
+         int codebits_)
+  {
+    int res = 0;
+
+    while(codebits_--)
+      {
+        res = ((res << 1) | (code_ & 1));
+        code_ >>= 1;
+      }
+
+    return res;
+  }
+
+  static
+  u32
+  zhash(const u8 *data_)
+  {
+    u32 hash = (data_[0] + (data_[1] << 8) + (data_[2] << 16));
+
+    hash ^= hash << 3;
+    hash += hash >> 5;
+    hash ^= hash << 4;
+    hash += hash >> 17;
+    hash ^= hash << 25;
+    hash += hash >> 6;
+
+    return hash;
+  }
+
+  // stbi_zlib_compress() given the data a piece at a time. Positions
+  // are absolute offsets into the data rather than pointers and only
+  // the window behind the current position and the lookahead past it
+  // are held.
+  class Deflate
+  {
+  private:
+    static constexpr size_t ZHASH     = 16384;
+    static constexpr u64    WINDOW    = 32768;
+    static constexpr u64    LOOKAHEAD = 259;
+
+  public:
+    Deflate(Chunk     &out_,
+            const u64  len_,
+            const int  quality_)
+      : _out(out_),
+        _len(len_),
+        _quality(std::max(quality_,5)),
+        _base(0),
+        _i(0),
+        _hash(ZHASH),
+        _bitbuf(0),
+        _bitcount(0),
+        _size(0)
+    {
+      put(0x78);                // DEFLATE 32K window
+      put(0x5e);                // FLEVEL = 1
+      add(1,1);                 // BFINAL = 1
+      add(1,2);                 // BTYPE = 1 -- fixed huffman
+    }
+
+  public:
+    void
+    write(const u8     *p_,
+          const size_t  n_)
+    {
+      _buf.insert(_buf.end(),p_,p_ + n_);
+      while(((_i + 3) < _len) && ((_base + _buf.size()) >= std::min(_len,_i + LOOKAHEAD)))
+        step();
+
+      if((_i - _base) > (WINDOW * 3))
+        {
+          _buf.erase(_buf.begin(),_buf.begin() + (_i - WINDOW - _base));
+          _base = (_i - WINDOW);
+        }
+    }
+
+    void
+    finish()
+    {
+      while((_i + 3) < _len)
+        step();
+      for(; _i < _len; _i++)
+        huffb(at(_i));
+      huff(256);                // end of block
+      while(_bitcount)
+        add(0,1);
+    }
+
+    // Bytes written including the zlib header but not the Adler-32
+    // trailer. What stb compares against the stored size.
+    u64 size() const { return _size; }
+
+  private:
+    u8        at(const u64 pos_) const { return _buf[pos_ - _base]; }
+    const u8 *ptr(const u64 pos_) const { return &_buf[pos_ - _base]; }
+
+    void
+    put(const u8 v_)
+    {
+      _out.u8(v_);
+      _size++;
+    }
+
+    void
+    add(const u32 code_,
+        const int codebits_)
+    {
+      _bitbuf   |= (code_ << _bitcount);
+      _bitcount += codebits_;
+      while(_bitcount >= 8)
+        {
+          put(_bitbuf & 0xFF);
+          _bitbuf   >>= 8;
+          _bitcount  -= 8;
+        }
+    }
+
+    void
+    huffa(const int b_,
+          const int c_)
+    {
+      add(l::bitrev(b_,c_),c_);
+    }
+
+    void
+    huff(const int n_)
+    {
+      if(n_ <= 143)
+        huffa(0x30 + n_,8);
+      else if(n_ <= 255)
+        huffa(0x190 + n_ - 144,9);
+      else if(n_ <= 279)
+        huffa(0 + n_ - 256,7);
+      else
+        huffa(0xc0 + n_ - 280,8);
+    }
+
+    void
+    huffb(const int n_)
+    {
+      if(n_ <= 143)
+        huffa(0x30 + n_,8);
+      else
+        huffa(0x190 + n_ - 144,9);
+    }
+
+    u32
+    countm(const u64 a_,
+           const u64 b_,
+           const u64 limit_) const
+    {
+      u32 i;
+      const u8 *a = ptr(a_);
+      const u8 *b = ptr(b_);
+
+      for(i = 0; (i < limit_) && (i < 258); i++)
+        if(a[i] != b[i])
+          break;
+
+      return i;
+    }
+
+    void
+    step()
+    {
+      static const u16 lengthc[]  = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258,259 };
+      static const u8  lengtheb[] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+      static const u16 distc[]    = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,32768 };
+      static const u8  disteb[]   = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+      int j;
+      u32 best;
+      u64 bestloc;
+      bool found;
+
+      best    = 3;
+      bestloc = 0;
+      found   = false;
+
+      // hash next 3 bytes of data to be compressed
+      {
+        std::vector<u64> &hlist = _hash[l::zhash(ptr(_i)) & (ZHASH - 1)];
+
+        for(const auto pos : hlist)
+          {
+            if((_i - pos) < WINDOW)
+              {
+                u32 d = countm(pos,_i,_len - _i);
+                if(d >= best)
+                  {
+                    best    = d;
+                    bestloc = pos;
+                    found   = true;
+                  }
+              }
+          }
+
+        // when hash table entry is too long, delete half the entries
+        if(hlist.size() == (2 * (size_t)_quality))
+          hlist.erase(hlist.begin(),hlist.begin() + _quality);
+        hlist.push_back(_i);
+      }
+
+      // "lazy matching" - check match at *next* byte, and if it's
+      // better, do cur byte as literal
+      if(found)
+        {
+          const std::vector<u64> &hlist = _hash[l::zhash(ptr(_i + 1)) & (ZHASH - 1)];
+
+          for(const auto pos : hlist)
+            {
+              if((_i - pos) < (WINDOW - 1))
+                {
+                  if(countm(pos,_i + 1,_len - _i - 1) > best)
+                    {
+                      found = false;
+                      break;
+                    }
+                }
+            }
+        }
+
+      if(found)
+        {
+          int d = (int)(_i - bestloc); // distance back
+
+          for(j = 0; best > (u32)(lengthc[j + 1] - 1); j++);
+          huff(j + 257);
+          if(lengtheb[j])
+            add(best - lengthc[j],lengtheb[j]);
+          for(j = 0; d > (distc[j + 1] - 1); j++);
+          add(l::bitrev(j,5),5);
+          if(disteb[j])
+            add(d - distc[j],disteb[j]);
+          _i += best;
+        }
+      else
+        {
+          huffb(at(_i));
+          _i++;
+        }
+    }
+
+  private:
+    Chunk                         &_out;
+    const u64                      _len;
+    const int                      _quality;
+    std::vector<u8>                        _buf;
+    u64                            _base;
+    u64                            _i;
+    std::vector<std::vector<u64>>  _hash;
+    u32                            _bitbuf;
+    int                            _bitcount;
+    u64                            _size;
+  };
+
+  // The uncompressed fallback: stored blocks of up to 32767 bytes.
+  class Stored
+  {
+  public:
+    Stored(Chunk     &out_,
+           const u64  len_)
+      : _out(out_),
+        _left(len_)
+    {
+      _out.u8(0x78);
+      _out.u8(0x5e);
+    }
+
+  public:
+    void
+    write(const u8 *p_,
+          size_t    n_)
+    {
+      while(n_)
+        {
+          size_t n;
+
+          n = std::min<size_t>(n_,(32767 - _buf.size()));
+          _buf.insert(_buf.end(),p_,p_ + n);
+          p_ += n;
+          n_ -= n;
+
+          if((_buf.size() == 32767) || (_buf.size() == _left))
+            flush();
+        }
+    }
+
+  private:
+    void
+    flush()
+    {
+      u32 blocklen = _buf.size();
+
+      _out.u8(_left == blocklen); // BFINAL = ?, BTYPE = 0 -- no compression
+      _out.u8(blocklen);          // LEN
+      _out.u8(blocklen >> 8);
+      _out.u8(~blocklen);         // NLEN
+      _out.u8(~blocklen >> 8);
+      _out.write(_buf.data(),_buf.size());
+
+      _left -= blocklen;
+      _buf.clear();
+    }
+
+  private:
+    Chunk   &_out;
+    u64      _left;
+    std::vector<u8>  _buf;
+  };
+
+  static
+  u8
+  paeth(const int a_,
+        const int b_,
+        const int c_)
+  {
+    int p  = (a_ + b_ - c_);
+    int pa = std::abs(p - a_);
+    int pb = std::abs(p - b_);
+    int pc = std::abs(p - c_);
+
+    if((pa <= pb) && (pa <= pc))
+      return a_;
+    if(pb <= pc)
+      return b_;
+    return c_;
+  }
+
+  // Chooses each row's filter as stbi_write_png_to_mem() does and
+  // passes on the filter type byte followed by the filtered row.
+  class Filter : public RowSink
+  {
+  public:
+    typedef std::function<void(const u8*,size_t)> Output;
+
+  public:
+    Filter(const u64     w_,
+           const Output &output_)
+      : _bytes(w_ * 4),
+        _output(output_),
+        _prev(_bytes),
+        _line(_bytes + 1),
+        _y(0)
+    {
+    }
+
+  public:
+    u64 rows() const { return _y; }
+
+    void
+    row(const RGBA8888 *pixels_)
+    {
+      static const int mapping[]  = { 0,1,2,3,4 };
+      static const int firstmap[] = { 0,1,0,5,6 };
+      int filter_type;
+      int force_filter;
+      const int *mymap;
+      const u8 *z = (const u8*)pixels_;
+
+      mymap = ((_y != 0) ? mapping : firstmap);
+      force_filter = stbi_write_force_png_filter;
+      if(force_filter >= 5)
+        force_filter = -1;
+
+      if(force_filter > -1)
+        {
+          filter_type = force_filter;
+          encode(z,mymap[filter_type]);
+        }
+      else
+        {
+          // Estimate the best filter by running through all of them
+          int best_filter = 0;
+          s64 best_filter_val = 0x7fffffff;
+
+          for(filter_type = 0; filter_type < 5; filter_type++)
+            {
+              s64 est;
+
+              encode(z,mymap[filter_type]);
+
+              // Estimate the entropy of the line using this filter;
+              // the less, the better.
+              est = 0;
+              for(size_t i = 1; i < _line.size(); i++)
+                est += std::abs((signed char)_line[i]);
+              if(est < best_filter_val)
+                {
+                  best_filter_val = est;
+                  best_filter     = filter_type;
+                }
+            }
+
+          filter_type = best_filter;
+          encode(z,mymap[filter_type]);
+        }
+
+      _line[0] = filter_type;
+      _output(_line.data(),_line.size());
+
+      memcpy(_prev.data(),z,_bytes);
+      _y++;
+    }
+
+  private:
+    void
+    encode(const u8  *z_,
+           const int  type_)
+    {
+      const int n = 4;
+      const u8 *p = _prev.data();
+      u8 *line = &_line[1];
+
+      if(type_ == 0)
+        {
+          memcpy(line,z_,_bytes);
+          return;
+        }
+
+      // first pixel has nothing to its left
+      for(size_t i = 0; i < std::min<size_t>(n,_bytes); i++)
+        {
+          switch(type_)
+            {
+            case 1: line[i] = z_[i]; break;
+            case 2: line[i] = z_[i] - p[i]; break;
+            case 3: line[i] = z_[i] - (p[i] >> 1); break;
+            case 4: line[i] = (z_[i] - l::paeth(0,p[i],0)); break;
+            case 5: line[i] = z_[i]; break;
+            case 6: line[i] = z_[i]; break;
+            }
+        }
+
+      switch(type_)
+        {
+        case 1: for(size_t i = n; i < _bytes; i++) line[i] = z_[i] - z_[i-n]; break;
+        case 2: for(size_t i = n; i < _bytes; i++) line[i] = z_[i] - p[i]; break;
+        case 3: for(size_t i = n; i < _bytes; i++) line[i] = z_[i] - ((z_[i-n] + p[i]) >> 1); break;
+        case 4: for(size_t i = n; i < _bytes; i++) line[i] = z_[i] - l::paeth(z_[i-n],p[i],p[i-n]); break;
+        case 5: for(size_t i = n; i < _bytes; i++) line[i] = z_[i] - (z_[i-n] >> 1); break;
+        case 6: for(size_t i = n; i < _bytes; i++) line[i] = z_[i] - l::paeth(z_[i-n],0,0); break;
+        }
+    }
+
+  private:
+    const size_t _bytes;
+    Output       _output;
+    std::vector<u8>      _prev;
+    std::vector<u8>      _line;
+    u64          _y;
+  };
+
+  static
+  void
+  produce(const RowSource      &rows_,
+          const u64             w_,
+          const u64             h_,
+          const Filter::Output &output_)
+  {
+    Filter filter(w_,output_);
+
+    rows_(filter);
+    if(filter.rows() != h_)
+      throw fmt::exception("expected {} rows but got {}",h_,filter.rows());
+  }
+
+  static
+  void
+  write_png(FileRW          &f_,
+            const u64        w_,
+            const u64        h_,
+            const RowSource &rows_)
+  {
+    static const u8 sig[8] = { 137,80,78,71,13,10,26,10 };
+    const u64 len = (h_ * ((w_ * 4) + 1));
+
+    for(const auto c : sig)
+      f_.u8(c);
+
+    {
+      Chunk ihdr(f_,"IHDR");
+
+      ihdr.u32be(w_);
+      ihdr.u32be(h_);
+      ihdr.u8(8);
+      ihdr.u8(6);               // RGBA
+      ihdr.u8(0);
+      ihdr.u8(0);
+      ihdr.u8(0);
+      ihdr.end();
+    }
+
+    {
+      Adler32 adler;
+      Chunk idat(f_,"IDAT");
+      Deflate deflate(idat,len,stbi_write_png_compression_level);
+
+      l::produce(rows_,w_,h_,
+                 [&](const u8 *p_, const size_t n_)
+                 {
+                   adler.update(p_,n_);
+                   deflate.write(p_,n_);
+                 });
+      deflate.finish();
+
+      // store uncompressed instead if compression was worse. Rows
+      // are decoded and filtered again rather than kept since this
+      // only happens for incompressible images and keeping them
+      // would hold the whole image in memory.
+      if(deflate.size() > (len + 2 + (((len + 32766) / 32767) * 5)))
+        {
+          idat.rewind();
+
+          Stored stored(idat,len);
+          l::produce(rows_,w_,h_,
+                     [&](const u8 *p_, const size_t n_)
+                     {
+                       stored.write(p_,n_);
+                     });
+        }
+
+      idat.u8(adler.s2() >> 8);
+      idat.u8(adler.s2());
+      idat.u8(adler.s1() >> 8);
+      idat.u8(adler.s1());
+      idat.end();
+    }
+
+    {
+      Chunk iend(f_,"IEND");
+
+      iend.end();
+    }
+  }
+}
+
+void
+WriteFile::png(const fs::path  &filepath_,
+               const u64        w_,
+               const u64        h_,
+               const RowSource &rows_)
+{
+  int rv;
+  u64 size;
+  FileRW f;
+
+  if((w_ == 0) || (h_ == 0))
+    throw fmt::exception("can't write PNG with no pixels - {}x{}",w_,h_);
+
+  rv = f.open_write_trunc(filepath_);
+  if((rv < 0) || f.error())
+    throw std::system_error(-rv,
+                            std::system_category(),
+                            "failed to open "+filepath_.string());
+
+  try
+    {
+      l::write_png(f,w_,h_,rows_);
+      if(f.error())
+        throw std::system_error(errno,std::system_category(),"failed to write "+filepath_.string());
+
+      // The stored fallback can end short of what was compressed.
+      size = f.tell();
+      f.close();
+      fs::resize_file(filepath_,size);
+    }
+  catch(...)
+    {
+      std::error_code ec;
+
+      f.close();
+      fs::remove(filepath_,ec);
+      throw;
+    }
+}